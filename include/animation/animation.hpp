@@ -37,6 +37,8 @@ namespace ve{
             void setRepeat(bool repeat){isRepeat = repeat;}
             void setFirstKeyFrameTime(float frameTime){firstKeyFrameTime = frameTime;}
             void setLastKeyFrameTime(float frameTime){lastKeyFrameTime = frameTime;}
+            float getFirstKeyFrameTime() const{return firstKeyFrameTime;}
+            float getLastKeyFrameTime() const{return lastKeyFrameTime;}
             float getDuration() const{return lastKeyFrameTime - firstKeyFrameTime;}
             float getCurrentTime() const{return currentKeyFrameTime - firstKeyFrameTime;}
             std::string const& getName() const{return name;}
@@ -3,9 +3,11 @@
 #include "ve_device.hpp"
 #include "ve_game_object.hpp"
 #include "ve_renderer.hpp"
+#include "ve_model_loader.hpp"
 #include "ve_descriptors.hpp"
 #include "ve_texture.hpp"
 #include "ve_normal_map.hpp"
+#include "ve_residency.hpp"
 #include "scene_editor_gui.hpp"
 #include <memory>
 #include <unordered_map>
@@ -16,32 +18,67 @@ namespace ve {
         public:
             static constexpr int WIDTH = 1280;
             static constexpr int HEIGHT = 720;
-            FirstApp();
+            //descriptors per texture binding, the pbr shader indexes each array with the object's index
+            static constexpr uint32_t TEXTURE_SLOTS = 3;
+            struct Options{
+                //submits and waits for every upload command on its own, the old behaviour, to compare startup times
+                bool synchronousUploads{false};
+                //caps device local memory in bytes (0 for none), past it allocations warn or, with strictMemoryBudget, throw
+                VkDeviceSize memoryBudget{0};
+                bool strictMemoryBudget{false};
+                //reports every frame past the warm up that still calls the global operator new
+                bool checkFrameAllocations{false};
+                //recorded frames checked after the warm up before the app closes itself, 0 keeps running until the window is closed
+                uint32_t allocationCheckFrames{0};
+                //caps the bytes of models and textures kept resident (0 for none), least recently used ones are evicted past it
+                VkDeviceSize residencyBudget{0};
+                //threads recording the scene into secondary command buffers, 1 records it inline on the main thread as before
+                //and 0 picks one per hardware thread up to VeCommandRecorder::MAX_THREADS
+                uint32_t recordThreads{0};
+                //extra cubes laid out in a grid, to see how recording scales with the object count
+                uint32_t stressObjects{0};
+                //frames the cpu may record ahead of the gpu, clamped to [1, VeSwapChain::MAX_FRAMES_IN_FLIGHT]
+                int framesInFlight{VeSwapChain::DEFAULT_FRAMES_IN_FLIGHT};
+            };
+            explicit FirstApp(const Options& options);
             ~FirstApp();
             FirstApp(const FirstApp&) = delete;
             FirstApp& operator=(const FirstApp&) = delete;
             void run();
+            //whether a frame past the warm up allocated from the global heap while checkFrameAllocations was on
+            bool failedFrameAllocationCheck() const { return allocatingFrames > 0; }
              
         private:
             void loadGameObjects();
+            void spawnStressObjects(uint32_t count);
             void loadTextures();
+            void writeTextureSet(VeDescriptorSetLayout& setLayout, VkDescriptorSet& set, bool create);
+            //marks what this frame draws as used, so the residency manager keeps it or brings it back
+            void touchAssets();
             int getNumLights();
             VeWindow veWindow{WIDTH, HEIGHT, "First App"};
             VeDevice veDevice{veWindow};
-            VeRenderer veRenderer{veWindow, veDevice};
+            VeRenderer veRenderer;
+            VeUploadContext uploadContext{veDevice};
+            //declared before everything that can own a model, models hand their ranges back when destroyed
+            VeGeometryHeap geometryHeap{veDevice};
+            VeModelLoader modelLoader{veDevice, uploadContext, &geometryHeap};
+            VeResidencyManager residency{modelLoader, uploadContext, veDevice.getGraphicsTimeline()};
             VkRenderPass renderPass = VK_NULL_HANDLE;
             VkDescriptorPool imGuiPool;
             std::unique_ptr<VeDescriptorPool> globalPool{};
-            std::vector<std::unique_ptr<VeTexture>> textures;
-            std::vector<std::unique_ptr<VeNormal>> normalMaps;
-            std::vector<std::unique_ptr<VeNormal>> specularMaps;
-            std::vector<VkDescriptorImageInfo> textureInfos;
-            std::vector<VkDescriptorImageInfo> normalMapInfos;
-            std::vector<VkDescriptorImageInfo> specularMapInfos;
+            //residency manager texture ids, indexed by the objects' texture, normal and specular indices
+            std::vector<uint32_t> textures;
+            std::vector<uint32_t> normalMaps;
+            std::vector<uint32_t> specularMaps;
             SceneEditor sceneEditor{};
             VeGameObject::Map gameObjects;
             //temporary pointer to cube map obj
             int cubeMapIndex = 0;
             int selectedObject = -1;
+            bool checkFrameAllocations = false;
+            uint32_t allocationCheckFrames = 0;
+            uint32_t allocatingFrames = 0;
+            uint32_t recordThreads = 0;
     };
 }
\ No newline at end of file
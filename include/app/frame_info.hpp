@@ -2,6 +2,7 @@
 
 #include "ve_camera.hpp"
 #include "ve_game_object.hpp"
+#include "ve_frame_arena.hpp"
 #include <vulkan/vulkan.h>
 
 #define MAX_POINT_LIGHTS 10
@@ -44,5 +45,10 @@ namespace ve{
         int selectedObject;
         int numLights;
         bool showOutlignHighlight;
+        //transient allocations of this frame, valid until the frame has finished on the gpu
+        VeFrameArena& frameArena;
+        //dynamic offsets into the frame ring for the global ubo and the default joint palette
+        uint32_t globalUboOffset{0};
+        uint32_t jointPaletteOffset{0};
     };
 }
\ No newline at end of file
@@ -1,4 +1,10 @@
 #include "ve_game_object.hpp"
+#include "pbr_render_system.hpp"
+#include "buffer.hpp"
+#include "ve_host_allocator.hpp"
+#include "ve_frame_arena.hpp"
+#include "ve_residency.hpp"
+#include "ve_command_recorder.hpp"
 
 #include <imgui.h>
 #define GLM_FORCE_RADIANS
@@ -8,12 +14,21 @@
 namespace ve {
     class SceneEditor {
         public:
+            static constexpr const char* MEMORY_REPORT_PATH = "memory_report.json";
             SceneEditor();
             void drawSceneEditor(VeGameObject::Map& gameObjects, int& selectedObject, VeGameObject& camera, int& numLights, bool& isOutlignHighlight);
             void drawObjectsColumn(VeGameObject::Map& gameObjects,int& selectedObject, bool isLight);
             void drawProperties(VeGameObject::Map& gameObjects, VeGameObject& camera);
             void addObject(VeGameObject::Map& gameObjects, int& numLights, int& selectedObject);
             void selectModel(VeGameObject::Map& gameObjects, VeGameObject& object);
+            void drawLodPanel(float& lodBias, const PbrRenderSystem::LodStats& lodStats);
+            //allocator totals per category, heap budgets and a button that writes them to MEMORY_REPORT_PATH
+            void drawMemoryPanel(VeDevice& device, const VeBuffer::TrafficStats& bufferTraffic, const VeHostAllocator::Stats& hostAllocations,
+                                 const VeFrameArena::Stats& frameArena, uint64_t frameHeapAllocations);
+            //residency counters and a budget slider, 0 turns eviction off
+            void drawResidencyPanel(VeResidencyManager& residency);
+            //cpu time spent recording the swap chain pass and, when it is recorded in parallel, the tasks each thread took
+            void drawRecordingPanel(float recordMilliseconds, const VeCommandRecorder::Stats* recorderStats);
         private:
             
             int selectedGameObject = -1;
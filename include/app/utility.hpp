@@ -1,5 +1,6 @@
 #pragma once
 #include "ve_model.hpp"
+#include "ve_model_loader.hpp"
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -28,15 +29,16 @@ namespace ve{
         "wall_gray",
         "tile"
     };
-    inline std::unordered_map<std::string, std::shared_ptr<VeModel>> preLoadedModels;
-    inline void preLoadModels(VeDevice& veDevice){
-        preLoadedModels["cube"] = VeModel::createModelFromFile(veDevice, "assets/models/cube.obj");
-        preLoadedModels["quad"] = VeModel::createModelFromFile(veDevice, "assets/models/quad.obj");
-        preLoadedModels["flat_vase"] = VeModel::createModelFromFile(veDevice, "assets/models/flat_vase.obj");
-        preLoadedModels["smooth_vase"] = VeModel::createModelFromFile(veDevice, "assets/models/smooth_vase.obj");
-        preLoadedModels["colored_cube"] = VeModel::createModelFromFile(veDevice, "assets/models/colored_cube.obj");
-        preLoadedModels["Cute_Demon"] = VeModel::createModelFromFile(veDevice, "assets/models/result.gltf");
-        preLoadedModels["CesiumMan"] = VeModel::createModelFromFile(veDevice, "assets/models/CesiumManAnimations.gltf");
+    inline std::unordered_map<std::string, std::shared_ptr<VeModelHandle>> preLoadedModels;
+    //only queues the loads, the models stream in while the first frames render their placeholders
+    inline void preLoadModels(VeModelLoader& modelLoader){
+        preLoadedModels["cube"] = modelLoader.load("assets/models/cube.obj");
+        preLoadedModels["quad"] = modelLoader.load("assets/models/quad.obj");
+        preLoadedModels["flat_vase"] = modelLoader.load("assets/models/flat_vase.obj");
+        preLoadedModels["smooth_vase"] = modelLoader.load("assets/models/smooth_vase.obj");
+        preLoadedModels["colored_cube"] = modelLoader.load("assets/models/colored_cube.obj");
+        preLoadedModels["Cute_Demon"] = modelLoader.load("assets/models/result.gltf");
+        preLoadedModels["CesiumMan"] = modelLoader.load("assets/models/CesiumManAnimations.gltf");
     }
     inline void cleanupPreloadedModels() {
     for (auto& [key, model] : preLoadedModels) {
@@ -1,11 +1,23 @@
 #pragma once
  
 #include "ve_device.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
  
 namespace ve {
  
     class VeBuffer {
         public:
+        // host writes and flushes of every buffer since the last reset, read once per frame
+        struct TrafficStats {
+            uint64_t bytesWritten{0};
+            uint64_t bytesFlushed{0};
+            uint64_t flushCalls{0};
+        };
+
         VeBuffer(
             VeDevice& device,
             VkDeviceSize instanceSize,
@@ -39,14 +51,20 @@ namespace ve {
         VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
+        bool isCoherent() const { return coherent; }
+
+        static TrafficStats getTrafficStats();
+        static void resetTrafficStats();
         
         private:
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+        void markDirty(VkDeviceSize begin, VkDeviceSize end);
+        VkResult flushRange(VkDeviceSize begin, VkDeviceSize end);
         
         VeDevice& veDevice;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VeAllocation memory{};
         
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -54,6 +72,15 @@ namespace ve {
         VkDeviceSize alignmentSize;
         VkBufferUsageFlags usageFlags;
         VkMemoryPropertyFlags memoryPropertyFlags;
+        // of the memory type actually picked, which may be coherent even if that was not asked for
+        bool coherent;
+        VkDeviceSize atomSize;
+        // written but not flushed yet, sorted, disjoint and atom aligned [begin, end) pairs
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> dirtyRanges;
+
+        static std::atomic<uint64_t> bytesWritten;
+        static std::atomic<uint64_t> bytesFlushed;
+        static std::atomic<uint64_t> flushCalls;
     };
  
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "ve_device.hpp"
 #include "buffer.hpp"
+#include "ve_upload_context.hpp"
 #ifndef ENGINE_DIR
 #define ENGINE_DIR "../"
 #endif
@@ -16,7 +17,8 @@ namespace ve{
             CubeMap(CubeMap&& other) noexcept;
             CubeMap& operator=(CubeMap&& other) noexcept;
 
-            bool init(const std::vector<std::string>& filePaths, bool srgb, bool flip=true); 
+            //the faces are recorded into uploadContext, sample them only once that batch has completed
+            bool init(VeUploadContext& uploadContext, const std::vector<std::string>& filePaths, bool srgb, bool flip=true); 
 
             int getWidht() const { return width; }
             int getHeight() const { return height; }
@@ -28,10 +30,8 @@ namespace ve{
             static constexpr bool USE_NORM = false;
 
         private:
-            bool create();
+            bool create(VeUploadContext& uploadContext);
             void createImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties);
-            void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-            void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
 
 
             //attributes
@@ -42,7 +42,7 @@ namespace ve{
             VkImageLayout imageLayout;
             VkDescriptorImageInfo descriptorImageInfo;
             VkImage image;
-            VkDeviceMemory deviceMemory;
+            VeAllocation deviceMemory;
             VkFormat format;
             std::vector<std::string> fileNames;
             unsigned int mipLevels;
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ve{
+    //counts global operator new calls made by the whole process, from any thread
+    //the replacement operators forward to malloc/aligned_alloc, so allocations made with malloc directly (glfw, ImGui, the driver)
+    //are not counted, the frame loop check only covers the engine's own C++ containers
+    class VeAllocationCounter{
+    public:
+        static uint64_t getAllocations();
+        static uint64_t getFrees();
+    };
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ve_device.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ve{
+    //records the tasks of a render pass into secondary command buffers on a fixed set of threads and executes them in task order
+    //every thread has a command pool per frame in flight, reset as a whole in beginFrame once the renderer waited for the frame,
+    //so secondaries are reused frame after frame without freeing them one by one
+    //the calling thread records tasks as well, threadCount 1 records everything on it
+    class VeCommandRecorder{
+    public:
+        static constexpr uint32_t MAX_THREADS = 8;
+
+        struct Stats{
+            uint32_t tasks{0};
+            uint32_t threads{0};
+            //tasks recorded by each thread in the last record call, thread 0 is the caller
+            std::array<uint32_t, MAX_THREADS> threadTasks{};
+            //cpu time of the last record call, from waking the workers until the last secondary was executed
+            float milliseconds{0.0f};
+        };
+
+        //threadCount 0 uses every hardware thread up to MAX_THREADS
+        VeCommandRecorder(VeDevice& device, int framesInFlight, uint32_t threadCount = 0);
+        ~VeCommandRecorder();
+        VeCommandRecorder(const VeCommandRecorder&) = delete;
+        VeCommandRecorder& operator=(const VeCommandRecorder&) = delete;
+
+        void beginFrame(int frameIndex);
+        //fn(task, commandBuffer) records task into a secondary that inherits inheritance's render pass and already has the
+        //viewport and scissor for extent set, tasks run concurrently and in any order but are executed in primary in task order
+        //the first exception thrown by a task is rethrown once every task has finished, nothing is executed then
+        template<typename Fn>
+        void record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo& inheritance, VkExtent2D extent, uint32_t taskCount, Fn&& fn){
+            using Callable = std::remove_reference_t<Fn>;
+            Job job{};
+            job.callable = const_cast<void*>(static_cast<const void*>(&fn));
+            job.invoke = [](void* callable, uint32_t task, VkCommandBuffer commandBuffer){
+                (*static_cast<Callable*>(callable))(task, commandBuffer);
+            };
+            job.inheritance = inheritance;
+            job.extent = extent;
+            job.taskCount = taskCount;
+            run(primary, job);
+        }
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct Job{
+            void* callable;
+            void (*invoke)(void* callable, uint32_t task, VkCommandBuffer commandBuffer);
+            VkCommandBufferInheritanceInfo inheritance;
+            VkExtent2D extent;
+            uint32_t taskCount;
+        };
+        struct ThreadState{
+            std::vector<VkCommandPool> pools;
+            //allocated so far from each pool, the first used ones are handed out again after the reset
+            std::vector<std::vector<VkCommandBuffer>> buffers;
+            uint32_t used{0};
+            uint32_t tasks{0};
+            std::exception_ptr error;
+        };
+
+        void run(VkCommandBuffer primary, const Job& job);
+        void workerLoop(uint32_t thread);
+        //takes tasks until none are left
+        void recordTasks(uint32_t thread);
+        VkCommandBuffer acquireBuffer(ThreadState& state);
+
+        VeDevice& veDevice;
+        std::vector<ThreadState> threads;
+        std::vector<std::thread> workers;
+        int frameIndex{0};
+        //the secondary recorded for each task of the current job
+        std::vector<VkCommandBuffer> taskBuffers;
+        const Job* job{nullptr};
+        std::atomic<uint32_t> nextTask{0};
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workDone;
+        //bumped per job, workers run each generation once
+        uint64_t generation{0};
+        uint32_t busyWorkers{0};
+        bool stopping{false};
+        Stats stats{};
+    };
+}
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "ve_window.hpp"
+#include "ve_memory_allocator.hpp"
+#include "ve_host_allocator.hpp"
+#include "ve_timeline.hpp"
 
 // std lib headers
+#include <array>
+#include <memory>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -17,11 +23,29 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  // a family that can copy but not draw, the copy engines on discrete gpus
+  uint32_t transferFamily;
+  // a family that can dispatch but not draw, async compute beside the graphics queue
+  uint32_t computeFamily;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
+  bool computeFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+// one memory heap as the driver sees it, budget and usage come from VK_EXT_memory_budget when the device has it
+struct MemoryHeapBudget {
+  VkDeviceSize size;
+  // what this process may use before the driver starts to evict or fail
+  VkDeviceSize budget;
+  // this process' usage, everything the driver counts against it and not only the allocator's blocks
+  VkDeviceSize usage;
+  // held by the engine's allocator
+  VkDeviceSize allocated;
+  bool deviceLocal;
+};
+
 class VeDevice {
  public:
 #ifdef NDEBUG
@@ -42,11 +66,28 @@ class VeDevice {
   VkCommandPool getCommandPool() { return commandPool; }
   VkInstance getInstance() { return instance; }
   VkDevice device() { return device_; }
+  // VeHostAllocator's callbacks or null, every vkCreate and its vkDestroy have to pass the same
+  const VkAllocationCallbacks *allocationCallbacks() const { return allocationCallbacks_; }
   VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
   uint32_t graphicsQueueFamilyIndex() { return findPhysicalQueueFamilies().graphicsFamily; }
+  // without a dedicated transfer family these are the graphics queue, family and command pool
+  bool hasDedicatedTransferQueue() { return transferQueue_ != graphicsQueue_; }
+  VkQueue transferQueue() { return transferQueue_; }
+  uint32_t transferQueueFamilyIndex() { return transferFamily_; }
+  VkCommandPool getTransferCommandPool() { return transferCommandPool; }
+  // without a separate compute family these are the graphics queue, family, command pool and timeline, so work recorded
+  // for the compute queue and handed to a frame through the compute timeline runs the same either way
+  // buffers and images shared with graphics need CONCURRENT sharing or an ownership transfer when the families differ
+  bool hasDedicatedComputeQueue() { return computeQueue_ != graphicsQueue_; }
+  VkQueue computeQueue() { return computeQueue_; }
+  uint32_t computeQueueFamilyIndex() { return computeFamily_; }
+  VkCommandPool getComputeCommandPool() { return computeCommandPool; }
+  // every graphics queue submission goes through it, frames and uploads retire by its values
+  VeTimeline &getGraphicsTimeline() { return *graphicsTimeline; }
+  VeTimeline &getComputeTimeline() { return computeTimeline ? *computeTimeline : *graphicsTimeline; }
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
@@ -54,12 +95,14 @@ class VeDevice {
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
+  // memory comes out of the sub-allocator, bind offsets are allocation.offset and it goes back through freeMemory
   void createBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      VeAllocation &bufferMemory,
+      VeMemoryCategory category);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -70,7 +113,16 @@ class VeDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      VeAllocation &imageMemory,
+      VeMemoryCategory category);
+  void freeMemory(VeAllocation &allocation) { memoryAllocator->free(allocation); }
+  VeMemoryAllocator &getMemoryAllocator() { return *memoryAllocator; }
+  bool hasMemoryBudget() const { return memoryBudgetSupported; }
+  // without VK_EXT_memory_budget the budget is 80% of the heap and usage is what the allocator holds
+  // fills one entry per memory heap and returns the heap count, no heap allocation so the memory panel can call it every frame
+  uint32_t queryMemoryBudget(std::array<MemoryHeapBudget, VK_MAX_MEMORY_HEAPS> &heaps);
+  // allocator totals, categories and heap budgets as one JSON object
+  void writeMemoryReport(std::ostream &out);
 
     VkPhysicalDeviceProperties properties;
     
@@ -82,6 +134,7 @@ class VeDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createMemoryAllocator();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -92,17 +145,30 @@ class VeDevice {
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+  bool hasDeviceExtension(VkPhysicalDevice device, const char *name);
 
+  const VkAllocationCallbacks *allocationCallbacks_;
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
   VeWindow &window;
   VkCommandPool commandPool;
+  VkCommandPool transferCommandPool;
+  VkCommandPool computeCommandPool;
 
   VkDevice device_;
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  uint32_t transferFamily_;
+  VkQueue computeQueue_;
+  uint32_t computeFamily_;
+  std::unique_ptr<VeMemoryAllocator> memoryAllocator;
+  std::unique_ptr<VeTimeline> graphicsTimeline;
+  // null without a dedicated compute queue
+  std::unique_ptr<VeTimeline> computeTimeline;
+  bool memoryBudgetSupported = false;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   //add vk_KHR_portability_subset to the list of required extensions for macOS
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace ve{
+    //bump allocator for transient cpu data of one frame (descriptor set lists, draw lists, push constant blocks)
+    //one segment per frame in flight, reset by beginFrame once the renderer has waited for the frame that last used it,
+    //so anything allocated here may be read until that frame has finished on the gpu, and is never freed one by one
+    //a frame that outgrows its segment spills into heap blocks and the segment grows to fit at its next beginFrame,
+    //after a few frames the steady state allocates nothing from the global heap
+    //main thread only
+    class VeFrameArena{
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 256 * 1024;
+
+        struct Stats{
+            size_t used{0};
+            size_t capacity{0};
+            //largest amount one frame used so far, spills included
+            size_t peak{0};
+            //allocations served from heap blocks since the arena was created
+            uint64_t spills{0};
+        };
+
+        //std allocator handing out arena memory, deallocate is a no-op, the memory goes away with the frame
+        template<typename T>
+        class Allocator{
+        public:
+            using value_type = T;
+            explicit Allocator(VeFrameArena& arena): arena{&arena}{}
+            template<typename U>
+            Allocator(const Allocator<U>& other): arena{other.arena}{}
+            T* allocate(size_t count){ return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+            void deallocate(T*, size_t){}
+            template<typename U>
+            bool operator==(const Allocator<U>& other) const { return arena == other.arena; }
+            template<typename U>
+            bool operator!=(const Allocator<U>& other) const { return arena != other.arena; }
+        private:
+            template<typename U>
+            friend class Allocator;
+            VeFrameArena* arena;
+        };
+        template<typename T>
+        using Vector = std::vector<T, Allocator<T>>;
+
+        explicit VeFrameArena(uint32_t frameCount, size_t capacity = DEFAULT_CAPACITY);
+        VeFrameArena(const VeFrameArena&) = delete;
+        VeFrameArena& operator=(const VeFrameArena&) = delete;
+
+        void beginFrame(int frameIndex);
+        void* allocate(size_t size, size_t alignment);
+        //uninitialized storage, only for trivially constructible types
+        template<typename T>
+        T* allocateArray(size_t count){ return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+        template<typename T>
+        Vector<T> makeVector(size_t reserve = 0){
+            Vector<T> vector{Allocator<T>{*this}};
+            vector.reserve(reserve);
+            return vector;
+        }
+        template<typename T>
+        Vector<T> makeVector(std::initializer_list<T> values){ return Vector<T>(values, Allocator<T>{*this}); }
+
+        Stats getStats() const;
+
+        //builds arena vectors over many simulated frames and checks that after warming up no frame calls the global operator new
+        static bool selfTest(uint32_t frameCount);
+
+    private:
+        struct Segment{
+            std::unique_ptr<std::byte[]> memory;
+            size_t capacity{0};
+            size_t cursor{0};
+            //heap blocks of the frame that did not fit, released and folded into the capacity at the next beginFrame
+            std::vector<std::unique_ptr<std::byte[]>> spillBlocks;
+            size_t spillBytes{0};
+        };
+
+        std::vector<Segment> segments;
+        Segment* current;
+        size_t peak{0};
+        uint64_t spills{0};
+    };
+}
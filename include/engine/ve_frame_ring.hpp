@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "buffer.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace ve{
+    //one persistently mapped host visible uniform buffer with a segment per frame in flight, every frame bump allocates
+    //its uniform data (global ubo, joint palettes, per draw data) from its own segment and binds it through
+    //UNIFORM_BUFFER_DYNAMIC descriptors, so one descriptor set per binding serves every frame and every object
+    //a segment is reset in beginFrame, after the renderer has waited for the frame that last used it
+    class VeFrameRing{
+    public:
+        static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = 1024 * 1024;
+        //returned by push when the frame's segment is full
+        static constexpr uint32_t NO_OFFSET = UINT32_MAX;
+
+        struct Allocation{
+            void* data;
+            //dynamic offset to bind the data with
+            uint32_t offset;
+            VkDeviceSize size;
+        };
+
+        //maxRange is the largest descriptor range bound into the ring, the buffer is padded by it so any dynamic offset stays valid
+        VeFrameRing(VeDevice& device, uint32_t frameCount, VkDeviceSize maxRange, VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
+        VeFrameRing(const VeFrameRing&) = delete;
+        VeFrameRing& operator=(const VeFrameRing&) = delete;
+
+        //what every allocation is aligned to, size a segment for n allocations of size bytes as n * (size + alignment)
+        static VkDeviceSize getAlignment(const VeDevice& device);
+
+        void beginFrame(int frameIndex);
+        //aligned to minUniformBufferOffsetAlignment, a full segment gives data nullptr and offset NO_OFFSET instead of throwing
+        //mid-frame, the caller skips whatever needed the data and the overflow is reported once
+        Allocation allocate(VkDeviceSize size);
+        uint32_t push(const void* data, VkDeviceSize size){
+            Allocation allocation = allocate(size);
+            if(allocation.data){
+                buffer->writeToBuffer(const_cast<void*>(data), size, allocation.offset);
+            }
+            return allocation.offset;
+        }
+        template<typename T>
+        uint32_t push(const T& value){ return push(&value, sizeof(T)); }
+        //flushes what this frame wrote so far instead of the whole buffer
+        void flush();
+
+        //offset 0 and the given range, the dynamic offset passed at bind time selects the data
+        VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+        VkDeviceSize getUsed() const { return cursor - frameStart; }
+        VkDeviceSize getFrameCapacity() const { return frameCapacity; }
+        //allocations refused because their segment was full, since creation
+        uint64_t getOverflows() const { return overflows; }
+
+    private:
+        VeDevice& veDevice;
+        std::unique_ptr<VeBuffer> buffer;
+        VkDeviceSize alignment;
+        VkDeviceSize frameCapacity;
+        VkDeviceSize frameStart{0};
+        VkDeviceSize cursor{0};
+        //start of the range not flushed yet
+        VkDeviceSize flushed{0};
+        uint64_t overflows{0};
+    };
+}
@@ -9,6 +9,7 @@
 #include <unordered_map>
 #include <cstring>
 namespace ve{
+    class VeModelHandle;
     struct TransformComponent{
         glm::vec3 translation{};
         glm::vec3 scale{1.0f,1.0f,1.0f};
@@ -37,7 +38,7 @@ namespace ve{
             //instantiation of point light
             static VeGameObject createPointLight(float intensity=1.0f, float radius=0.1f, glm::vec3 color=glm::vec3(1.0f));
             //instantiation of cube map
-            static VeGameObject createCubeMap(VeDevice& device, const std::vector<std::string>& faces, VeDescriptorPool& descriptorPool);
+            static VeGameObject createCubeMap(VeDevice& device, VeUploadContext& uploadContext, const std::vector<std::string>& faces, VeDescriptorPool& descriptorPool);
             VeGameObject(const VeGameObject&) = delete;
             VeGameObject& operator=(const VeGameObject&) = delete;
             VeGameObject(VeGameObject&&) = default;
@@ -48,6 +49,8 @@ namespace ve{
             TransformComponent transform{};
             //optional attributes
             std::shared_ptr<VeModel> model{};
+            //the handle model comes from, model follows it as it streams in, is evicted and reloaded
+            std::shared_ptr<VeModelHandle> modelHandle{};
             std::unique_ptr<PointLightComponent> lightComponent = nullptr;
             std::unique_ptr<CubeMapComponent> cubeMapComponent = nullptr;
 
@@ -83,6 +86,10 @@ namespace ve{
             float getSmoothness(){
                 return smoothness;
             }
+            //shows the handle's placeholder until the model has streamed in
+            void setModel(const std::shared_ptr<VeModelHandle>& handle);
+            //picks up what the handle resolves to now, returns true on the frames model changes
+            bool updateModel();
         private:
             //instantiation of VeGameobject is only allowed through createGameObject to 
             //make sure id is unique (incrementing)
@@ -93,6 +100,7 @@ namespace ve{
             uint32_t normalIndex = -1;
             uint32_t specularIndex = -1;
             float smoothness = 0.0f;
+            uint32_t modelGeneration = 0;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "buffer.hpp"
+#include "ve_memory_allocator.hpp"
+#include "ve_model.hpp"
+#include "ve_upload_context.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace ve{
+    //one device local vertex buffer per vertex layout and one index buffer shared by every layout, sub-allocated per model
+    //so a frame binds geometry once per layout and draws with firstIndex/vertexOffset instead of rebinding per object
+    //a vertex buffer holds the position stream in its first half and the attribute stream after it, a model's vertices
+    //sit at the same vertex index in both, so the two bindings never change between models of one layout
+    //main thread only, like VeUploadContext
+    class VeGeometryHeap{
+    public:
+        static constexpr VkDeviceSize VERTEX_ARENA_BYTES = 64ull * 1024 * 1024;
+        static constexpr VkDeviceSize INDEX_ARENA_BYTES = 32ull * 1024 * 1024;
+
+        using Range = VeModel::GeometryRange;
+
+        struct Stats{
+            uint32_t models{0};
+            //released ranges and retired buffers still waiting for the frames that may draw them
+            uint32_t pendingReleases{0};
+            //models that did not fit and kept their own buffers
+            uint32_t overflows{0};
+            std::array<uint32_t, VeModel::VERTEX_LAYOUT_COUNT> usedVertices{};
+            std::array<uint32_t, VeModel::VERTEX_LAYOUT_COUNT> vertexCapacity{};
+            VkDeviceSize usedIndexBytes{0};
+            VkDeviceSize largestFreeIndexRange{0};
+        };
+
+        explicit VeGeometryHeap(VeDevice& device);
+        VeGeometryHeap(const VeGeometryHeap&) = delete;
+        VeGeometryHeap& operator=(const VeGeometryHeap&) = delete;
+
+        //allocates the ranges and records the copies into uploadContext, false when an arena is full
+        bool insert(const VeModel::PackedGeometry& geometry, VeUploadContext& uploadContext, Range& range);
+        //the range is reused only after the frame being recorded and every earlier submission have finished
+        void release(const Range& range);
+        //same for the own buffers of a model that did not fit, they are destroyed once the timeline has passed them
+        void retire(std::unique_ptr<VeBuffer> buffer);
+        //call once per submitted frame, returns released ranges to the free lists once the graphics timeline passed them
+        void endFrame();
+
+        void bind(VkCommandBuffer commandBuffer, VeModel::VertexLayout layout, VkIndexType indexType);
+        void bindPositions(VkCommandBuffer commandBuffer, VeModel::VertexLayout layout, VkIndexType indexType);
+        //identifies what bind() binds, two models with the same arena and index type share one bind
+        const void* getArena(VeModel::VertexLayout layout) const { return &vertexArenas[static_cast<uint32_t>(layout)]; }
+
+        Stats getStats() const;
+        void report() const;
+
+    private:
+        struct VertexArena{
+            std::unique_ptr<VeBuffer> buffer;
+            //in vertices
+            std::unique_ptr<VeBlockAllocator> allocator;
+            VkDeviceSize attributeOffset{0};
+        };
+        struct PendingRelease{
+            Range range;
+            //graphics timeline value, 0 until the frame the release happened in is submitted
+            uint64_t value;
+        };
+        struct RetiredBuffer{
+            std::unique_ptr<VeBuffer> buffer;
+            //as in PendingRelease
+            uint64_t value;
+        };
+
+        VertexArena& getVertexArena(VeModel::VertexLayout layout);
+        void createIndexArena();
+        void free(const Range& range);
+
+        VeDevice& veDevice;
+        std::array<VertexArena, VeModel::VERTEX_LAYOUT_COUNT> vertexArenas;
+        std::unique_ptr<VeBuffer> indexBuffer;
+        //in bytes, regions are aligned to their index size so firstIndex is a whole number
+        std::unique_ptr<VeBlockAllocator> indexAllocator;
+        std::deque<PendingRelease> pendingReleases;
+        std::deque<RetiredBuffer> retiredBuffers;
+        uint32_t models{0};
+        uint32_t overflows{0};
+    };
+}
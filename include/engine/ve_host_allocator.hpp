@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ve{
+    //VkAllocationCallbacks that count the driver's host allocations by scope and by the engine call that caused them,
+    //optionally serving small ones from per size class free lists instead of the system heap
+    //process wide, enabled once in main before the device exists, every vkCreate/vkDestroy pair then passes the same callbacks
+    //thread safe, drivers may allocate from any thread that calls into them
+    class VeHostAllocator{
+    public:
+        static constexpr uint32_t SCOPE_COUNT = 5;
+        //pooled size classes are 64 << i bytes
+        static constexpr uint32_t POOL_CLASS_COUNT = 5;
+        static constexpr size_t MAX_POOLED_SIZE = size_t{64} << (POOL_CLASS_COUNT - 1);
+
+        struct Counters{
+            uint64_t allocations{0};
+            uint64_t reallocations{0};
+            uint64_t frees{0};
+            uint64_t allocatedBytes{0};
+            //reported through the internal allocation notifications, memory the driver got without the callbacks
+            uint64_t internalAllocations{0};
+            uint64_t poolHits{0};
+            std::array<uint64_t, SCOPE_COUNT> scopeAllocations{};
+            std::array<uint64_t, SCOPE_COUNT> scopeBytes{};
+        };
+        struct Stats{
+            Counters total{};
+            //since the last resetFrame
+            Counters frame{};
+            size_t liveBytes{0};
+            size_t peakBytes{0};
+            //allocations since the last resetFrame by the label active on the allocating thread, "unlabelled" without one
+            std::vector<std::pair<std::string, uint64_t>> frameLabels;
+        };
+
+        //names the engine call allocations on this thread belong to, for the duration of the scope
+        class Label{
+        public:
+            explicit Label(const char* name);
+            ~Label();
+            Label(const Label&) = delete;
+            Label& operator=(const Label&) = delete;
+        private:
+            const char* previous;
+        };
+
+        //pooled routes allocations up to MAX_POOLED_SIZE through the free lists, must be called before the device is created
+        static void enable(bool pooled);
+        //null while disabled, so callers can pass it unconditionally
+        static const VkAllocationCallbacks* getCallbacks();
+        static bool isEnabled() { return instance != nullptr; }
+        static Stats getStats();
+        static void resetFrame();
+        static const char* getScopeName(uint32_t scope);
+        static void report();
+
+    private:
+        struct Header;
+
+        explicit VeHostAllocator(bool pooled);
+        void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void free(void* memory);
+        void count(size_t size, VkSystemAllocationScope scope, bool pooledHit);
+
+        static void* VKAPI_PTR allocationFunction(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static void* VKAPI_PTR reallocationFunction(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static void VKAPI_PTR freeFunction(void* userData, void* memory);
+        static void VKAPI_PTR internalAllocationNotification(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+        static void VKAPI_PTR internalFreeNotification(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+        static VeHostAllocator* instance;
+
+        VkAllocationCallbacks callbacks{};
+        bool pooled;
+        std::mutex mutex;
+        //blocks of one size class handed back by free, reused before the system heap is asked again
+        std::array<std::vector<Header*>, POOL_CLASS_COUNT> freeLists;
+        Counters total{};
+        Counters frame{};
+        size_t liveBytes{0};
+        size_t peakBytes{0};
+        //allocations since resetFrame per label, keys stay once seen so steady state frames never insert
+        std::unordered_map<const char*, uint64_t> frameLabels;
+    };
+}
@@ -14,8 +14,8 @@
 namespace ve{
     class VeImGui{
         public:
-        static VkDescriptorPool createDescriptorPool(VkDevice device);
-        static VkRenderPass createRenderPass(VkDevice device, VkFormat imageFormat, VkFormat depthFormat);
+        static VkDescriptorPool createDescriptorPool(VeDevice& veDevice);
+        static VkRenderPass createRenderPass(VeDevice& veDevice, VkFormat imageFormat, VkFormat depthFormat);
         static void createImGuiContext( VeDevice& veDevice, VeWindow& veWindow, VkDescriptorPool imGuiPool, VkRenderPass renderPass, int imageCount);
         static void initializeImGuiFrame();
         static void renderImGuiFrame(VkCommandBuffer commandBuffer);
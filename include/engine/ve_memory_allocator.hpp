@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ve{
+    //what an allocation is used for, only for accounting
+    enum class VeMemoryCategory : uint32_t{ MESH, TEXTURE, SHADOW, RENDER_TARGET, STAGING, UNIFORM, OTHER };
+    constexpr uint32_t MEMORY_CATEGORY_COUNT = 7;
+    const char* getMemoryCategoryName(VeMemoryCategory category);
+
+    //one sub-allocation, what VeDevice::createBuffer and createImageWithInfo hand out instead of a VkDeviceMemory
+    struct VeAllocation{
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+        VkDeviceSize size{0};
+        //persistently mapped pointer to offset, null for memory that is not host visible
+        void* mapped{nullptr};
+        uint32_t memoryType{0};
+        //where the range lives, pool == DEDICATED for memory that owns its own vkAllocateMemory
+        uint32_t pool{0};
+        uint32_t block{0};
+        uint32_t region{0};
+        VeMemoryCategory category{VeMemoryCategory::OTHER};
+
+        static constexpr uint32_t DEDICATED = UINT32_MAX;
+        bool isDedicated() const { return pool == DEDICATED; }
+    };
+
+    //two level segregated fit (TLSF) over one block: constant time allocate and free, neighbouring free ranges are merged
+    //knows nothing about vulkan memory, offsets are relative to the block
+    class VeBlockAllocator{
+    public:
+        static constexpr uint32_t INVALID_REGION = UINT32_MAX;
+
+        explicit VeBlockAllocator(VkDeviceSize capacity);
+
+        //returns the region to free later, INVALID_REGION when no free range can hold size at alignment (a power of two)
+        uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+        void free(uint32_t region);
+
+        VkDeviceSize getCapacity() const { return capacity; }
+        VkDeviceSize getUsed() const { return used; }
+        uint32_t getAllocationCount() const { return allocationCount; }
+        uint32_t getFreeRangeCount() const { return freeRangeCount; }
+        VkDeviceSize getLargestFreeRange() const;
+        bool isEmpty() const { return allocationCount == 0; }
+
+    private:
+        //8 second level classes per power of two, a class never wastes more than 1/8 of a range
+        static constexpr uint32_t SL_BITS = 3;
+        static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+        static constexpr uint32_t FL_COUNT = 64;
+
+        struct Region{
+            VkDeviceSize offset;
+            VkDeviceSize size;
+            //neighbours in address order
+            uint32_t prevPhysical;
+            uint32_t nextPhysical;
+            //neighbours in the free list of the size class, only while free
+            uint32_t prevFree;
+            uint32_t nextFree;
+            bool free;
+        };
+
+        static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+        uint32_t findFree(VkDeviceSize size) const;
+        void insertFree(uint32_t index);
+        void removeFree(uint32_t index);
+        uint32_t newRegion(VkDeviceSize offset, VkDeviceSize size);
+        void releaseRegion(uint32_t index);
+
+        VkDeviceSize capacity;
+        VkDeviceSize used{0};
+        uint32_t allocationCount{0};
+        uint32_t freeRangeCount{0};
+        std::vector<Region> regions;
+        std::vector<uint32_t> unusedRegions;
+        uint64_t flBitmap{0};
+        uint32_t slBitmap[FL_COUNT]{};
+        uint32_t freeHeads[FL_COUNT][SL_COUNT];
+    };
+
+    //per memory type pools of large blocks sub-allocated with VeBlockAllocator, so a scene costs a handful of
+    //vkAllocateMemory calls instead of one per resource. Large resources and render targets get dedicated memory
+    //thread safe, the vulkan calls go through a Backend so the bookkeeping can run against a mocked memory type table
+    class VeMemoryAllocator{
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+        //buffers and linear images vs optimal tiled images, they may only share a bufferImageGranularity page if it is 1
+        enum class ResourceKind{ LINEAR, OPTIMAL };
+        //what happens when a new block or dedicated allocation would take device local memory past the budget
+        enum class BudgetPolicy{ WARN, REFUSE };
+
+        struct Backend{
+            std::function<VkResult(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory)> allocate;
+            std::function<void(VkDeviceMemory memory)> free;
+            //maps the whole allocation, only called for host visible types
+            std::function<void*(VkDeviceMemory memory, VkDeviceSize size)> map;
+        };
+
+        struct Stats{
+            uint32_t blockCount{0};
+            uint32_t emptyBlockCount{0};
+            uint32_t dedicatedCount{0};
+            uint32_t allocationCount{0};
+            uint32_t freeRangeCount{0};
+            VkDeviceSize blockBytes{0};
+            VkDeviceSize usedBytes{0};
+            VkDeviceSize dedicatedBytes{0};
+            VkDeviceSize largestFreeRange{0};
+            //1 - largest free range / free bytes, 0 when all free space in the blocks is one range
+            float fragmentation{0.0f};
+            //vkAllocateMemory calls so far, against allocationCount + dedicatedCount resources
+            uint64_t deviceAllocations{0};
+            //resource bytes by category, sub-allocations and dedicated ones alike
+            std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> categoryBytes{};
+            std::array<uint32_t, MEMORY_CATEGORY_COUNT> categoryCounts{};
+            //device memory held per heap, blocks including their free space plus dedicated allocations
+            std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytes{};
+            VkDeviceSize deviceLocalBytes{0};
+        };
+
+        VeMemoryAllocator(const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize bufferImageGranularity,
+                          VkDeviceSize nonCoherentAtomSize, Backend backend);
+        ~VeMemoryAllocator();
+        VeMemoryAllocator(const VeMemoryAllocator&) = delete;
+        VeMemoryAllocator& operator=(const VeMemoryAllocator&) = delete;
+
+        static Backend createVulkanBackend(VkDevice device, const VkAllocationCallbacks* allocationCallbacks = nullptr);
+
+        //throws when the memory type is exhausted, or when the budget would be exceeded under BudgetPolicy::REFUSE
+        VeAllocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryType, ResourceKind kind, bool dedicated = false,
+                              VeMemoryCategory category = VeMemoryCategory::OTHER);
+        void free(VeAllocation& allocation);
+
+        Stats getStats() const;
+        void report() const;
+        VkDeviceSize getBlockSize(uint32_t memoryType) const { return blockSizes[memoryType]; }
+        VkMemoryPropertyFlags getMemoryTypeFlags(uint32_t memoryType) const { return memoryProperties.memoryTypes[memoryType].propertyFlags; }
+        VkDeviceSize getNonCoherentAtomSize() const { return nonCoherentAtomSize; }
+        const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+        //caps the device local memory the allocator holds, 0 disables the check
+        void setBudget(VkDeviceSize bytes, BudgetPolicy policy);
+        VkDeviceSize getBudget() const { return budget; }
+
+        //random allocate/free traffic against a mocked table, checks alignment, overlap, granularity and block reuse
+        //and prints how many device allocations it took, returns false on the first violated invariant
+        static bool selfTest(uint32_t operationCount);
+
+    private:
+        struct Block{
+            VkDeviceMemory memory{VK_NULL_HANDLE};
+            void* mapped{nullptr};
+            std::unique_ptr<VeBlockAllocator> allocator;
+        };
+        struct Pool{
+            uint32_t memoryType;
+            std::vector<Block> blocks;
+        };
+
+        uint32_t getPoolIndex(uint32_t memoryType, ResourceKind kind) const;
+        VeAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryType);
+        bool isHostVisible(uint32_t memoryType) const;
+        //called before every vkAllocateMemory, throws or warns when the budget would be exceeded
+        void checkBudget(uint32_t memoryType, VkDeviceSize size);
+        void addDeviceMemory(uint32_t memoryType, VkDeviceSize size);
+        void removeDeviceMemory(uint32_t memoryType, VkDeviceSize size);
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize bufferImageGranularity;
+        VkDeviceSize nonCoherentAtomSize;
+        Backend backend;
+        std::vector<VkDeviceSize> blockSizes;
+        //one pool per memory type, two when linear and optimal resources have to be kept apart
+        std::vector<Pool> pools;
+        bool separateKinds;
+        uint32_t dedicatedCount{0};
+        VkDeviceSize dedicatedBytes{0};
+        uint64_t deviceAllocations{0};
+        std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> categoryBytes{};
+        std::array<uint32_t, MEMORY_CATEGORY_COUNT> categoryCounts{};
+        std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytes{};
+        VkDeviceSize budget{0};
+        BudgetPolicy budgetPolicy{BudgetPolicy::WARN};
+        //warn once per crossing instead of on every allocation past the budget
+        bool overBudget{false};
+        mutable std::mutex mutex;
+    };
+}
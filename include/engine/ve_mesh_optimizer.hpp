@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ve_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ve{
+    //import-time reordering of a welded triangle list, run on VeModel::Builder before packing
+    //all passes keep the same triangles, only their order and the vertex numbering change
+    class VeMeshOptimizer{
+    public:
+        //fifo size used when reporting, close to the post-transform cache of current desktop gpus
+        static constexpr uint32_t SIMULATED_CACHE_SIZE = 16;
+
+        struct VertexCacheStats{
+            float acmr{0.0f}; //transformed vertices per triangle, 3 is worst, ~0.5 is the limit on regular grids
+            float atvr{0.0f}; //transformed vertices per referenced vertex, 1 is ideal
+        };
+        static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = SIMULATED_CACHE_SIZE);
+
+        //greedy triangle order maximizing post-transform cache reuse (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+        static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+        //cuts the cache-ordered list into clusters whose ACMR stays within threshold of the original and
+        //draws outward facing clusters first so they occlude the rest (Sander et al., "Fast Triangle Reordering")
+        static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<VeModel::Vertex>& vertices, float threshold = 1.05f);
+        //renumbers vertices in first-use order so vertex fetch walks memory linearly, unused vertices move to the end
+        static void optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices);
+    };
+}
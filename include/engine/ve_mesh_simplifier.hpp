@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ve_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ve{
+    //quadric error edge collapse (Garland-Heckbert, with Hoppe's attribute quadrics for normals and uvs)
+    //vertices only ever collapse onto other existing vertices, so every level of detail is just another
+    //index list over the model's one vertex buffer
+    class VeMeshSimplifier{
+    public:
+        //collapses edges in order of increasing error until the list has at most targetIndexCount indices or the next
+        //collapse would exceed targetError (relative to the mesh extent)
+        //vertices on open borders and attribute seams never move, so outlines and uv islands stay intact
+        //error receives the largest error committed, in model space units
+        static std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const std::vector<VeModel::Vertex>& vertices,
+                                              size_t targetIndexCount, float targetError, float& error);
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace ve{
+    //a run of consecutive triangles in a model's index buffer, small enough to be culled on its own
+    //bounds and cone are in model space
+    struct Meshlet{
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t vertexCount;
+        float radius;
+        glm::vec3 center;
+        //every triangle faces away from cameras for which dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+        //coneCutoff > 1 marks a cone too wide to ever cull
+        float coneCutoff;
+        glm::vec3 coneAxis;
+        glm::vec3 coneApex;
+    };
+
+    class VeMeshlets{
+    public:
+        static constexpr uint32_t MAX_VERTICES = 64;
+        static constexpr uint32_t MAX_TRIANGLES = 124;
+
+        struct Frustum{
+            glm::vec4 planes[6];
+            //expects a zero-to-one depth projection
+            static Frustum fromMatrix(const glm::mat4& viewProjection);
+            bool intersectsSphere(const glm::vec3& center, float radius) const;
+        };
+        struct DrawRange{
+            uint32_t firstIndex;
+            uint32_t indexCount;
+        };
+        struct CullStats{
+            uint32_t clusters{0};
+            uint32_t frustumCulled{0};
+            uint32_t backfaceCulled{0};
+            uint32_t drawRanges{0};
+            float culledRatio() const { return clusters ? static_cast<float>(frustumCulled + backfaceCulled) / clusters : 0.0f; }
+            void add(const CullStats& other);
+        };
+
+        //splits the (already cache ordered) triangle list into meshlets without reordering it
+        static std::vector<Meshlet> build(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions);
+        //appends the surviving clusters as index ranges, adjacent survivors are merged into one range
+        //coneCulling is only valid for pipelines that cull back faces, a double sided pipeline would lose visible triangles
+        static CullStats cull(const std::vector<Meshlet>& meshlets, const glm::mat4& modelMatrix, const Frustum& frustum,
+                              const glm::vec3& cameraPosition, bool coneCulling, std::vector<DrawRange>& ranges);
+        //same for a slice of a meshlet table, e.g. the clusters of one submesh
+        static CullStats cull(const Meshlet* meshlets, size_t meshletCount, const glm::mat4& modelMatrix, const Frustum& frustum,
+                              const glm::vec3& cameraPosition, bool coneCulling, std::vector<DrawRange>& ranges);
+        //cpu only: culling ratios seen from the six axis directions around the meshlets' bounds
+        static void report(const std::vector<Meshlet>& meshlets);
+    };
+}
@@ -4,6 +4,8 @@
 #include "skeleton.hpp"
 #include "animation_manager.hpp"
 #include "buffer.hpp"
+#include "ve_upload_context.hpp"
+#include "ve_meshlet.hpp"
 
 #include <tiny_gltf.h>
 #define GLM_FORCE_RADIANS
@@ -18,15 +20,30 @@
 #endif
 
 namespace ve{
+    class VeGeometryHeap;
+    class VeFrameRing;
 
     class VeModel{
     public:
+        //gpu vertex layouts, FULL keeps Vertex's float attributes and the packed layouts quantize them at load time
+        //every layout is split into two streams: binding 0 holds what depth-only passes read (position and skin),
+        //binding 1 the shading attributes (color, normal, uv, tangent)
+        enum class VertexLayout : uint32_t{
+            FULL = 0,           //44 + 48 bytes, FullPosition + FullAttributes
+            PACKED_SKINNED = 1, //16 + 16 bytes, PackedSkinnedPosition + PackedAttributes
+            PACKED_STATIC = 2,  //8 + 16 bytes, PackedPosition + PackedAttributes
+            AUTO = 3,           //resolved per model by chooseVertexLayout
+        };
+        static constexpr uint32_t VERTEX_LAYOUT_COUNT = 3;
+        static constexpr uint32_t POSITION_BINDING = 0;
+        static constexpr uint32_t ATTRIBUTE_BINDING = 1;
+
         struct Vertex{
             glm::vec3 position;
             glm::vec3 color;
             glm::vec3 normal;
             glm::vec2 uv;
-            glm::vec3 tangent;
+            glm::vec4 tangent; //w is the handedness, bitangent = w * cross(normal, tangent)
             glm::ivec4 jointIndices;
             glm::vec4 jointWeights;
 
@@ -38,11 +55,70 @@ namespace ve{
                         color == other.color && 
                         normal == other.normal && 
                         uv == other.uv &&
+                        tangent == other.tangent &&
                         jointIndices == other.jointIndices &&
                         jointWeights == other.jointWeights;
             }
         };
 
+        struct FullPosition{
+            glm::vec3 position;
+            glm::ivec4 jointIndices;
+            glm::vec4 jointWeights;
+        };
+        struct FullAttributes{
+            glm::vec3 color;
+            glm::vec3 normal;
+            glm::vec2 uv;
+            glm::vec4 tangent;
+        };
+        //half position, w = 1
+        struct PackedPosition{
+            uint16_t position[4];
+        };
+        //half position, uint8 joints, unorm8 weights summing to 255
+        struct PackedSkinnedPosition{
+            uint16_t position[4];
+            uint8_t jointIndices[4];
+            uint8_t jointWeights[4];
+        };
+        //unorm8 color, octahedral snorm16 normal/tangent, half uv
+        //color's alpha byte is otherwise unused and carries the tangent handedness (0 = -1, 255 = +1)
+        struct PackedAttributes{
+            uint8_t color[4];
+            int16_t normal[2];
+            uint16_t uv[2];
+            int16_t tangent[2];
+        };
+
+        struct Bounds{
+            glm::vec3 min{0.0f};
+            glm::vec3 max{0.0f};
+        };
+
+        //a level of detail is a range of the shared index buffer, LOD 0 is the full mesh at firstIndex 0
+        static constexpr uint32_t MAX_LODS = 4;
+        struct Lod{
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            float error; //simplification error in model space units, 0 for LOD 0
+        };
+
+        //one glTF primitive (or the whole mesh for other formats) within one level of detail
+        //every level has the same submeshes in the same order, only the index ranges differ
+        static constexpr int32_t NO_MATERIAL = -1;
+        struct Submesh{
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset; //added to every index, 0 while all submeshes share one welded vertex range
+            int32_t materialId;   //index into the material table or NO_MATERIAL
+            uint32_t firstMeshlet; //LOD 0 only, meshlets never straddle two submeshes
+            uint32_t meshletCount;
+        };
+        struct Material{
+            glm::vec4 baseColorFactor{1.0f};
+        };
+
         static constexpr int CUBE_MAP_VERTEX_COUNT = 36;
         struct Builder{
             std::vector<Vertex> vertices;
@@ -51,28 +127,167 @@ namespace ve{
             void loadModel(const std::string& filePath);
             void loadModelGLTF(const std::string& filePath);
             void loadCubeMap(glm::vec3 cubeVetices[CUBE_MAP_VERTEX_COUNT]);
+            //dispatches to loadModelGLTF or loadModel by extension
+            void loadFromFile(const std::string& filePath);
+            //import-time vertex cache, overdraw and vertex fetch ordering, keeps ACMR/ATVR before and after in optimizeStats
+            void optimize();
+            //prints optimizeStats, the import runs on loader workers and reports from the main thread
+            void reportOptimize() const;
+            //splits the final index order into meshlets, run after optimize so clusters follow the cache order
+            void buildMeshlets();
+            //appends up to MAX_LODS - 1 simplified index lists after the full mesh, run after buildMeshlets
+            void buildLods();
+            //per-vertex tangents with handedness from positions, uvs and normals, the loaders run it before returning
+            void generateTangents();
+            Bounds computeBounds() const;
+            std::vector<Meshlet> meshlets;
+            std::vector<Lod> lods;
+            //LOD 0 entries first, buildLods appends one full set per coarser level
+            std::vector<Submesh> submeshes;
+            std::vector<Material> materials;
+            //the source has a skin or JOINTS_0, whatever the weights turned out to be
+            bool skinned{false};
+            struct OptimizeStats{
+                uint32_t triangles{0};
+                float acmrBefore{0.0f};
+                float acmrAfter{0.0f};
+                float atvrBefore{0.0f};
+                float atvrAfter{0.0f};
+            };
+            //zero triangles until optimize ran
+            OptimizeStats optimizeStats{};
         };
 
-        VeModel(VeDevice& device, const VeModel::Builder& builder);
+        //vertices and indices already encoded for the gpu, either packed from a Builder or mapped from the model cache
+        //vertexData holds the position stream followed by the attribute stream at getAttributeStreamOffset
+        //vertexData/indexData point into the storage vectors when packGeometry produced them
+        struct PackedGeometry{
+            VertexLayout layout{VertexLayout::FULL};
+            VkIndexType indexType{VK_INDEX_TYPE_UINT32};
+            const void* vertexData{nullptr};
+            uint32_t vertexCount{0};
+            const void* indexData{nullptr};
+            uint32_t indexCount{0};
+            Bounds bounds{};
+            const Meshlet* meshlets{nullptr};
+            uint32_t meshletCount{0};
+            const Lod* lods{nullptr};
+            uint32_t lodCount{0};
+            const Submesh* submeshes{nullptr};
+            uint32_t submeshCount{0}; //over all levels of detail
+            const Material* materials{nullptr};
+            uint32_t materialCount{0};
+            std::vector<uint8_t> vertexStorage;
+            std::vector<uint8_t> indexStorage;
+        };
+
+        VeModel(VeDevice& device, const VeModel::Builder& builder, VertexLayout layout = VertexLayout::FULL);
+        VeModel(VeDevice& device, const PackedGeometry& geometry);
         ~VeModel();
         VeModel(const VeModel&) = delete;
         VeModel& operator=(const VeModel&) = delete;
 
-        static std::unique_ptr<VeModel> createModelFromFile(VeDevice& device, const std::string& filePath);
-        static std::unique_ptr<VeModel> createCubeMap(VeDevice& device, glm::vec3 cubeVetices[CUBE_MAP_VERTEX_COUNT]);
+        static std::unique_ptr<VeModel> createModelFromFile(VeDevice& device, const std::string& filePath, VertexLayout layout = VertexLayout::AUTO);
+        //recorded into uploadContext, draw it only once that batch has completed
+        static std::unique_ptr<VeModel> createCubeMap(VeDevice& device, VeUploadContext& uploadContext, glm::vec3 cubeVetices[CUBE_MAP_VERTEX_COUNT]);
+        //what bind() leaves bound, consecutive models with equal keys can skip binding
+        struct BindingKey{
+            const void* geometry{nullptr};
+            VkIndexType indexType{VK_INDEX_TYPE_UINT32};
+            bool operator==(const BindingKey& other) const { return geometry == other.geometry && indexType == other.indexType; }
+            bool operator!=(const BindingKey& other) const { return !(*this == other); }
+        };
+        //where a model lives inside a VeGeometryHeap, firstVertex is its vertexOffset and firstIndex counts its own index type
+        struct GeometryRange{
+            VertexLayout layout{VertexLayout::FULL};
+            uint32_t vertexRegion{VeBlockAllocator::INVALID_REGION};
+            uint32_t indexRegion{VeBlockAllocator::INVALID_REGION};
+            uint32_t firstVertex{0};
+            uint32_t firstIndex{0};
+        };
         void bind(VkCommandBuffer commandBuffer);
+        //binds only the position (+skin) stream, for pipelines built from getPositionBindingDescriptions
+        void bindPositions(VkCommandBuffer commandBuffer);
+        //the shared arena for models in a VeGeometryHeap, the model itself otherwise
+        BindingKey getBindingKey() const;
+        bool isInGeometryHeap() const { return geometryHeap != nullptr; }
         void draw(VkCommandBuffer commandBuffer);
         void drawInstanced(VkCommandBuffer commandBuffer, uint32_t instanceCount);
-        void updateAnimation(float deltaTime, int frameCounter, int frameIndex);
+        //draws part of the index buffer, e.g. the ranges VeMeshlets::cull left standing
+        void drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t count, int32_t vertexOffset = 0);
+        void drawLod(VkCommandBuffer commandBuffer, uint32_t lod);
+        void drawSubmesh(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t submesh);
+        //one draw per submesh of lod in material order, bindMaterial(materialId) runs before the first submesh of every material
+        //takes the callable as is, wrapping the per object lambda in a std::function would heap allocate every frame
+        template<typename Fn>
+        void drawSubmeshes(VkCommandBuffer commandBuffer, uint32_t lod, Fn&& bindMaterial){
+            bool first = true;
+            int32_t boundMaterial = NO_MATERIAL;
+            for(uint32_t submesh: materialOrder){
+                int32_t material = getSubmesh(lod, submesh).materialId;
+                if(first || material != boundMaterial){
+                    bindMaterial(material);
+                    boundMaterial = material;
+                    first = false;
+                }
+                drawSubmesh(commandBuffer, lod, submesh);
+            }
+        }
+        //advances the clip and pushes this frame's joint palette into frameRing, bind it at getJointPaletteOffset
+        //once per frameCounter, objects sharing the model all draw with the first call's palette
+        void updateAnimation(float deltaTime, int frameCounter, VeFrameRing& frameRing);
+        uint32_t getJointPaletteOffset() const { return jointPaletteOffset; }
         AnimationManager& getAnimationManager() { return *animationManager.get(); }
+        const Bounds& getBounds() const { return bounds; }
+        //cluster table in model space, empty for models without an index buffer
+        const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+        bool isAnimated() const { return hasAnimation; }
+        //at least LOD 0 for indexed models, coarser levels follow in increasing error
+        const std::vector<Lod>& getLods() const { return lods; }
+        //submeshes per level of detail, at least one for indexed models
+        uint32_t getSubmeshCount() const { return submeshCount; }
+        const Submesh& getSubmesh(uint32_t lod, uint32_t submesh) const { return submeshes[lod * submeshCount + submesh]; }
+        //submesh indices sorted by material id, the same for every level of detail
+        const std::vector<uint32_t>& getMaterialOrder() const { return materialOrder; }
+        const std::vector<Material>& getMaterials() const { return materials; }
+        VertexLayout getVertexLayout() const { return vertexLayout; }
+        VkIndexType getIndexType() const { return indexType; }
+        VkDeviceSize getGeometryBytes() const;
+
+        static uint32_t getPositionStride(VertexLayout layout);
+        static uint32_t getAttributeStride(VertexLayout layout);
+        static uint32_t getVertexStride(VertexLayout layout);
+        static VkDeviceSize getAttributeStreamOffset(VertexLayout layout, uint32_t vertexCount);
+        static VkDeviceSize getVertexDataSize(VertexLayout layout, uint32_t vertexCount);
+        static const char* getVertexLayoutName(VertexLayout layout);
+        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexLayout layout);
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexLayout layout);
+        //binding 0 only, for depth and shadow pipelines
+        static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(VertexLayout layout);
+        static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions(VertexLayout layout);
+        //smallest layout that represents the builder's vertices without visible loss
+        static VertexLayout chooseVertexLayout(const Builder& builder, const Bounds& bounds);
+        //packed layouts store joint indices in 8 bits
+        static bool jointIndicesFitPacked(const Builder& builder);
+        //16 bit indices whenever every vertex is addressable with them
+        static VkIndexType chooseIndexType(uint32_t vertexCount);
+        static PackedGeometry packGeometry(const Builder& builder, VertexLayout layout);
+        //prints the triangle count and error of every level, buildLods runs on loader workers and stays quiet
+        static void reportLods(const Lod* lods, uint32_t lodCount);
 
         std::unique_ptr<Skeleton> skeleton;
         std::shared_ptr<AnimationManager> animationManager;
-        std::vector<std::unique_ptr<VeBuffer>> shaderJointsBuffer;
+        //jointMatrices array size of the skinned vertex shaders, the descriptor range of a joint palette
+        static constexpr uint32_t MAX_SHADER_JOINTS = 100;
 
     private:
-        void createVertexBuffers(const std::vector<Vertex>& vertices);
-        void createIndexBuffers(const std::vector<uint32_t>& indices);  
+        friend class VeModelLoader;
+        explicit VeModel(VeDevice& device);
+        //records the buffer copies into uploadContext, the geometry may be released as soon as this returns
+        //geometryHeap is tried first, the model falls back to its own buffers when it is null or full
+        void upload(const PackedGeometry& geometry, VeUploadContext& uploadContext, VeGeometryHeap* geometryHeap = nullptr);
+        void createVertexBuffers(const void* vertices, VertexLayout layout, uint32_t count, VeUploadContext& uploadContext);
+        void createIndexBuffers(const void* indices, VkIndexType type, uint32_t count, VeUploadContext& uploadContext);
         void loadSkeleton(const tinygltf::Model& model);
         void loadAnimations(const tinygltf::Model& model);
         void loadJoints(int nodeIndex, int parentIndex, const tinygltf::Model& model);
@@ -83,13 +298,33 @@ namespace ve{
         //attributes
         VeDevice& veDevice;
         //vertex buffer
+        //both streams live in one buffer, the attribute stream starts at attributeStreamOffset
         std::unique_ptr<VeBuffer> vertexBuffer;
+        VkDeviceSize attributeStreamOffset{0};
         uint32_t vertexCount;
+        VertexLayout vertexLayout{VertexLayout::FULL};
+        //set when the geometry lives in the heap instead of vertexBuffer/indexBuffer, draws then add the range's offsets
+        VeGeometryHeap* geometryHeap{nullptr};
+        GeometryRange heapRange{};
+        //the heap the model did not fit into, it keeps vertexBuffer/indexBuffer alive past the model for the frames still reading them
+        VeGeometryHeap* retireHeap{nullptr};
         //index buffer
         bool hasIndexBuffer{false};
         std::unique_ptr<VeBuffer> indexBuffer;
         uint32_t indexCount;
+        VkIndexType indexType{VK_INDEX_TYPE_UINT32};
+        Bounds bounds{};
+        std::vector<Meshlet> meshlets;
+        std::vector<Lod> lods;
+        std::vector<Submesh> submeshes;
+        uint32_t submeshCount{0};
+        std::vector<uint32_t> materialOrder;
+        std::vector<Material> materials;
         //animation data
         bool hasAnimation{false};
+        //dynamic offset of the palette written by the last updateAnimation
+        uint32_t jointPaletteOffset{0};
+        //frameCounter of the last updateAnimation
+        int paletteFrame{-1};
     };
 }
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ve_model.hpp"
+#include "skeleton.hpp"
+#include "animation_manager.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ve{
+    //read-only view of a whole file mapped into the address space
+    class MappedFile{
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const { return mappedData != nullptr; }
+        const uint8_t* data() const { return mappedData; }
+        size_t size() const { return mappedSize; }
+
+    private:
+        const uint8_t* mappedData{nullptr};
+        size_t mappedSize{0};
+#ifdef _WIN32
+        void* fileHandle{nullptr};
+        void* mappingHandle{nullptr};
+#endif
+    };
+
+    //on-disk cache of fully processed meshes (welded vertices, indices and LODs, tangents, meshlets, submeshes, materials, skeleton, clips, bounds)
+    //vertices and indices are stored already packed for the gpu in the layout the entry was built for
+    //entries live in assets/cache, are named after the source path and requested layout and validated against the source content hash
+    class VeModelCache{
+    public:
+        //bump VERSION whenever VeModel::Vertex, a vertex layout/stream split, the layout choice or the blob layout below changes
+        static constexpr uint32_t MAGIC = 0x4D434556; // "VECM"
+        static constexpr uint32_t VERSION = 8;
+        static constexpr uint32_t FLAG_SKELETON = 1u << 0;
+        static constexpr uint32_t FLAG_ANIMATIONS = 1u << 1;
+
+        struct Header{
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceHash;
+            uint32_t vertexLayout;
+            uint32_t vertexStride;
+            uint32_t indexType;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint32_t flags;
+            float boundsMin[3];
+            float boundsMax[3];
+            uint64_t vertexOffset;
+            uint64_t indexOffset;
+            uint64_t meshletOffset;
+            uint32_t meshletCount;
+            uint32_t lodCount;
+            uint64_t lodOffset;
+            uint64_t submeshOffset;
+            uint32_t submeshCount;
+            uint32_t materialCount;
+            uint64_t materialOffset;
+            uint64_t skinOffset;
+            uint64_t skinSize;
+        };
+
+        //a mapped cache entry, geometry points straight into the mapping
+        struct Entry{
+            MappedFile file;
+            const Header* header{nullptr};
+            VeModel::PackedGeometry geometry{};
+            std::unique_ptr<Skeleton> skeleton;
+            std::shared_ptr<AnimationManager> animationManager;
+        };
+
+        static bool load(const std::string& filePath, VeModel::VertexLayout layout, Entry& entry);
+        static bool store(const std::string& filePath, VeModel::VertexLayout layout, const VeModel::PackedGeometry& geometry, const VeModel& model);
+        static std::string cacheFilePath(const std::string& filePath, VeModel::VertexLayout layout);
+        static uint64_t hashSource(const std::string& filePath);
+    };
+}
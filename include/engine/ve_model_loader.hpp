@@ -0,0 +1,134 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "ve_model.hpp"
+#include "ve_model_cache.hpp"
+#include "ve_geometry_heap.hpp"
+#include "ve_upload_context.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ve{
+    //cpu half of a model load: parsed (or cache mapped) geometry and a VeModel that already owns
+    //skeleton and clips but no gpu buffers, safe to build on any thread
+    struct ModelImport{
+        std::string filePath;
+        const char* source{"cache (warm)"};
+        std::chrono::high_resolution_clock::time_point start;
+        VeModelCache::Entry cached{};
+        VeModel::Builder builder{};
+        //points into cached or builder
+        VeModel::PackedGeometry geometry{};
+        std::unique_ptr<VeModel> model;
+        //a cold import could not write its cache entry, reported with the rest once the import is finished
+        bool cacheStoreFailed{false};
+    };
+
+    //what VeModelLoader::load hands out, resolves once the model's upload has finished on the gpu
+    //an evicted handle drops its model and goes back to LOADING once reload() is asked for it
+    class VeModelHandle{
+    public:
+        enum class State{ LOADING, READY, FAILED, EVICTED };
+
+        State getState() const { return state.load(std::memory_order_acquire); }
+        bool isResolved() const { return getState() != State::LOADING; }
+        //the loaded model once ready, the loader's placeholder while loading or after a failure
+        std::shared_ptr<VeModel> get() const { return getState() == State::READY ? model : placeholder; }
+        const std::string& getFilePath() const { return filePath; }
+        const std::string& getError() const { return error; }
+        //bumped whenever get() starts returning a different model, main thread only
+        uint32_t getGeneration() const { return generation; }
+
+    private:
+        friend class VeModelLoader;
+        std::atomic<State> state{State::LOADING};
+        std::string filePath;
+        std::string error;
+        VeModel::VertexLayout layout{VeModel::VertexLayout::AUTO};
+        uint32_t generation{0};
+        std::shared_ptr<VeModel> model;
+        std::shared_ptr<VeModel> placeholder;
+    };
+
+    //parses models on worker threads and uploads them without waiting on the graphics queue
+    //load() never blocks, update() must be called once per frame from the thread that submits frames
+    class VeModelLoader{
+    public:
+        static constexpr uint32_t DEFAULT_WORKER_COUNT = 2;
+
+        //uploads are recorded into uploadContext, one submission per update() however many imports finished
+        //loaded models are placed in geometryHeap when it is set and has room, the heap has to outlive them
+        VeModelLoader(VeDevice& device, VeUploadContext& uploadContext, VeGeometryHeap* geometryHeap = nullptr,
+                      uint32_t workerCount = DEFAULT_WORKER_COUNT);
+        ~VeModelLoader();
+        VeModelLoader(const VeModelLoader&) = delete;
+        VeModelLoader& operator=(const VeModelLoader&) = delete;
+
+        //requests for a path and layout that is still loading share one handle
+        std::shared_ptr<VeModelHandle> load(const std::string& filePath, VeModel::VertexLayout layout = VeModel::VertexLayout::AUTO);
+        //submits uploads for finished imports and resolves handles whose upload batch has completed
+        void update();
+        //blocks until handle resolves, only for startup code that cannot proceed without the model
+        void wait(const VeModelHandle& handle);
+        //drops a READY handle's model, the caller makes sure no frame in flight still draws it
+        void evict(VeModelHandle& handle);
+        //queues an EVICTED handle again, it resolves like a fresh load (from the model cache when it has the entry)
+        void reload(const std::shared_ptr<VeModelHandle>& handle);
+        size_t getPendingCount() const;
+        const std::shared_ptr<VeModel>& getPlaceholder() const { return placeholder; }
+
+        //the two halves of VeModel::createModelFromFile, importModel runs on the workers and prints nothing
+        static std::unique_ptr<ModelImport> importModel(VeDevice& device, const std::string& filePath, VeModel::VertexLayout layout);
+        //records the buffer copies into uploadContext, the model may be drawn once that batch has completed
+        //reports the import, update() calls it on the main thread
+        static std::unique_ptr<VeModel> finishImport(ModelImport& import, VeUploadContext& uploadContext, VeGeometryHeap* geometryHeap = nullptr);
+
+    private:
+        struct Job{
+            std::shared_ptr<VeModelHandle> handle;
+            VeModel::VertexLayout layout;
+        };
+        struct Imported{
+            std::shared_ptr<VeModelHandle> handle;
+            std::unique_ptr<ModelImport> import;
+            std::string error;
+        };
+        struct Upload{
+            std::shared_ptr<VeModelHandle> handle;
+            std::unique_ptr<VeModel> model;
+            VeUploadContext::Ticket ticket{0};
+            std::chrono::high_resolution_clock::time_point start;
+        };
+
+        void workerLoop();
+        void createPlaceholder();
+        void recordUpload(Imported& result);
+        void resolve(const std::shared_ptr<VeModelHandle>& handle, VeModelHandle::State state);
+        static std::string requestKey(const std::string& filePath, VeModel::VertexLayout layout);
+
+        VeDevice& veDevice;
+        VeUploadContext& uploadContext;
+        VeGeometryHeap* geometryHeap;
+        std::shared_ptr<VeModel> placeholder;
+        //shared with the workers
+        mutable std::mutex mutex;
+        std::condition_variable jobAvailable;
+        std::condition_variable importFinished;
+        std::deque<Job> jobs;
+        std::vector<Imported> imported;
+        bool stopping{false};
+        std::vector<std::thread> workers;
+        //main thread only
+        std::vector<Upload> uploads;
+        std::unordered_map<std::string, std::shared_ptr<VeModelHandle>> inFlight;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "ve_device.hpp"
+#include "ve_upload_context.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -12,7 +13,8 @@
 namespace ve{
     class VeNormal{
         public:
-            VeNormal(VeDevice& device, const std::string& normalPath); 
+            //the image is recorded into uploadContext, it is only safe to sample once that batch has completed
+            VeNormal(VeDevice& device, VeUploadContext& uploadContext, const std::string& normalPath); 
             ~VeNormal();
             VeNormal(const VeNormal&) = delete;
             VeNormal& operator=(const VeNormal&) = delete;
@@ -22,16 +24,16 @@ namespace ve{
 
             VkImageView getNormalImageView() const { return normalImageView; }
             VkSampler getNormalSampler() const { return normalSampler; }
+            //device memory of the image, mips included
+            VkDeviceSize getMemorySize() const { return normalImageMemory.size; }
             VkImageLayout getLayout() const { return textureLayout; } // same for both albedo and normal
         private:
-            void createTextureImageNormal(VkFormat textureFormat, const std::string& path);
-            void transitionImageLayoutNormal(VkImageLayout oldLayout, VkImageLayout newLayout, int mipLevels);
-            void generateMipMapsNormal(int mipLevels, int texWidth, int texHeight, VkFormat textureFormat);
+            void createTextureImageNormal(VeUploadContext& uploadContext, VkFormat textureFormat, const std::string& path);
             VeDevice& veDevice;
 
             //normal map
             VkImage normalImage;
-            VkDeviceMemory normalImageMemory;
+            VeAllocation normalImageMemory{};
             VkSampler normalSampler;
             VkImageView normalImageView;
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace ve{
+    struct ParallelRange{
+        size_t begin;
+        size_t end;
+    };
+
+    inline unsigned int workerThreadCount(){
+        unsigned int count = std::thread::hardware_concurrency();
+        return count ? count : 1;
+    }
+
+    //split [0, count) into at most workerThreadCount() contiguous ranges
+    //range boundaries are multiples of granularity (e.g. 3 to keep triangles whole), ranges are never smaller than minRangeSize
+    inline std::vector<ParallelRange> splitRanges(size_t count, size_t granularity = 1, size_t minRangeSize = 4096){
+        std::vector<ParallelRange> ranges;
+        if(count == 0){
+            return ranges;
+        }
+        size_t maxRanges = std::max<size_t>(1, std::min<size_t>(workerThreadCount(), count / std::max<size_t>(minRangeSize, 1)));
+        size_t units = (count + granularity - 1) / granularity;
+        size_t unitsPerRange = (units + maxRanges - 1) / maxRanges;
+        for(size_t unit = 0; unit < units; unit += unitsPerRange){
+            size_t begin = unit * granularity;
+            size_t end = std::min(count, (unit + unitsPerRange) * granularity);
+            ranges.push_back({begin, end});
+        }
+        return ranges;
+    }
+
+    //run fn(rangeIndex, range) for every range, the calling thread takes the first one
+    //the first exception thrown by any range is rethrown once all of them have finished
+    template<typename Fn>
+    void parallelFor(const std::vector<ParallelRange>& ranges, Fn&& fn){
+        if(ranges.empty()){
+            return;
+        }
+        std::vector<std::exception_ptr> errors(ranges.size());
+        std::vector<std::thread> workers;
+        workers.reserve(ranges.size() - 1);
+        try{
+            for(size_t i = 1; i < ranges.size(); i++){
+                workers.emplace_back([&, i](){
+                    try{
+                        fn(i, ranges[i]);
+                    }catch(...){
+                        errors[i] = std::current_exception();
+                    }
+                });
+            }
+        }catch(...){
+            //a thread failed to start, the ones already running still reference errors and fn
+            for(auto& worker: workers){
+                worker.join();
+            }
+            throw;
+        }
+        try{
+            fn(size_t{0}, ranges[0]);
+        }catch(...){
+            errors[0] = std::current_exception();
+        }
+        for(auto& worker: workers){
+            worker.join();
+        }
+        for(auto& error: errors){
+            if(error){
+                std::rethrow_exception(error);
+            }
+        }
+    }
+}
@@ -3,6 +3,7 @@
 #include "ve_device.hpp"
 #include "ve_swap_chain.hpp"
 #include "shadow_render_system.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 #include <cassert>
@@ -10,7 +11,8 @@ namespace ve {
     class VeRenderer{
         public:
 
-            VeRenderer(VeWindow& window, VeDevice& device);
+            //framesInFlight is clamped to [1, VeSwapChain::MAX_FRAMES_IN_FLIGHT], fewer lowers latency and more keeps the gpu busier
+            VeRenderer(VeWindow& window, VeDevice& device, int framesInFlight = VeSwapChain::DEFAULT_FRAMES_IN_FLIGHT);
             ~VeRenderer();
             VeRenderer(const VeRenderer&) = delete;
             VeRenderer& operator=(const VeRenderer&) = delete;
@@ -19,13 +21,32 @@ namespace ve {
             VkCommandBuffer beginFrame();
             void endFrame();
             
-            void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+            //SECONDARY_COMMAND_BUFFERS leaves the viewport and scissor to the secondaries, the primary may only execute them then
+            void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
             void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
             void beginShadowRenderPass(VkCommandBuffer commandBuffer, ShadowRenderSystem& shadowRenderSystem, int frameIndex);
             void endShadowRenderPass(VkCommandBuffer commandBuffer, ShadowRenderSystem& shadowRenderSystem, int lightIndex);
 
+            //async compute for the current frame (skinning, culling, light binning), recorded into the frame's own command buffer
+            //and submitted on the device's compute queue, the graphics queue without one, once per frame between beginFrame and endFrame
+            //the frame's graphics submission waits for it at graphicsStage, so the dispatches overlap the raster work before that stage
+            VkCommandBuffer beginComputeCommands();
+            void submitComputeCommands(VkPipelineStageFlags graphicsStage);
+            //the current frame's graphics submission waits for value on the compute timeline, for compute work submitted elsewhere
+            void waitForCompute(uint64_t value, VkPipelineStageFlags graphicsStage);
+
             //getters
             VkRenderPass getSwapChainRenderPass() const { return veSwapChain->getRenderPass(); }
+            //what secondaries recorded for the swap chain render pass of the current frame inherit
+            VkCommandBufferInheritanceInfo getSwapChainInheritanceInfo() const {
+                assert(isFrameStarted && "Cannot get inheritance info when frame not in progress.");
+                VkCommandBufferInheritanceInfo inheritanceInfo{};
+                inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+                inheritanceInfo.renderPass = veSwapChain->getRenderPass();
+                inheritanceInfo.subpass = 0;
+                inheritanceInfo.framebuffer = veSwapChain->getFrameBuffer(static_cast<int>(currentImageIndex));
+                return inheritanceInfo;
+            }
             bool isFrameInProgress() const { return isFrameStarted; }
             VkCommandBuffer getCurrentCommandBuffer() const { 
                 assert(isFrameStarted && "Cannot get command buffer when frame not in progress.");
@@ -35,7 +56,9 @@ namespace ve {
                 assert(isFrameStarted && "Cannot get frame index when frame not in progress.");
                 return currentFrameIndex; 
             }
+            int getFramesInFlight() const { return framesInFlight; }
             float getAspectRatio() const { return veSwapChain->extentAspectRatio(); }
+            VkExtent2D getSwapChainExtent() const { return veSwapChain->getSwapChainExtent(); }
             VkFormat getSwapChainImageFormat() const { return veSwapChain->getSwapChainImageFormat(); }
             VkFormat getSwapChainDepthFormat() const { return veSwapChain->findDepthFormat(); }
 
@@ -48,9 +71,18 @@ namespace ve {
             VeDevice& veDevice;
             std::unique_ptr<VeSwapChain> veSwapChain;
             std::vector<VkCommandBuffer> commandBuffers;
+            //from the device's compute pool, one per frame in flight like the graphics ones
+            std::vector<VkCommandBuffer> computeCommandBuffers;
+            //handed to the frame's graphics submission by endFrame
+            std::array<VeTimeline::Wait, VeSwapChain::MAX_FRAME_WAITS> frameWaits{};
+            uint32_t frameWaitCount{0};
+            //graphics timeline value each frame index was last submitted with, waited for before the index is recorded again
+            std::vector<uint64_t> frameValues;
+            int framesInFlight;
 
             uint32_t currentImageIndex{0};
             int currentFrameIndex{0};
             bool isFrameStarted{false};
+            bool isComputeStarted{false};
     };
 }
\ No newline at end of file
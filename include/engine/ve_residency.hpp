@@ -0,0 +1,128 @@
+#pragma once
+
+#include "ve_model_loader.hpp"
+#include "ve_swap_chain.hpp"
+#include "ve_timeline.hpp"
+#include "ve_upload_context.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ve{
+    //keeps the models and textures the scene may use within a device memory budget
+    //every frame the app touches what it draws, update() then evicts the least recently used assets until the budget holds
+    //and an evicted asset that is touched again is reloaded, drawn with a placeholder (models) or a fallback texture until it is back
+    //an asset is only evicted once the graphics timeline shows every frame that used it has finished, evicted textures are
+    //kept alive until the frames submitted with descriptor sets still pointing at them have finished
+    //main thread only, like VeModelLoader::update
+    class VeResidencyManager{
+    public:
+        static constexpr uint32_t NO_FALLBACK = UINT32_MAX;
+
+        struct TextureData{
+            //the VeTexture or VeNormal behind imageInfo
+            std::shared_ptr<void> owner;
+            VkDescriptorImageInfo imageInfo{};
+            VkDeviceSize bytes{0};
+        };
+        //records the texture's upload into uploadContext, called again for every reload
+        using TextureLoader = std::function<TextureData(VeUploadContext& uploadContext)>;
+
+        struct Stats{
+            //touches of resident assets, and of evicted ones that had to be reloaded
+            uint64_t hits{0};
+            uint64_t misses{0};
+            uint64_t evictions{0};
+            VkDeviceSize evictedBytes{0};
+            VkDeviceSize residentBytes{0};
+            //0 for no budget
+            VkDeviceSize budget{0};
+            //what the last update() could not evict because all of it was used too recently
+            VkDeviceSize overBudgetBytes{0};
+            uint32_t residentModels{0};
+            uint32_t models{0};
+            uint32_t residentTextures{0};
+            uint32_t textures{0};
+        };
+
+        VeResidencyManager(VeModelLoader& modelLoader, VeUploadContext& uploadContext, VeTimeline& timeline, VkDeviceSize budget = 0);
+        VeResidencyManager(const VeResidencyManager&) = delete;
+        VeResidencyManager& operator=(const VeResidencyManager&) = delete;
+
+        void setBudget(VkDeviceSize budget) { stats.budget = budget; }
+        void addModel(const std::shared_ptr<VeModelHandle>& handle);
+        //a pinned model counts against the budget but is never evicted, for models the app reads outside of drawing them
+        void pinModel(const std::shared_ptr<VeModelHandle>& handle);
+        //loads the texture right away, it is sampled once the upload context's next batch has completed
+        //only textures with a fallback can be evicted, the fallback (itself without one) is sampled in their place meanwhile
+        uint32_t addTexture(TextureLoader loader, uint32_t fallback = NO_FALLBACK);
+
+        //once per frame after the previous frame was submitted and before this frame's touches
+        void update();
+        //handles not added yet are tracked from their first touch on
+        void touchModel(const std::shared_ptr<VeModelHandle>& handle);
+        void touchTexture(uint32_t texture);
+
+        const VkDescriptorImageInfo& getImageInfo(uint32_t texture) const;
+        //changes whenever getImageInfo returns something else for any texture, descriptor sets written at an older version are stale
+        uint64_t getTextureVersion() const { return textureVersion; }
+
+        const Stats& getStats() const { return stats; }
+        void report() const;
+
+    private:
+        struct ModelEntry{
+            std::shared_ptr<VeModelHandle> handle;
+            uint64_t lastUsedFrame{0};
+            bool pinned{false};
+        };
+        struct TextureEntry{
+            TextureLoader loader;
+            uint32_t fallback{NO_FALLBACK};
+            TextureData data{};
+            bool resident{false};
+            //recorded but not known to be on the gpu yet, ticket 0 until update() submits the batch
+            bool loading{false};
+            VeUploadContext::Ticket ticket{0};
+            uint64_t lastUsedFrame{0};
+        };
+        struct PendingRelease{
+            std::shared_ptr<void> owner;
+            //graphics timeline value
+            uint64_t value;
+        };
+        struct SubmittedFrame{
+            uint64_t frame;
+            uint64_t value;
+        };
+
+        void loadTexture(TextureEntry& texture);
+        void finishTextureLoads();
+        bool evictLeastRecentlyUsed();
+        //an asset last used at lastUsedFrame is not read by any frame the gpu may still be executing
+        bool isIdle(uint64_t lastUsedFrame) const;
+
+        VeModelLoader& modelLoader;
+        VeUploadContext& uploadContext;
+        VeTimeline& timeline;
+        std::vector<ModelEntry> models;
+        std::unordered_map<const VeModelHandle*, size_t> modelIndices;
+        std::vector<TextureEntry> textures;
+        std::deque<PendingRelease> pendingReleases;
+        //frames whose submission has not completed yet, oldest first at submittedHead
+        //at most every frame in flight plus the one just submitted is pending, so a fixed ring never allocates
+        std::array<SubmittedFrame, VeSwapChain::MAX_FRAMES_IN_FLIGHT + 1> submittedFrames{};
+        size_t submittedHead{0};
+        size_t submittedCount{0};
+        uint64_t frame{0};
+        //every frame up to this one has finished on the gpu
+        uint64_t completedFrame{0};
+        uint64_t textureVersion{0};
+        Stats stats{};
+    };
+}
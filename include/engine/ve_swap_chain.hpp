@@ -13,10 +13,12 @@ namespace ve {
 
 class VeSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+  // frames the cpu may record ahead of the gpu, chosen at startup within [1, MAX_FRAMES_IN_FLIGHT]
+  static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
+  static constexpr int DEFAULT_FRAMES_IN_FLIGHT = 2;
 
-  VeSwapChain(VeDevice &deviceRef, VkExtent2D windowExtent);
-  VeSwapChain(VeDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<VeSwapChain> previous);
+  VeSwapChain(VeDevice &deviceRef, VkExtent2D windowExtent, int framesInFlight);
+  VeSwapChain(VeDevice &deviceRef, VkExtent2D windowExtent, int framesInFlight, std::shared_ptr<VeSwapChain> previous);
   ~VeSwapChain();
 
   VeSwapChain(const VeSwapChain &) = delete;
@@ -36,8 +38,13 @@ class VeSwapChain {
   }
   VkFormat findDepthFormat();
 
-  VkResult acquireNextImage(uint32_t *imageIndex);
-  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+  // frameIndex picks the semaphores, the caller has waited for the frame that last used them
+  VkResult acquireNextImage(int frameIndex, uint32_t *imageIndex);
+  // submits through the device's graphics timeline, the frame's value is its getSubmittedValue() afterwards
+  // waits hand the frame work from other queues, e.g. async compute results, beside the acquired image
+  static constexpr uint32_t MAX_FRAME_WAITS = VeTimeline::MAX_WAITS - 1;
+  VkResult submitCommandBuffers(int frameIndex, const VkCommandBuffer *buffers, uint32_t *imageIndex, uint32_t waitCount = 0,
+                                const VeTimeline::Wait *waits = nullptr);
 
   bool compareSwapFormats(const VeSwapChain &swapChain) const {
     return swapChainImageFormat == swapChain.swapChainImageFormat &&
@@ -69,7 +76,7 @@ class VeSwapChain {
   VkRenderPass renderPass;
 
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
+  std::vector<VeAllocation> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
@@ -80,11 +87,11 @@ class VeSwapChain {
   VkSwapchainKHR swapChain;
   std::shared_ptr<VeSwapChain> oldSwapChain;
 
+  int framesInFlight;
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
-  std::vector<VkFence> inFlightFences;
-  std::vector<VkFence> imagesInFlight;
-  size_t currentFrame = 0;
+  // graphics timeline value of the last frame that rendered to each image, 0 for none
+  std::vector<uint64_t> imageValues;
 };
 
 }  // namespace ve
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ve_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ve{
+    //per-vertex tangent frames: every triangle's uv derivatives are accumulated on its corners and then
+    //Gram-Schmidt orthonormalised against the vertex normal, w receives the handedness (bitangent = w * cross(normal, tangent))
+    //positions, uvs and normals are copied into SoA arrays first so the kernels run 4 (SSE) or 8 (AVX) lanes at a time
+    class VeTangentGenerator{
+    public:
+        enum class Kernel{ SCALAR, SSE, AVX };
+
+        //widest kernel this build was compiled for, AVX needs -mavx (or /arch:AVX) on the engine target
+        static Kernel bestKernel();
+        static bool isKernelAvailable(Kernel kernel);
+        static const char* getKernelName(Kernel kernel);
+
+        //every kernel produces bit identical results, and no result depends on the thread count
+        static void generate(const std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices);
+        static void generate(const std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices, Kernel kernel, bool multithreaded);
+        //runs every available kernel single and multithreaded on a height field of about triangleCount triangles, prints triangles/s
+        static void benchmark(size_t triangleCount);
+    };
+}
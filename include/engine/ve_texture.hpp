@@ -1,5 +1,6 @@
 #pragma once
 #include "ve_device.hpp"
+#include "ve_upload_context.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -12,7 +13,8 @@
 namespace ve{
     class VeTexture{
         public:
-            VeTexture(VeDevice& device, const std::string& albedoPath); 
+            //the image is recorded into uploadContext, it is only safe to sample once that batch has completed
+            VeTexture(VeDevice& device, VeUploadContext& uploadContext, const std::string& albedoPath); 
             ~VeTexture();
             VeTexture(const VeTexture&) = delete;
             VeTexture& operator=(const VeTexture&) = delete;
@@ -21,17 +23,17 @@ namespace ve{
 
             VkImageView getImageView() const { return textureImageView; }
             VkSampler getSampler() const { return textureSampler; }
+            //device memory of the image, mips included
+            VkDeviceSize getMemorySize() const { return textureImageMemory.size; }
 
             VkImageLayout getLayout() const { return textureLayout; } // same for both albedo and normal
         private:
-            void createTextureImage(VkFormat textureFormat, const std::string& path);
-            void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, int mipLevels);
-            void generateMipMaps(int mipLevels, int texWidth, int texHeight, VkFormat textureFormat);
+            void createTextureImage(VeUploadContext& uploadContext, VkFormat textureFormat, const std::string& path);
 
             VeDevice& veDevice;
             //albedo texture map
             VkImage textureImage;
-            VkDeviceMemory textureImageMemory;
+            VeAllocation textureImageMemory{};
             VkSampler textureSampler;
             VkImageView textureImageView;
 
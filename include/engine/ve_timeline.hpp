@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace ve{
+    //one timeline semaphore per queue, every submission through submit() signals the next value, so a single increasing
+    //number orders frames, uploads and the resources they retire: work submitted up to value v is done once v completed
+    //waits and polls never create fences, completed values are cached so repeated polls of old values stay cheap
+    //main thread only, like the queue submissions it wraps
+    class VeTimeline{
+    public:
+        //waits and binary signals a single submission can carry alongside the timeline signal
+        static constexpr uint32_t MAX_WAITS = 4;
+        static constexpr uint32_t MAX_SIGNALS = 4;
+
+        //value is only read for timeline semaphores, binary ones like the swap chain's pass any
+        struct Wait{
+            VkSemaphore semaphore;
+            uint64_t value;
+            VkPipelineStageFlags stage;
+        };
+        struct Stats{
+            uint64_t submissions{0};
+            //host waits that blocked, polls of completed values do not count
+            uint64_t waits{0};
+            float waitMilliseconds{0.0f};
+        };
+
+        VeTimeline(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, VkQueue queue);
+        ~VeTimeline();
+        VeTimeline(const VeTimeline&) = delete;
+        VeTimeline& operator=(const VeTimeline&) = delete;
+
+        //submits the command buffers (none is fine, e.g. to only forward a wait) and returns the value they signal
+        uint64_t submit(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers, uint32_t waitCount = 0, const Wait* waits = nullptr,
+                        uint32_t binarySignalCount = 0, const VkSemaphore* binarySignals = nullptr);
+        //value 0 is complete from the start
+        bool isComplete(uint64_t value);
+        void wait(uint64_t value);
+        uint64_t getCompletedValue();
+        //the value of the newest submission
+        uint64_t getSubmittedValue() const { return submitted; }
+        VkSemaphore getSemaphore() const { return semaphore; }
+        const Stats& getStats() const { return stats; }
+
+    private:
+        VkDevice device;
+        const VkAllocationCallbacks* allocationCallbacks;
+        VkQueue queue;
+        VkSemaphore semaphore;
+        uint64_t submitted{0};
+        uint64_t completed{0};
+        Stats stats{};
+    };
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ve_device.hpp"
+#include "buffer.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ve{
+    //records buffer copies, image copies, layout transitions and mip blits into one command buffer and submits them
+    //through the device's graphics timeline, staging buffers are kept alive until the batch's value completes instead of
+    //waiting for the queue to idle
+    //copies run on the device's transfer queue when it has a dedicated one, ownership is then released to the graphics family
+    //and acquired there in a second submission that waits on the copies' own timeline and also runs the mip blits, so uploads
+    //no longer queue up behind frames
+    //staging data is packed into pooled host visible chunks that go back to the pool when their batch completes,
+    //so steady state uploads create no buffers at all
+    //main thread only, the recorded resources must not be used by a frame before their batch's ticket is complete
+    class VeUploadContext{
+    public:
+        //smallest staging chunk, uploads share a chunk until it is full, larger ones get a chunk of the next power of two
+        static constexpr VkDeviceSize STAGING_CHUNK_BYTES = 4ull * 1024 * 1024;
+        //idle chunks beyond this are destroyed when their batch retires instead of going back to the pool
+        static constexpr VkDeviceSize STAGING_POOL_BYTES = 64ull * 1024 * 1024;
+
+        //the graphics timeline value the batch signals, comparable with frame values, complete once the timeline reached it
+        using Ticket = uint64_t;
+
+        struct Stats{
+            uint64_t submissions{0};
+            uint64_t commands{0};
+            uint64_t stagedBytes{0};
+            //staging chunks created, and the ones taken from the pool instead
+            uint64_t stagingAllocations{0};
+            uint64_t stagingReuses{0};
+            //host waits, the old path paid one per recorded command
+            uint64_t waits{0};
+            float waitMilliseconds{0.0f};
+        };
+
+        explicit VeUploadContext(VeDevice& device);
+        ~VeUploadContext();
+        VeUploadContext(const VeUploadContext&) = delete;
+        VeUploadContext& operator=(const VeUploadContext&) = delete;
+
+        //copies data into a staging buffer right away, so data may be freed as soon as this returns
+        void uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+        //fills mip 0 of layerCount tightly packed layers, the image has to be in TRANSFER_DST_OPTIMAL
+        void uploadImage(const void* data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount = 1);
+        void transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount = 1);
+        //blits mip 0 down the chain, expects every level in TRANSFER_DST_OPTIMAL and leaves them all SHADER_READ_ONLY_OPTIMAL
+        void generateMipMaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mipLevels, uint32_t layerCount = 1);
+
+        //submits everything recorded since the last submit, returns the ticket of the newest batch (even if nothing was recorded)
+        Ticket submit();
+        //polls without blocking and releases the staging memory of every finished batch
+        bool isComplete(Ticket ticket);
+        void wait(Ticket ticket);
+        //submit() and wait(), for code that needs the resources before it can continue
+        void flush() { wait(submit()); }
+        //releases the staging memory of finished batches, cheap enough to call every frame
+        void collect();
+
+        //every recorded command is submitted and waited for on its own on the graphics queue, the pre batching behaviour,
+        //only useful to compare timings and only to be switched while nothing is recorded
+        void setSynchronous(bool enabled){
+            synchronous = enabled;
+            dedicatedTransfer = !enabled && veDevice.hasDedicatedTransferQueue();
+        }
+        bool hasRecordedCommands() const { return transferCommands != VK_NULL_HANDLE || graphicsCommands != VK_NULL_HANDLE; }
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct Batch{
+            Ticket ticket;
+            VkCommandBuffer transferCommands;
+            VkCommandBuffer graphicsCommands;
+            std::vector<std::unique_ptr<VeBuffer>> stagingChunks;
+        };
+
+        VkCommandBuffer beginCommands(VkCommandPool pool);
+        //copies and the transition into TRANSFER_DST_OPTIMAL
+        VkCommandBuffer recordTransfer();
+        //ownership acquires and blits, the transfer command buffer when there is no dedicated transfer queue
+        VkCommandBuffer recordGraphics();
+        //copies data into the open staging chunk, returns the chunk and the offset the data landed at
+        VkBuffer stage(const void* data, VkDeviceSize size, VkDeviceSize& srcOffset);
+        std::unique_ptr<VeBuffer> acquireChunk(VkDeviceSize size);
+        void releaseChunk(std::unique_ptr<VeBuffer> chunk);
+        void recorded();
+        //moves image from the transfer to the graphics family, changing its layout on the way
+        void handOver(VkImage image, VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+        void retire(Batch& batch);
+
+        VeDevice& veDevice;
+        //signalled by the copies on a dedicated transfer queue, null without one
+        std::unique_ptr<VeTimeline> transferTimeline;
+        bool dedicatedTransfer;
+        //open batch, VK_NULL_HANDLE until the first command after a submit
+        VkCommandBuffer transferCommands{VK_NULL_HANDLE};
+        VkCommandBuffer graphicsCommands{VK_NULL_HANDLE};
+        //chunks of the open batch, the last one is filled next
+        std::vector<std::unique_ptr<VeBuffer>> stagingChunks;
+        VkDeviceSize chunkCursor{0};
+        //idle chunks by size, all persistently mapped
+        std::map<VkDeviceSize, std::vector<std::unique_ptr<VeBuffer>>> freeChunks;
+        VkDeviceSize freeChunkBytes{0};
+        VkDeviceSize stagingAlignment;
+        //buffer writes need a barrier before vertex input and shaders read them
+        bool bufferWrites{false};
+        //dedicated transfer queue only: buffers written this batch, released to graphics on submit
+        std::vector<VkBufferMemoryBarrier> bufferReleases;
+        //dedicated transfer queue only: images in TRANSFER_DST_OPTIMAL still owned by the transfer family
+        std::unordered_map<VkImage, VkImageSubresourceRange> transferImages;
+        //submitted, oldest first
+        std::deque<Batch> batches;
+        Ticket lastSubmitted{0};
+        bool synchronous{false};
+        Stats stats{};
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ve_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ve{
+    //flat open-addressing table that welds identical vertices into a target vertex list
+    //keys are the full bit pattern of the vertex (joints, weights and tangent included, -0.0f folded into 0.0f)
+    class VertexWeldTable{
+    public:
+        VertexWeldTable(std::vector<VeModel::Vertex>& target, size_t expectedVertices);
+        VertexWeldTable(const VertexWeldTable&) = delete;
+        VertexWeldTable& operator=(const VertexWeldTable&) = delete;
+
+        //index of the vertex in target, appending it first if no identical vertex exists yet
+        uint32_t weld(const VeModel::Vertex& vertex);
+        size_t size() const { return count; }
+
+        static uint64_t hashVertex(const VeModel::Vertex& vertex);
+        static bool sameVertex(const VeModel::Vertex& a, const VeModel::Vertex& b);
+        //welds synthetic skinned vertices with std::unordered_map and with this table, prints vertices/second
+        //returns false if the two produce different index streams
+        static bool benchmark(size_t vertexCount);
+
+    private:
+        static constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+        struct Slot{
+            uint32_t hash;
+            uint32_t index;
+        };
+        void grow();
+
+        std::vector<VeModel::Vertex>& vertices;
+        std::vector<Slot> slots;
+        size_t mask{0};
+        size_t count{0};
+    };
+}
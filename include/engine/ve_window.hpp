@@ -17,7 +17,7 @@ namespace ve {
             void resetWindowResizedFlag() { framebufferResized = false; }
             GLFWwindow *getGLFWWindow() { return window; }
 
-            void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface); 
+            void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface, const VkAllocationCallbacks *allocator = nullptr); 
         private:
             static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
             void initWindow();
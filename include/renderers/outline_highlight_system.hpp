@@ -5,7 +5,9 @@
 #include "ve_game_object.hpp"
 #include "ve_camera.hpp"
 #include "frame_info.hpp"
+#include "ve_model.hpp"
 
+#include <array>
 #include <memory>
 #include <vector>
 namespace ve {
@@ -22,7 +24,7 @@ namespace ve {
             void createPipeline(VkRenderPass renderPass);
 
             VeDevice& veDevice;
-            std::unique_ptr<VePipeline> vePipeline;
+            std::array<std::unique_ptr<VePipeline>, VeModel::VERTEX_LAYOUT_COUNT> vePipelines;
             VkPipelineLayout pipelineLayout;
     };
 }
\ No newline at end of file
@@ -5,7 +5,10 @@
 #include "ve_game_object.hpp"
 #include "ve_camera.hpp"
 #include "frame_info.hpp"
+#include "ve_model.hpp"
+#include "ve_meshlet.hpp"
 
+#include <array>
 #include <memory>
 #include <vector>
 namespace ve {
@@ -15,14 +18,59 @@ namespace ve {
             ~PbrRenderSystem();
             PbrRenderSystem(const PbrRenderSystem&) = delete;
             PbrRenderSystem& operator=(const PbrRenderSystem&) = delete;
-            void renderGameObjects( FrameInfo& frameInfo, /*VkDescriptorSet shadowDescriptorSet,*/const std::vector<VkDescriptorSet>& descriptorSets);
+            void renderGameObjects( FrameInfo& frameInfo, /*VkDescriptorSet shadowDescriptorSet,*/const VeFrameArena::Vector<VkDescriptorSet>& descriptorSets);
+            //renderGameObjects split up for parallel recording: prepareDraws gathers the objects to draw into at most maxChunks
+            //contiguous chunks and returns how many, recordChunk records one of them and may run for different chunks on
+            //different threads and command buffers at once, finishDraws sums up the chunks' stats
+            //the game objects must not change between prepareDraws and the last recordChunk
+            uint32_t prepareDraws(FrameInfo& frameInfo, uint32_t maxChunks);
+            void recordChunk(const FrameInfo& frameInfo, const VeFrameArena::Vector<VkDescriptorSet>& descriptorSets, uint32_t chunk);
+            void finishDraws();
+            //normal cone rejection of meshlets, only enable together with back face culling in the pipeline config
+            void setConeCulling(bool enabled) { coneCulling = enabled; }
+            //meshlet culling totals of the last renderGameObjects call
+            const VeMeshlets::CullStats& getCullStats() const { return cullStats; }
+
+            //objects and triangles drawn per level of detail in the last renderGameObjects call
+            struct LodStats{
+                std::array<uint32_t, VeModel::MAX_LODS> objects{};
+                std::array<uint32_t, VeModel::MAX_LODS> triangles{};
+                //vertex/index buffer binds, one per layout and index type for models in the geometry heap
+                uint32_t geometryBinds{0};
+            };
+            const LodStats& getLodStats() const { return lodStats; }
+            //log2 scale of the allowed screen space error, positive values switch to coarser levels sooner
+            void setLodBias(float bias) { lodBias = bias; }
+            void setViewportHeight(float height) { viewportHeight = height; }
 
         private:
+            //what one chunk touches while recording, so chunks never share mutable state
+            struct Chunk{
+                uint32_t first{0};
+                uint32_t count{0};
+                VeMeshlets::CullStats cullStats{};
+                LodStats lodStats{};
+                std::vector<VeMeshlets::DrawRange> drawRanges;
+            };
+
             void createPipelineLayout(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts);
             void createPipeline(VkRenderPass renderPass);
+            //coarsest level whose projected simplification error stays under maxErrorPixels
+            uint32_t selectLod(const VeModel& model, const glm::mat4& modelMatrix, const glm::vec3& cameraPosition,
+                               float pixelsPerUnit, float maxErrorPixels) const;
 
             VeDevice& veDevice;
-            std::unique_ptr<VePipeline> vePipeline;
+            //one pipeline per vertex layout, objects bind the one matching their model
+            std::array<std::unique_ptr<VePipeline>, VeModel::VERTEX_LAYOUT_COUNT> vePipelines;
             VkPipelineLayout pipelineLayout;
+            bool coneCulling{false};
+            VeMeshlets::CullStats cullStats{};
+            //objects drawn this frame in map order, kept across frames so its capacity is reused
+            std::vector<VeGameObject*> drawList;
+            std::vector<Chunk> chunks;
+            uint32_t chunkCount{0};
+            float lodBias{0.0f};
+            float viewportHeight{1080.0f};
+            LodStats lodStats{};
     };
 }
\ No newline at end of file
@@ -8,12 +8,14 @@
 #include "ve_descriptors.hpp"
 #include "ve_swap_chain.hpp"
 #include "buffer.hpp"  
+#include "ve_model.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 namespace ve {
     class ShadowRenderSystem{
         public:
-            ShadowRenderSystem(VeDevice& device, VeDescriptorPool& globalPool);
+            ShadowRenderSystem(VeDevice& device, VeDescriptorPool& globalPool, int framesInFlight);
             ~ShadowRenderSystem();
             ShadowRenderSystem(const ShadowRenderSystem&) = delete;
             ShadowRenderSystem& operator=(const ShadowRenderSystem&) = delete;
@@ -37,17 +39,19 @@ namespace ve {
             void createShadowShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
             VeDevice& veDevice;
+            int framesInFlight;
             std::unique_ptr<VePipeline> vePipeline;
             VkPipelineLayout pipelineLayout;
             VkRenderPass renderPass;
             
             std::vector<VkFramebuffer> frameBuffers;
-            VkPipeline graphicsPipeline;
+            //shadow shader only reads the position stream, one pipeline per vertex layout for its stride/format
+            std::array<VkPipeline, VeModel::VERTEX_LAYOUT_COUNT> graphicsPipelines{};
             VkShaderModule vertShaderModule;
     
             std::vector<VkImage> shadowImages;
             std::vector<VkImageView> shadowImageViews;
-            std::vector<VkDeviceMemory> shadowImageMemories;
+            std::vector<VeAllocation> shadowImageMemories;
             std::vector<VkSampler> shadowSamplers;
 
             VkImageLayout shadowLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -0,0 +1,54 @@
+#version 450
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 packedNormal;
+layout(location = 0) out vec3 fragColor;
+
+
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+    float radius;
+    int objId;
+};
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 invViewMatrix;
+    vec4 ambientLightColor;
+    PointLight pointLights[10];
+    int pointLightCount;
+    int selectedLight;
+    float time;
+} ubo;
+
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint textureIndex;
+    uint normalIndex;
+    uint specularIndex;
+    float smoothness;
+    vec3 baseColor;
+} push;
+
+//inverse of packOctahedral in ve_model.cpp
+vec3 octahedralDecode(vec2 encoded){
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.x += direction.x >= 0.0 ? -fold : fold;
+    direction.y += direction.y >= 0.0 ? -fold : fold;
+    return normalize(direction);
+}
+
+float outline_thickness = 0.1;
+vec3 outline_color = vec3(1.0, 1.0, 0.3);
+void main(){
+    vec3 normal = octahedralDecode(packedNormal);
+    vec4 positionWorld = vec4(position + normal * outline_thickness, 1.0);
+    positionWorld = push.modelMatrix * positionWorld;
+    gl_Position = ubo.projectionMatrix * (ubo.viewMatrix * positionWorld);
+
+    fragColor = outline_color;
+}
\ No newline at end of file
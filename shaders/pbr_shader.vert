@@ -4,7 +4,7 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
-layout(location = 4) in vec3 tangent;
+layout(location = 4) in vec4 tangent; //w = handedness
 layout(location = 5) in ivec4 joints;
 layout(location = 6) in vec4 weights;
 
@@ -98,10 +98,10 @@ void main(){
     //compute TBN matrix
     mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)* mat3(skinMatrix)));
     // mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
-    vec3 T = normalize(normalMatrix * tangent);
+    vec3 T = normalize(normalMatrix * tangent.xyz);
     vec3 N = normalize(normalMatrix * normal); 
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = cross(N, T) * tangent.w;
     mat3 TBN = transpose(mat3(T, B, N));
     //convert vectors from world space to tangent space
     vec3 cameraPosWorld = vec3(ubo.invViewMatrix * vec4(0.0, 0.0, 0.0, 1.0));
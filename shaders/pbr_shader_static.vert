@@ -0,0 +1,85 @@
+#version 450
+//vertex input
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color; //alpha carries the tangent handedness, see PackedAttributes
+layout(location = 2) in vec2 packedNormal;
+layout(location = 3) in vec2 uv;
+layout(location = 4) in vec2 packedTangent;
+
+//outputs to fragment shader
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosition;
+layout(location = 2) out vec3 fragNormal;
+layout(location = 3) out vec2 fragUV;
+layout(location = 4) out vec3 fragTangentPos;
+layout(location = 5) out vec3 fragTangentView;
+layout(location = 6) out vec3 fragTangentLightPos[10];
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+    float radius;
+    int objId;
+};
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 invViewMatrix;
+    vec4 ambientLightColor;
+    PointLight pointLights[10];
+    int pointLightCount;
+    int selectedLight;
+    float time;
+} ubo;
+
+layout(set = 1, binding = 0) uniform sampler2D textureSampler[3]; 
+layout(set = 1, binding = 1) uniform sampler2D normalSampler[3];
+layout(set = 1, binding = 2) uniform sampler2D specularSampler[3];
+
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint textureIndex;
+    uint normalIndex;
+    uint specularIndex;
+    float smoothness;
+    vec3 baseColor;
+} push;
+
+//inverse of packOctahedral in ve_model.cpp
+vec3 octahedralDecode(vec2 encoded){
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-direction.z, 0.0);
+    direction.x += direction.x >= 0.0 ? -fold : fold;
+    direction.y += direction.y >= 0.0 ? -fold : fold;
+    return normalize(direction);
+}
+
+void main(){
+    vec3 normal = octahedralDecode(packedNormal);
+    vec3 tangent = octahedralDecode(packedTangent);
+    //static meshes are never skinned, so the joint matrices are not read at all
+    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0f);
+    gl_Position = ubo.projectionMatrix * (ubo.viewMatrix * positionWorld);
+    fragPosition = positionWorld.xyz;
+    fragColor = color.rgb * push.baseColor;
+    fragUV = uv;
+
+    //compute TBN matrix
+    mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 N = normalize(normalMatrix * normal); 
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T) * (color.a < 0.5 ? -1.0 : 1.0);
+    mat3 TBN = transpose(mat3(T, B, N));
+    //convert vectors from world space to tangent space
+    vec3 cameraPosWorld = vec3(ubo.invViewMatrix * vec4(0.0, 0.0, 0.0, 1.0));
+    fragNormal = N;
+    fragTangentPos = TBN * fragPosition;
+    fragTangentView = TBN * cameraPosWorld;
+    for(int i = 0; i < ubo.pointLightCount; i++){
+        PointLight pointLight = ubo.pointLights[i];
+        fragTangentLightPos[i] = TBN * pointLight.position.xyz;
+    }
+}
\ No newline at end of file
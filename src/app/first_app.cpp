@@ -2,6 +2,10 @@
 #include "ve_camera.hpp"
 #include "input_controller.hpp"
 #include "buffer.hpp"
+#include "ve_frame_ring.hpp"
+#include "ve_frame_arena.hpp"
+#include "ve_allocation_counter.hpp"
+#include "ve_command_recorder.hpp"
 #include "pbr_render_system.hpp"
 #include "point_light_system.hpp"
 #include "outline_highlight_system.hpp"
@@ -16,55 +20,111 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <array>
 #include <stdexcept>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <unordered_set>
 namespace ve {
-    FirstApp::FirstApp() { 
+    namespace{
+        //startup frames load models and size the frame arena, the allocation check ignores them
+        constexpr int ALLOCATION_CHECK_WARMUP_FRAMES = 100;
+        //pbr chunks handed to the recorder per thread, a few more than threads so a slow chunk does not hold up the others
+        constexpr uint32_t PBR_CHUNKS_PER_THREAD = 2;
+        //room between the stress grid's cubes
+        constexpr float STRESS_OBJECT_SPACING = 0.6f;
+
+        //the swap chain passes after the pbr chunks, in the order the inline path records them
+        enum class ScenePass{
+            POINT_LIGHTS,
+            OUTLINE,
+            CUBE_MAP,
+            IMGUI
+        };
+    }
+    FirstApp::FirstApp(const Options& options)
+        : veRenderer{veWindow, veDevice, options.framesInFlight}, checkFrameAllocations{options.checkFrameAllocations},
+          allocationCheckFrames{options.allocationCheckFrames}, recordThreads{options.recordThreads} { 
+        auto startupBegin = std::chrono::high_resolution_clock::now();
+        //the swap chain targets already exist, they count against the budget but were not checked
+        veDevice.getMemoryAllocator().setBudget(options.memoryBudget, options.strictMemoryBudget ? VeMemoryAllocator::BudgetPolicy::REFUSE : VeMemoryAllocator::BudgetPolicy::WARN);
+        uploadContext.setSynchronous(options.synchronousUploads);
+        residency.setBudget(options.residencyBudget);
         //setup descriptor pools
         globalPool = VeDescriptorPool::Builder(veDevice)
             .setMaxSets(20000)  
             .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10000)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 16)
             .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10000)
             #ifdef MACOS
             .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
             #endif
             .build();
         //Dear ImGui DescriptorPool
-        imGuiPool = VeImGui::createDescriptorPool(veDevice.device());
+        imGuiPool = VeImGui::createDescriptorPool(veDevice);
         //load assets
-        preLoadModels(veDevice);
+        preLoadModels(modelLoader);
+        for(auto& [name, handle] : preLoadedModels){
+            residency.addModel(handle);
+        }
         loadGameObjects(); 
+        spawnStressObjects(options.stressObjects);
+        //run() animates the demo model from the first frame, so that one has to be resident up front
+        //and stays pinned, its animation is started once and static models bind its palette
+        if(gameObjects.at(0).modelHandle){
+            modelLoader.wait(*gameObjects.at(0).modelHandle);
+            gameObjects.at(0).updateModel();
+            residency.pinModel(gameObjects.at(0).modelHandle);
+        }
         loadTextures();
+        //textures, the skybox and whatever models are ready go out together, the first frame samples them
+        uploadContext.flush();
+        float startupTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startupBegin).count();
+        const auto& uploadStats = uploadContext.getStats();
+        std::cout << "Startup assets ready in " << startupTime << " ms (" << (options.synchronousUploads ? "synchronous" : "batched") << " uploads: "
+                  << uploadStats.commands << " commands in " << uploadStats.submissions << " submissions, " << uploadStats.waits << " waits totalling "
+                  << uploadStats.waitMilliseconds << " ms, " << uploadStats.stagedBytes << " bytes staged in " << uploadStats.stagingAllocations
+                  << " staging chunks, " << uploadStats.stagingReuses << " reused)" << std::endl;
+        veDevice.getMemoryAllocator().report();
+        geometryHeap.report();
+        VeHostAllocator::report();
+        residency.report();
     }
     //cleanup
     FirstApp::~FirstApp() {
-        vkDestroyRenderPass(veDevice.device(), renderPass, nullptr);
-        vkDestroyDescriptorPool(veDevice.device(), imGuiPool, nullptr);
+        vkDestroyRenderPass(veDevice.device(), renderPass, veDevice.allocationCallbacks());
+        vkDestroyDescriptorPool(veDevice.device(), imGuiPool, veDevice.allocationCallbacks());
         cleanupPreloadedModels();
     }
 
     void FirstApp::run() {
-        //create global uniform buffers
-        std::vector<std::unique_ptr<VeBuffer>> uniformBuffers(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i =0; i< uniformBuffers.size(); i++){
-            uniformBuffers[i] = std::make_unique<VeBuffer>(
-                veDevice,
-                sizeof(GlobalUbo),
-                1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-                veDevice.properties.limits.minUniformBufferOffsetAlignment
-            );
-            uniformBuffers[i]->map();
+        //per frame uniform data (global ubo, joint palettes) lives in one mapped ring, bound with dynamic offsets
+        constexpr VkDeviceSize jointPaletteRange = VeModel::MAX_SHADER_JOINTS * sizeof(glm::mat4);
+        const int framesInFlight = veRenderer.getFramesInFlight();
+        //room for a palette per distinct model, any of them may turn out to be animated once it has streamed in
+        std::unordered_set<const void*> sceneModels;
+        for(auto& [id, object] : gameObjects){
+            if(object.modelHandle){
+                sceneModels.insert(object.modelHandle.get());
+            }else if(object.model){
+                sceneModels.insert(object.model.get());
+            }
         }
+        VkDeviceSize ringAlignment = VeFrameRing::getAlignment(veDevice);
+        VkDeviceSize sceneFrameBytes = (sizeof(GlobalUbo) + ringAlignment) + sceneModels.size() * (jointPaletteRange + ringAlignment);
+        VeFrameRing frameRing{veDevice, static_cast<uint32_t>(framesInFlight), std::max<VkDeviceSize>(sizeof(GlobalUbo), jointPaletteRange),
+                              std::max(VeFrameRing::DEFAULT_FRAME_CAPACITY, sceneFrameBytes)};
+        //transient cpu side lists of a frame, recycled with the same frame index as the ring
+        VeFrameArena frameArena{static_cast<uint32_t>(framesInFlight)};
 
         //create descriptor set layout
         //global ubo descriptor layout
         auto globalSetLayout = VeDescriptorSetLayout::Builder(veDevice)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS, 1)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS, 1)
             .build();
         //texture descriptor layout
         auto textureSetLayout = VeDescriptorSetLayout::Builder(veDevice)
@@ -74,39 +134,41 @@ namespace ve {
             .build();
         //animation descriptor layout
         auto animationSetLayout = VeDescriptorSetLayout::Builder(veDevice)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 1)
             .build();
         
         //create descriptor pools
-        //global ubo descriptor pool
-        std::vector<VkDescriptorSet> globalDescriptorSets(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        std::vector<VkDescriptorSet> animationDescriptorSet(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i = 0; i < globalDescriptorSets.size(); i++){
-            auto bufferInfo = uniformBuffers[i]->descriptorInfo();
-            VeDescriptorWriter(*globalSetLayout, *globalPool)
-                .writeBuffer(0, &bufferInfo)
-                .build(globalDescriptorSets[i]);
-
-            auto bufferInfo2 = gameObjects.at(0).model->shaderJointsBuffer[i]->descriptorInfo();
-            VeDescriptorWriter(*animationSetLayout, *globalPool)
-                .writeBuffer(0,&bufferInfo2)
-                .build(animationDescriptorSet[i]);
+        //global ubo and animation descriptor sets, one each for every frame and model, the offsets pick the data
+        VkDescriptorSet globalDescriptorSet;
+        auto bufferInfo = frameRing.descriptorInfo(sizeof(GlobalUbo));
+        VeDescriptorWriter(*globalSetLayout, *globalPool)
+            .writeBuffer(0, &bufferInfo)
+            .build(globalDescriptorSet);
+        VkDescriptorSet animationDescriptorSet;
+        auto bufferInfo2 = frameRing.descriptorInfo(jointPaletteRange);
+        VeDescriptorWriter(*animationSetLayout, *globalPool)
+            .writeBuffer(0,&bufferInfo2)
+            .build(animationDescriptorSet);
+        //texture descriptor sets, one per frame so a frame can rewrite its own after an eviction while the others are in flight
+        std::vector<VkDescriptorSet> textureDescriptorSets(framesInFlight, VK_NULL_HANDLE);
+        std::vector<uint64_t> textureSetVersions(framesInFlight, residency.getTextureVersion());
+        for(auto& textureDescriptorSet : textureDescriptorSets){
+            writeTextureSet(*textureSetLayout, textureDescriptorSet, true);
         }
-        //texture descriptor pool
-        VkDescriptorSet textureDescriptorSet;
-        VeDescriptorWriter(*textureSetLayout, *globalPool)
-            .writeImage(0, textureInfos.data(),3)
-            .writeImage(1, normalMapInfos.data(),3)
-            .writeImage(2, specularMapInfos.data(),3)
-            .build(textureDescriptorSet);
        
         
         //initialize render systems
-        // ShadowRenderSystem shadowRenderSystem{veDevice, *globalPool };
+        // ShadowRenderSystem shadowRenderSystem{veDevice, *globalPool, framesInFlight };
         PbrRenderSystem pbrRenderSystem{veDevice, veRenderer.getSwapChainRenderPass(), {globalSetLayout->getDescriptorSetLayout(), textureSetLayout->getDescriptorSetLayout(), animationSetLayout->getDescriptorSetLayout()/*, shadowRenderSystem.getDescriptorSetLayout()*/ } };
         PointLightSystem pointLightSystem{veDevice, veRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
         OutlineHighlightSystem outlineHighlightSystem{veDevice, veRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
         CubeMapRenderSystem cubeMapRenderSystem{veDevice, veRenderer.getSwapChainRenderPass(), {globalSetLayout->getDescriptorSetLayout(), gameObjects.at(cubeMapIndex).cubeMapComponent->descriptorSetLayout->getDescriptorSetLayout()} };
+        //records the swap chain pass into per thread secondaries, without one the pass is recorded inline
+        std::unique_ptr<VeCommandRecorder> commandRecorder;
+        if(recordThreads != 1){
+            commandRecorder = std::make_unique<VeCommandRecorder>(veDevice, framesInFlight, recordThreads);
+            std::cout << "Recording the scene on " << commandRecorder->getThreadCount() << " threads" << std::endl;
+        }
         //create camera
         VeCamera camera{};
         auto viewerObject = VeGameObject::createGameObject();
@@ -120,15 +182,26 @@ namespace ve {
         //initialize selected object to control
 
         //initialize imgui
-        renderPass = VeImGui::createRenderPass(veDevice.device(), veRenderer.getSwapChainImageFormat(), veRenderer.getSwapChainDepthFormat());
-        VeImGui::createImGuiContext(veDevice, veWindow, imGuiPool, renderPass, VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        renderPass = VeImGui::createRenderPass(veDevice, veRenderer.getSwapChainImageFormat(), veRenderer.getSwapChainDepthFormat());
+        //imgui asserts on fewer than two images, it only sizes its own buffers with the count
+        VeImGui::createImGuiContext(veDevice, veWindow, imGuiPool, renderPass, std::max(2, framesInFlight));
         int numLights = getNumLights();
         bool showOutlignHighlight = true;
+        float lodBias = 0.0f;
         int frameCount = 0;
+        //written and flushed by the last frame, shown by the next one
+        VeBuffer::TrafficStats bufferTraffic{};
+        VeHostAllocator::Stats hostAllocations{};
+        uint64_t frameHeapAllocations = 0;
+        uint32_t checkedFrames = 0;
+        float recordMilliseconds = 0.0f;
+        double totalRecordMilliseconds = 0.0;
+        uint32_t recordedFrames = 0;
 
         gameObjects.at(0).model->animationManager->start(0);
         //main loop
         while (!veWindow.shouldClose()) {
+            uint64_t allocationsBefore = VeAllocationCounter::getAllocations();
             glfwPollEvents();
             //track time
             auto newTime = std::chrono::high_resolution_clock::now();
@@ -136,6 +209,14 @@ namespace ve {
             currentTime = newTime;
             frameTime = glm::clamp(frameTime, 0.0001f, 0.1f); //clamp large frametimes
             elapsedTime += frameTime;
+            //swap in models whose upload finished since the last frame
+            modelLoader.update();
+            //evicts and reloads what the timeline shows no submitted frame still reads, before the objects pick up
+            //their models so none of them records a draw of an evicted one
+            residency.update();
+            for(auto& [id, object] : gameObjects){
+                object.updateModel();
+            }
 
             //update objects based on input
             inputController.inputLogic(veWindow.getGLFWWindow(), frameTime, gameObjects, viewerObject, selectedObject);
@@ -153,9 +234,40 @@ namespace ve {
                 VeImGui::initializeImGuiFrame();
                 numLights = getNumLights();
                 sceneEditor.drawSceneEditor(gameObjects, selectedObject, viewerObject, numLights, showOutlignHighlight);
+                //shows the previous frame's counters, this frame is not recorded yet
+                sceneEditor.drawLodPanel(lodBias, pbrRenderSystem.getLodStats());
+                sceneEditor.drawMemoryPanel(veDevice, bufferTraffic, hostAllocations, frameArena.getStats(), frameHeapAllocations);
+                sceneEditor.drawResidencyPanel(residency);
+                sceneEditor.drawRecordingPanel(recordMilliseconds, commandRecorder ? &commandRecorder->getStats() : nullptr);
+                pbrRenderSystem.setLodBias(lodBias);
+                pbrRenderSystem.setViewportHeight(static_cast<float>(veRenderer.getSwapChainExtent().height));
                 //record frame data
                 int frameIndex = veRenderer.getFrameIndex();
-                FrameInfo frameInfo{frameIndex, frameTime, elapsedTime, commandBuffer, camera, globalDescriptorSets[frameIndex], gameObjects, selectedObject, numLights, showOutlignHighlight};
+                FrameInfo frameInfo{frameIndex, frameTime, elapsedTime, commandBuffer, camera, globalDescriptorSet, gameObjects, selectedObject, numLights, showOutlignHighlight, frameArena};
+                //the renderer waited on the timeline for this frame's previous use, its ring segment is free again
+                frameRing.beginFrame(frameIndex);
+                //taken first so the global ubo always fits, it is filled in once the lights have updated it
+                VeFrameRing::Allocation globalUboAllocation = frameRing.allocate(sizeof(GlobalUbo));
+                frameArena.beginFrame(frameIndex);
+                if(commandRecorder){
+                    commandRecorder->beginFrame(frameIndex);
+                }
+                touchAssets();
+                if(textureSetVersions[frameIndex] != residency.getTextureVersion()){
+                    writeTextureSet(*textureSetLayout, textureDescriptorSets[frameIndex], false);
+                    textureSetVersions[frameIndex] = residency.getTextureVersion();
+                }
+                //update animation, every animated model drawn this frame needs a palette in this frame's ring segment
+                for(auto& [id, object] : gameObjects){
+                    if(object.model && object.model->isAnimated()){
+                        object.model->updateAnimation(frameTime, frameCount, frameRing);
+                    }
+                }
+                //static models bind the demo model's palette, as before the ring, or any valid offset if it did not fit
+                frameInfo.jointPaletteOffset = gameObjects.at(0).model->getJointPaletteOffset();
+                if(frameInfo.jointPaletteOffset == VeFrameRing::NO_OFFSET){
+                    frameInfo.jointPaletteOffset = globalUboAllocation.offset;
+                }
                 //update global UBO
                 GlobalUbo globalUbo{};
                 globalUbo.projection = camera.getProjectionMatrix();
@@ -164,10 +276,9 @@ namespace ve {
                 globalUbo.selectedLight = selectedObject;
                 globalUbo.frameTime = frameTime;     
                 pointLightSystem.update(frameInfo, globalUbo);
-                uniformBuffers[frameIndex]->writeToBuffer(&globalUbo);
-                uniformBuffers[frameIndex]->flush();
-                //update animation
-                gameObjects.at(0).model->updateAnimation(frameTime, frameCount, frameIndex);
+                std::memcpy(globalUboAllocation.data, &globalUbo, sizeof(GlobalUbo));
+                frameInfo.globalUboOffset = globalUboAllocation.offset;
+                frameRing.flush();
 
                 //render shadow maps
                 // for(int i =0; i <numLights; i ++){
@@ -180,18 +291,90 @@ namespace ve {
                 // }
 
                 //render scene
-                veRenderer.beginSwapChainRenderPass(commandBuffer);
-                pbrRenderSystem.renderGameObjects(frameInfo, /*shadowRenderSystem.getShadowDescriptorSet(frameIndex),*/ {globalDescriptorSets[frameIndex], textureDescriptorSet, animationDescriptorSet[frameIndex]});
-                pointLightSystem.render(frameInfo);
-                if(showOutlignHighlight)
-                    outlineHighlightSystem.renderGameObjects(frameInfo);
-                cubeMapRenderSystem.renderGameObjects(frameInfo);
-                VeImGui::renderImGuiFrame(commandBuffer);
+                auto recordBegin = std::chrono::high_resolution_clock::now();
+                auto pbrDescriptorSets = frameArena.makeVector<VkDescriptorSet>({globalDescriptorSet, textureDescriptorSets[frameIndex], animationDescriptorSet});
+                if(!commandRecorder){
+                    veRenderer.beginSwapChainRenderPass(commandBuffer);
+                    pbrRenderSystem.renderGameObjects(frameInfo, /*shadowRenderSystem.getShadowDescriptorSet(frameIndex),*/ pbrDescriptorSets);
+                    pointLightSystem.render(frameInfo);
+                    if(showOutlignHighlight)
+                        outlineHighlightSystem.renderGameObjects(frameInfo);
+                    cubeMapRenderSystem.renderGameObjects(frameInfo);
+                    VeImGui::renderImGuiFrame(commandBuffer);
+                }else{
+                    veRenderer.beginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                    uint32_t pbrChunks = pbrRenderSystem.prepareDraws(frameInfo, commandRecorder->getThreadCount() * PBR_CHUNKS_PER_THREAD);
+                    std::array<ScenePass, 4> scenePasses{};
+                    uint32_t scenePassCount = 0;
+                    scenePasses[scenePassCount++] = ScenePass::POINT_LIGHTS;
+                    if(showOutlignHighlight)
+                        scenePasses[scenePassCount++] = ScenePass::OUTLINE;
+                    scenePasses[scenePassCount++] = ScenePass::CUBE_MAP;
+                    scenePasses[scenePassCount++] = ScenePass::IMGUI;
+                    //every task gets its own copy of the frame info pointing at its secondary, the systems only read the rest
+                    commandRecorder->record(commandBuffer, veRenderer.getSwapChainInheritanceInfo(), veRenderer.getSwapChainExtent(), pbrChunks + scenePassCount,
+                        [&](uint32_t task, VkCommandBuffer taskCommandBuffer){
+                            FrameInfo taskInfo = frameInfo;
+                            taskInfo.commandBuffer = taskCommandBuffer;
+                            if(task < pbrChunks){
+                                pbrRenderSystem.recordChunk(taskInfo, pbrDescriptorSets, task);
+                                return;
+                            }
+                            switch(scenePasses[task - pbrChunks]){
+                                case ScenePass::POINT_LIGHTS:
+                                    pointLightSystem.render(taskInfo);
+                                    break;
+                                case ScenePass::OUTLINE:
+                                    outlineHighlightSystem.renderGameObjects(taskInfo);
+                                    break;
+                                case ScenePass::CUBE_MAP:
+                                    cubeMapRenderSystem.renderGameObjects(taskInfo);
+                                    break;
+                                case ScenePass::IMGUI:
+                                    VeImGui::renderImGuiFrame(taskCommandBuffer);
+                                    break;
+                            }
+                        });
+                    pbrRenderSystem.finishDraws();
+                }
                 veRenderer.endSwapChainRenderPass(commandBuffer);
+                recordMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - recordBegin).count();
+                totalRecordMilliseconds += recordMilliseconds;
+                recordedFrames++;
                 veRenderer.endFrame();
+                geometryHeap.endFrame();
+                bufferTraffic = VeBuffer::getTrafficStats();
+                VeBuffer::resetTrafficStats();
+                //the diagnostics below allocate by design, they are not part of the frame
+                frameHeapAllocations = VeAllocationCounter::getAllocations() - allocationsBefore;
+                if(checkFrameAllocations && frameCount >= ALLOCATION_CHECK_WARMUP_FRAMES){
+                    checkedFrames++;
+                    if(frameHeapAllocations > 0){
+                        allocatingFrames++;
+                        std::cerr << "Frame " << frameCount << " made " << frameHeapAllocations << " heap allocations" << std::endl;
+                    }
+                    if(allocationCheckFrames > 0 && checkedFrames >= allocationCheckFrames){
+                        glfwSetWindowShouldClose(veWindow.getGLFWWindow(), GLFW_TRUE);
+                    }
+                }
+                if(VeHostAllocator::isEnabled()){
+                    hostAllocations = VeHostAllocator::getStats();
+                    VeHostAllocator::resetFrame();
+                }
             }
             frameCount++;
         }
+        if(checkFrameAllocations){
+            std::cout << "Frame allocation check: " << allocatingFrames << " of " << checkedFrames << " frames after the first "
+                      << ALLOCATION_CHECK_WARMUP_FRAMES << " allocated from the heap, frame arena peak " << frameArena.getStats().peak << " bytes" << std::endl;
+        }
+        if(recordedFrames > 0){
+            std::cout << "Scene recording took " << totalRecordMilliseconds / recordedFrames << " ms per frame on average over " << recordedFrames << " frames ("
+                      << (commandRecorder ? commandRecorder->getThreadCount() : 1) << (commandRecorder ? " threads" : " thread, inline") << ")" << std::endl;
+        }
+        const auto& timelineStats = veDevice.getGraphicsTimeline().getStats();
+        std::cout << "Frame pacing: " << framesInFlight << " frames in flight, " << timelineStats.submissions << " graphics submissions, "
+                  << timelineStats.waits << " timeline waits totalling " << timelineStats.waitMilliseconds << " ms" << std::endl;
         vkDeviceWaitIdle(veDevice.device()); //cpu wait for gpu to finish
         VeImGui::cleanUpImGui();
     }
@@ -201,7 +384,7 @@ namespace ve {
         // man.setTextureIndex(2);
         // man.setNormalIndex(2);
         // man.setSpecularIndex(2);
-        // man.model = preLoadedModels["CesiumMan"];
+        // man.setModel(preLoadedModels["CesiumMan"]);
         // man.transform.translation = {0.5f, 0.5f, 0.0f};
         // // man.transform.scale = {3.0f, 1.0f, 3.0f};
         // // man.color = {128.0f, 228.1f, 229.1f}; //cyan
@@ -213,7 +396,7 @@ namespace ve {
         vase.setTextureIndex(2);
         vase.setNormalIndex(2);
         vase.setSpecularIndex(2);
-        vase.model = preLoadedModels["Cute_Demon"];
+        vase.setModel(preLoadedModels["Cute_Demon"]);
         vase.transform.translation = {0.5f, 0.5f, 0.0f};
         // vase.transform.scale = {3.0f, 1.0f, 3.0f};
         // vase.color = {128.0f, 228.1f, 229.1f}; //cyan
@@ -225,7 +408,7 @@ namespace ve {
         cube.setTextureIndex(1);
         cube.setNormalIndex(1);
         cube.setSpecularIndex(1);
-        cube.model = preLoadedModels["cube"];
+        cube.setModel(preLoadedModels["cube"]);
         cube.transform.translation = {1.5f, 0.5f, 0.0f};
         cube.transform.scale = {0.45f, 0.45f, 0.45f};
         // cube.color = {128.0f, 228.1f, 229.1f}; //cyan
@@ -236,7 +419,7 @@ namespace ve {
         quad.setTextureIndex(2);
         quad.setNormalIndex(2);
         quad.setSpecularIndex(2);
-        quad.model = preLoadedModels["quad"];
+        quad.setModel(preLoadedModels["quad"]);
         quad.transform.translation = {0.0f, 0.5f, 0.0f};
         quad.transform.scale = {3.0f, 0.5f, 3.0f};
         // quad.color = {103.0f,242.0f,209.0f};//light green
@@ -250,49 +433,101 @@ namespace ve {
         gameObjects.emplace(light.getId(),std::move(light));
 
         //skybox
-        auto skybox = VeGameObject::createCubeMap(veDevice, {"assets/cubemap/right.png", "assets/cubemap/left.png", "assets/cubemap/top.png", "assets/cubemap/bottom.png", "assets/cubemap/front.png", "assets/cubemap/back.png"}, *globalPool);
+        auto skybox = VeGameObject::createCubeMap(veDevice, uploadContext, {"assets/cubemap/right.png", "assets/cubemap/left.png", "assets/cubemap/top.png", "assets/cubemap/bottom.png", "assets/cubemap/front.png", "assets/cubemap/back.png"}, *globalPool);
         skybox.setTitle("Skybox");
         gameObjects.emplace(skybox.getId(),std::move(skybox));
         cubeMapIndex = skybox.getId();
     }
+    void FirstApp::spawnStressObjects(uint32_t count){
+        if(count == 0){
+            return;
+        }
+        //a square grid on the floor plane around the demo model
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+        float extent = (side - 1) * STRESS_OBJECT_SPACING;
+        for(uint32_t i = 0; i < count; i++){
+            auto cube = VeGameObject::createGameObject();
+            cube.setTextureIndex(i % TEXTURE_SLOTS);
+            cube.setNormalIndex(i % TEXTURE_SLOTS);
+            cube.setSpecularIndex(i % TEXTURE_SLOTS);
+            cube.setModel(preLoadedModels["cube"]);
+            cube.transform.translation = {(i % side) * STRESS_OBJECT_SPACING - extent * 0.5f, 0.5f, (i / side) * STRESS_OBJECT_SPACING - extent * 0.5f};
+            cube.transform.scale = {0.15f, 0.15f, 0.15f};
+            cube.setTitle("Stress Cube");
+            gameObjects.emplace(cube.getId(), std::move(cube));
+        }
+        std::cout << "Spawned " << count << " stress objects" << std::endl;
+    }
     void FirstApp::loadTextures(){
-        textures.push_back(std::make_unique<VeTexture>(veDevice, "assets/textures/brick_texture.png"));
-        textures.push_back(std::make_unique<VeTexture>(veDevice, "assets/textures/metal.tga"));
-        textures.push_back(std::make_unique<VeTexture>(veDevice, "assets/textures/wood.png"));
-        // textures.push_back(std::make_unique<VeTexture>(veDevice, "assets/textures/wall_gray.png"));
-        // textures.push_back(std::make_unique<VeTexture>(veDevice, "assets/textures/tile.png"));
-        // textures.push_back(std::make_unique<VeTexture>(veDevice, "assets/textures/stone.png"));
+        //the first map of each kind stays resident, the others show it in their place while evicted
+        auto addTexture = [this](const std::string& path, uint32_t fallback){
+            return residency.addTexture([this, path](VeUploadContext& uploadContext){
+                auto texture = std::make_shared<VeTexture>(veDevice, uploadContext, path);
+                return VeResidencyManager::TextureData{texture, {texture->getSampler(), texture->getImageView(), texture->getLayout()}, texture->getMemorySize()};
+            }, fallback);
+        };
+        auto addMap = [this](const std::string& path, uint32_t fallback){
+            return residency.addTexture([this, path](VeUploadContext& uploadContext){
+                auto map = std::make_shared<VeNormal>(veDevice, uploadContext, path);
+                return VeResidencyManager::TextureData{map, {map->getNormalSampler(), map->getNormalImageView(), map->getLayout()}, map->getMemorySize()};
+            }, fallback);
+        };
+        textures.push_back(addTexture("assets/textures/brick_texture.png", VeResidencyManager::NO_FALLBACK));
+        textures.push_back(addTexture("assets/textures/metal.tga", textures[0]));
+        textures.push_back(addTexture("assets/textures/wood.png", textures[0]));
+        // textures.push_back(addTexture("assets/textures/wall_gray.png", textures[0]));
+        // textures.push_back(addTexture("assets/textures/tile.png", textures[0]));
+        // textures.push_back(addTexture("assets/textures/stone.png", textures[0]));
         //normal maps
-        normalMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/brick_normal.png"));
-        normalMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/metal_normal.tga"));
-        normalMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/wood_normal.png"));
-        // normalMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/wall_gray_normal.png"));
-        // normalMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/tile_normal.png"));
-        // normalMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/stone_normal.png"));
+        normalMaps.push_back(addMap("assets/textures/brick_normal.png", VeResidencyManager::NO_FALLBACK));
+        normalMaps.push_back(addMap("assets/textures/metal_normal.tga", normalMaps[0]));
+        normalMaps.push_back(addMap("assets/textures/wood_normal.png", normalMaps[0]));
+        // normalMaps.push_back(addMap("assets/textures/wall_gray_normal.png", normalMaps[0]));
+        // normalMaps.push_back(addMap("assets/textures/tile_normal.png", normalMaps[0]));
+        // normalMaps.push_back(addMap("assets/textures/stone_normal.png", normalMaps[0]));
         //specular maps
-        specularMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/brick_specular.png"));
-        specularMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/metal_specular.tga"));
-        specularMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/wood_specular.png"));
-        // specularMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/wall_gray_specular.png"));
-        // specularMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/tile_specular.png"));
-        // // specularMaps.push_back(std::make_unique<VeNormal>(veDevice, "assets/textures/stone_specular.png"));
-        //get image infos
-        for(int i = 0; i < textures.size(); i++){
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = textures[i]->getLayout();
-            imageInfo.imageView = textures[i]->getImageView();
-            imageInfo.sampler = textures[i]->getSampler();
-            textureInfos.push_back(VkDescriptorImageInfo(imageInfo));
-            VkDescriptorImageInfo normalImageInfo{};
-            normalImageInfo.imageLayout = normalMaps[i]->getLayout();
-            normalImageInfo.imageView = normalMaps[i]->getNormalImageView();
-            normalImageInfo.sampler = normalMaps[i]->getNormalSampler();
-            normalMapInfos.push_back(VkDescriptorImageInfo(normalImageInfo)); 
-            VkDescriptorImageInfo specularImageInfo{};
-            specularImageInfo.imageLayout = specularMaps[i]->getLayout();
-            specularImageInfo.imageView = specularMaps[i]->getNormalImageView();
-            specularImageInfo.sampler = specularMaps[i]->getNormalSampler();
-            specularMapInfos.push_back(VkDescriptorImageInfo(specularImageInfo));
+        specularMaps.push_back(addMap("assets/textures/brick_specular.png", VeResidencyManager::NO_FALLBACK));
+        specularMaps.push_back(addMap("assets/textures/metal_specular.tga", specularMaps[0]));
+        specularMaps.push_back(addMap("assets/textures/wood_specular.png", specularMaps[0]));
+        // specularMaps.push_back(addMap("assets/textures/wall_gray_specular.png", specularMaps[0]));
+        // specularMaps.push_back(addMap("assets/textures/tile_specular.png", specularMaps[0]));
+        // // specularMaps.push_back(addMap("assets/textures/stone_specular.png", specularMaps[0]));
+    }
+    void FirstApp::writeTextureSet(VeDescriptorSetLayout& setLayout, VkDescriptorSet& set, bool create){
+        std::array<VkDescriptorImageInfo, TEXTURE_SLOTS> textureInfos{};
+        std::array<VkDescriptorImageInfo, TEXTURE_SLOTS> normalMapInfos{};
+        std::array<VkDescriptorImageInfo, TEXTURE_SLOTS> specularMapInfos{};
+        for(uint32_t i = 0; i < TEXTURE_SLOTS; i++){
+            textureInfos[i] = residency.getImageInfo(textures[i]);
+            normalMapInfos[i] = residency.getImageInfo(normalMaps[i]);
+            specularMapInfos[i] = residency.getImageInfo(specularMaps[i]);
+        }
+        VeDescriptorWriter writer{setLayout, *globalPool};
+        writer.writeImage(0, textureInfos.data(), TEXTURE_SLOTS)
+            .writeImage(1, normalMapInfos.data(), TEXTURE_SLOTS)
+            .writeImage(2, specularMapInfos.data(), TEXTURE_SLOTS);
+        if(create){
+            writer.build(set);
+        }else{
+            writer.overwrite(set);
+        }
+    }
+    void FirstApp::touchAssets(){
+        auto touchSlot = [this](const std::vector<uint32_t>& slots, uint32_t index){
+            if(index < slots.size()){
+                residency.touchTexture(slots[index]);
+            }
+        };
+        for(auto& [id, object] : gameObjects){
+            if(object.modelHandle){
+                residency.touchModel(object.modelHandle);
+            }
+            //what the pbr system samples for the object
+            if(object.model != nullptr && object.lightComponent == nullptr && object.cubeMapComponent == nullptr){
+                touchSlot(textures, object.getTextureIndex());
+                touchSlot(normalMaps, object.getNormalIndex());
+                touchSlot(specularMaps, object.getSpecularIndex());
+            }
         }
     }
     int FirstApp::getNumLights(){
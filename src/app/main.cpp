@@ -1,15 +1,111 @@
 #include "first_app.hpp"
+#include "ve_vertex_weld.hpp"
+#include "ve_tangent_generator.hpp"
+#include "ve_model.hpp"
+#include "ve_memory_allocator.hpp"
+#include "ve_host_allocator.hpp"
+#include "ve_frame_arena.hpp"
+#include <cctype>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-    ve::FirstApp app{};
+int main(int argc, char** argv) {
+    //offline micro-benchmarks, these run without creating a window or device
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "--bench-weld") == 0){
+            return ve::VertexWeldTable::benchmark(2000000) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if(std::strcmp(argv[i], "--bench-tangents") == 0){
+            ve::VeTangentGenerator::benchmark(1000000);
+            return EXIT_SUCCESS;
+        }
+        //sub-allocator bookkeeping against a mocked memory type table
+        if(std::strcmp(argv[i], "--bench-allocator") == 0){
+            return ve::VeMemoryAllocator::selfTest(200000) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        //steady state frames built on the frame arena must not touch the global heap
+        if(std::strcmp(argv[i], "--bench-frame-arena") == 0){
+            return ve::VeFrameArena::selfTest(10000) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        //imports a model without a gpu and prints the ACMR/ATVR of the optimisation stage its meshlet culling ratios and LOD chain
+        if(std::strcmp(argv[i], "--mesh-stats") == 0 && i + 1 < argc){
+            try{
+                ve::VeModel::Builder builder{};
+                builder.loadFromFile(argv[i + 1]);
+                std::cout << "Submeshes: " << builder.submeshes.size() << " using " << builder.materials.size() << " materials" << std::endl;
+                builder.optimize();
+                builder.reportOptimize();
+                builder.buildMeshlets();
+                ve::VeMeshlets::report(builder.meshlets);
+                builder.buildLods();
+                ve::VeModel::reportLods(builder.lods.data(), static_cast<uint32_t>(builder.lods.size()));
+            }catch(const std::exception &e){
+                std::cerr << e.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+    }
+    //--sync-uploads restores one submit and wait per upload command, to measure what batching saves
+    //--memory-budget <MiB> warns once device local memory would pass it, --memory-budget-strict makes that an error
+    //--residency-budget <MiB> keeps at most that much model and texture memory resident, evicting the least recently used
+    //--check-frame-allocations [n] reports frames of the running app that still allocate from the global heap, with n it closes
+    //after checking n recorded frames and exits with a failure when any of them allocated
+    //--host-alloc-stats counts the driver's host allocations, --host-alloc-pool also serves the small ones from free lists
+    //--record-threads <n> records the scene on n threads into secondary command buffers, 1 records it inline
+    //--stress-objects <n> adds n cubes to the scene, to compare recording times across thread counts
+    //--frames-in-flight <n> lets the cpu record up to n frames (1 to 4) ahead of the gpu, 2 by default
+    ve::FirstApp::Options options{};
+    bool hostAllocationStats = false;
+    bool hostAllocationPool = false;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "--sync-uploads") == 0){
+            options.synchronousUploads = true;
+        }
+        if(std::strcmp(argv[i], "--memory-budget") == 0 && i + 1 < argc){
+            options.memoryBudget = std::strtoull(argv[i + 1], nullptr, 10) * 1024 * 1024;
+        }
+        if(std::strcmp(argv[i], "--memory-budget-strict") == 0){
+            options.strictMemoryBudget = true;
+        }
+        if(std::strcmp(argv[i], "--residency-budget") == 0 && i + 1 < argc){
+            options.residencyBudget = std::strtoull(argv[i + 1], nullptr, 10) * 1024 * 1024;
+        }
+        if(std::strcmp(argv[i], "--check-frame-allocations") == 0){
+            options.checkFrameAllocations = true;
+            if(i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))){
+                options.allocationCheckFrames = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+            }
+        }
+        if(std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc){
+            options.recordThreads = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        if(std::strcmp(argv[i], "--stress-objects") == 0 && i + 1 < argc){
+            options.stressObjects = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        if(std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc){
+            options.framesInFlight = std::atoi(argv[i + 1]);
+        }
+        if(std::strcmp(argv[i], "--host-alloc-stats") == 0){
+            hostAllocationStats = true;
+        }
+        if(std::strcmp(argv[i], "--host-alloc-pool") == 0){
+            hostAllocationStats = true;
+            hostAllocationPool = true;
+        }
+    }
+    //before the app creates the instance, every object is created and destroyed with the same callbacks
+    if(hostAllocationStats){
+        ve::VeHostAllocator::enable(hostAllocationPool);
+    }
+    ve::FirstApp app{options};
     try{
         app.run();
     }catch(const std::exception &e){
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     }
-    return EXIT_SUCCESS;
+    return app.failedFrameAllocationCheck() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
\ No newline at end of file
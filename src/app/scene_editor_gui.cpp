@@ -3,6 +3,9 @@
 #include "utility.hpp"
 #include <limits.h>
 #include <stdio.h>
+#include <array>
+#include <fstream>
+#include <iostream>
 
 namespace ve{
     SceneEditor::SceneEditor(){
@@ -238,7 +241,7 @@ namespace ve{
                         object.setTextureIndex(0);
                         object.setNormalIndex(0);
                         object.setSpecularIndex(0);
-                        object.model = preLoadedModels[model];
+                        object.setModel(preLoadedModels[model]);
                         char* title = new char[26];
                         snprintf(title, sizeof(title), "%s %d", model.c_str(), object.getId());
                         object.setTitle(title);
@@ -257,10 +260,116 @@ namespace ve{
        ImGui::Text("Select a model: ");
         for(const auto& model: modelFileNames){
             if(ImGui::Selectable(model.c_str())){
-                object.model = preLoadedModels[model];
+                object.setModel(preLoadedModels[model]);
                 ImGui::CloseCurrentPopup();
             }
         }
         ImGui::EndPopup();
     }
+    void SceneEditor::drawLodPanel(float& lodBias, const PbrRenderSystem::LodStats& lodStats){
+        ImGui::Begin("Level of Detail");
+        ImGui::SliderFloat("LOD Bias", &lodBias, -2.0f, 4.0f);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Each step doubles the screen space error allowed before a coarser level is used.");
+        }
+        for(uint32_t lod = 0; lod < VeModel::MAX_LODS; lod++){
+            ImGui::Text("LOD %u: %u objects, %u triangles", lod, lodStats.objects[lod], lodStats.triangles[lod]);
+        }
+        ImGui::Text("Geometry binds: %u", lodStats.geometryBinds);
+        ImGui::End();
+    }
+    void SceneEditor::drawMemoryPanel(VeDevice& device, const VeBuffer::TrafficStats& bufferTraffic, const VeHostAllocator::Stats& hostAllocations,
+                                      const VeFrameArena::Stats& frameArena, uint64_t frameHeapAllocations){
+        constexpr float MIB = 1024.0f * 1024.0f;
+        ImGui::Begin("Memory");
+        VeMemoryAllocator::Stats stats = device.getMemoryAllocator().getStats();
+        VkDeviceSize budget = device.getMemoryAllocator().getBudget();
+        if(budget > 0){
+            ImGui::Text("Device local: %.1f / %.1f MiB budget", stats.deviceLocalBytes / MIB, budget / MIB);
+        }else{
+            ImGui::Text("Device local: %.1f MiB, no budget set", stats.deviceLocalBytes / MIB);
+        }
+        for(uint32_t category = 0; category < MEMORY_CATEGORY_COUNT; category++){
+            ImGui::Text("%s: %.1f MiB in %u", getMemoryCategoryName(static_cast<VeMemoryCategory>(category)),
+                        stats.categoryBytes[category] / MIB, stats.categoryCounts[category]);
+        }
+        ImGui::Separator();
+        ImGui::Text("Heaps (%s)", device.hasMemoryBudget() ? "VK_EXT_memory_budget" : "estimated");
+        std::array<MemoryHeapBudget, VK_MAX_MEMORY_HEAPS> heaps{};
+        uint32_t heapCount = device.queryMemoryBudget(heaps);
+        for(uint32_t i = 0; i < heapCount; i++){
+            //past the driver's budget the driver starts paging or failing allocations
+            ImVec4 color = heaps[i].usage > heaps[i].budget ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+            ImGui::TextColored(color, "%u%s: %.1f / %.1f MiB used, %.1f MiB ours", i, heaps[i].deviceLocal ? " (device local)" : "",
+                               heaps[i].usage / MIB, heaps[i].budget / MIB, heaps[i].allocated / MIB);
+        }
+        if(ImGui::Button("Dump JSON")){
+            std::ofstream report{MEMORY_REPORT_PATH};
+            device.writeMemoryReport(report);
+            std::cout << "Memory report written to " << MEMORY_REPORT_PATH << std::endl;
+        }
+        ImGui::Separator();
+        //host writes of the previous frame and what of them had to be flushed, 0 flushed on coherent memory
+        ImGui::Text("Buffer writes: %llu bytes", static_cast<unsigned long long>(bufferTraffic.bytesWritten));
+        ImGui::Text("Buffer flushes: %llu bytes in %llu calls", static_cast<unsigned long long>(bufferTraffic.bytesFlushed),
+                    static_cast<unsigned long long>(bufferTraffic.flushCalls));
+        ImGui::Separator();
+        //global operator new calls of the previous frame, 0 once the frame arena has grown to fit
+        ImGui::Text("Heap allocations: %llu", static_cast<unsigned long long>(frameHeapAllocations));
+        ImGui::Text("Frame arena: %.1f / %.1f KiB, peak %.1f KiB, %llu spills", frameArena.used / 1024.0f, frameArena.capacity / 1024.0f,
+                    frameArena.peak / 1024.0f, static_cast<unsigned long long>(frameArena.spills));
+        if(VeHostAllocator::isEnabled()){
+            ImGui::Separator();
+            //driver side host allocations of the previous frame, a steady frame loop should not need any
+            ImGui::Text("Driver host allocations: %llu (%llu bytes), %.1f KiB live, peak %.1f KiB",
+                        static_cast<unsigned long long>(hostAllocations.frame.allocations),
+                        static_cast<unsigned long long>(hostAllocations.frame.allocatedBytes),
+                        hostAllocations.liveBytes / 1024.0f, hostAllocations.peakBytes / 1024.0f);
+            for(uint32_t scope = 0; scope < VeHostAllocator::SCOPE_COUNT; scope++){
+                if(hostAllocations.frame.scopeAllocations[scope] > 0){
+                    ImGui::Text("%s scope: %llu", VeHostAllocator::getScopeName(scope),
+                                static_cast<unsigned long long>(hostAllocations.frame.scopeAllocations[scope]));
+                }
+            }
+            for(const auto& [label, allocations]: hostAllocations.frameLabels){
+                ImGui::BulletText("%s: %llu", label.c_str(), static_cast<unsigned long long>(allocations));
+            }
+        }
+        ImGui::End();
+    }
+    void SceneEditor::drawResidencyPanel(VeResidencyManager& residency){
+        constexpr float MIB = 1024.0f * 1024.0f;
+        const auto& stats = residency.getStats();
+        ImGui::Begin("Residency");
+        int budget = static_cast<int>(stats.budget / (1024 * 1024));
+        if(ImGui::SliderInt("Budget (MiB)", &budget, 0, 2048)){
+            residency.setBudget(static_cast<VkDeviceSize>(budget) * 1024 * 1024);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Least recently used models and textures are evicted past this, 0 keeps everything resident.");
+        }
+        ImGui::Text("Resident: %.1f MiB, %u/%u models, %u/%u textures", stats.residentBytes / MIB, stats.residentModels, stats.models,
+                    stats.residentTextures, stats.textures);
+        if(stats.overBudgetBytes > 0){
+            //everything left was drawn within the frames in flight
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%.1f MiB over budget", stats.overBudgetBytes / MIB);
+        }
+        ImGui::Text("Hits: %llu, misses: %llu", static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses));
+        ImGui::Text("Evictions: %llu (%.1f MiB)", static_cast<unsigned long long>(stats.evictions), stats.evictedBytes / MIB);
+        ImGui::End();
+    }
+    void SceneEditor::drawRecordingPanel(float recordMilliseconds, const VeCommandRecorder::Stats* recorderStats){
+        ImGui::Begin("Command Recording");
+        ImGui::Text("Scene pass: %.3f ms", recordMilliseconds);
+        if(recorderStats == nullptr){
+            ImGui::Text("Recorded inline on the main thread");
+            ImGui::End();
+            return;
+        }
+        ImGui::Text("%u secondary command buffers on %u threads", recorderStats->tasks, recorderStats->threads);
+        for(uint32_t thread = 0; thread < recorderStats->threads; thread++){
+            ImGui::Text("Thread %u: %u tasks", thread, recorderStats->threadTasks[thread]);
+        }
+        ImGui::End();
+    }
 }
\ No newline at end of file
@@ -1,10 +1,33 @@
 #include "buffer.hpp"
  
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
  
 namespace ve {
+
+namespace {
+
+// staging, uniform and geometry buffers are the only kinds the engine creates
+VeMemoryCategory getMemoryCategory(VkBufferUsageFlags usageFlags) {
+  if (usageFlags & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+    return VeMemoryCategory::MESH;
+  }
+  if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+    return VeMemoryCategory::UNIFORM;
+  }
+  if (usageFlags & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+    return VeMemoryCategory::STAGING;
+  }
+  return VeMemoryCategory::OTHER;
+}
+
+}  // namespace
+
+std::atomic<uint64_t> VeBuffer::bytesWritten{0};
+std::atomic<uint64_t> VeBuffer::bytesFlushed{0};
+std::atomic<uint64_t> VeBuffer::flushCalls{0};
  
 /**
  * Returns the minimum instance size required to be compatible with devices minOffsetAlignment
@@ -36,18 +59,30 @@ VeBuffer::VeBuffer(
       memoryPropertyFlags{memoryPropertyFlags} {
   alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
   bufferSize = alignmentSize * instanceCount;
-  device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+  device.createBuffer(
+      bufferSize,
+      usageFlags,
+      memoryPropertyFlags,
+      buffer,
+      memory,
+      getMemoryCategory(usageFlags));
+  VkMemoryPropertyFlags typeFlags = device.getMemoryAllocator().getMemoryTypeFlags(memory.memoryType);
+  coherent = !(typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || (typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  atomSize = device.getMemoryAllocator().getNonCoherentAtomSize();
 }
  
 VeBuffer::~VeBuffer() {
   unmap();
-  vkDestroyBuffer(veDevice.device(), buffer, nullptr);
-  vkFreeMemory(veDevice.device(), memory, nullptr);
+  vkDestroyBuffer(veDevice.device(), buffer, veDevice.allocationCallbacks());
+  veDevice.freeMemory(memory);
 }
  
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host visible blocks stay mapped for their whole lifetime, this only hands out a pointer into
+ * them
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
@@ -55,20 +90,21 @@ VeBuffer::~VeBuffer() {
  * @return VkResult of the buffer mapping call
  */
 VkResult VeBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-  assert(buffer && memory && "Called map on buffer before create");
-  return vkMapMemory(veDevice.device(), memory, offset, size, 0, &mapped);
+  assert(buffer && memory.memory && "Called map on buffer before create");
+  if (!memory.mapped) {
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+  mapped = static_cast<char *>(memory.mapped) + offset;
+  return VK_SUCCESS;
 }
  
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The block itself stays mapped until the allocator releases it
  */
 void VeBuffer::unmap() {
-  if (mapped) {
-    vkUnmapMemory(veDevice.device(), memory);
-    mapped = nullptr;
-  }
+  mapped = nullptr;
 }
  
 /**
@@ -85,30 +121,106 @@ void VeBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset)
  
   if (size == VK_WHOLE_SIZE) {
     memcpy(mapped, data, bufferSize);
+    size = bufferSize;
+    offset = 0;
   } else {
     char *memOffset = (char *)mapped;
     memOffset += offset;
     memcpy(memOffset, data, size);
   }
+  bytesWritten += size;
+  markDirty(offset, offset + size);
+}
+
+/**
+ * Records a written range for the next whole buffer flush, merged with the ranges it touches
+ *
+ * @note Ranges are widened to whole atoms first, so neighbouring writes inside one atom become one
+ * range. The allocator places non-coherent memory on atom boundaries, so buffer relative alignment
+ * is block relative alignment as well
+ */
+void VeBuffer::markDirty(VkDeviceSize begin, VkDeviceSize end) {
+  if (coherent || begin >= end) {
+    return;
+  }
+  begin = begin & ~(atomSize - 1);
+  end = std::min((end + atomSize - 1) & ~(atomSize - 1), memory.size);
+  auto it = std::lower_bound(
+      dirtyRanges.begin(),
+      dirtyRanges.end(),
+      begin,
+      [](const std::pair<VkDeviceSize, VkDeviceSize> &range, VkDeviceSize value) {
+        return range.second < value;
+      });
+  // every range from it on that starts at or before end overlaps or touches the new one
+  auto last = it;
+  while (last != dirtyRanges.end() && last->first <= end) {
+    begin = std::min(begin, last->first);
+    end = std::max(end, last->second);
+    ++last;
+  }
+  it = dirtyRanges.erase(it, last);
+  dirtyRanges.insert(it, {begin, end});
 }
  
 /**
  * Flush a memory range of the buffer to make it visible to the device
  *
- * @note Only required for non-coherent memory
+ * @note Only required for non-coherent memory, a no-op on coherent memory
  *
- * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
- * complete buffer range.
+ * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush every
+ * range written through writeToBuffer since the last flush, writes through the mapped pointer
+ * have to flush their own range.
  * @param offset (Optional) Byte offset from beginning
  *
  * @return VkResult of the flush call
  */
 VkResult VeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
+  if (coherent) {
+    return VK_SUCCESS;
+  }
+  if (size != VK_WHOLE_SIZE) {
+    VkDeviceSize begin = offset & ~(atomSize - 1);
+    VkDeviceSize end = std::min((offset + size + atomSize - 1) & ~(atomSize - 1), memory.size);
+    // the explicit range covers these, they need no second flush
+    dirtyRanges.erase(
+        std::remove_if(
+            dirtyRanges.begin(),
+            dirtyRanges.end(),
+            [&](const std::pair<VkDeviceSize, VkDeviceSize> &range) {
+              return range.first >= begin && range.second <= end;
+            }),
+        dirtyRanges.end());
+    return flushRange(begin, end);
+  }
+  if (dirtyRanges.empty()) {
+    return VK_SUCCESS;
+  }
+  std::vector<VkMappedMemoryRange> mappedRanges(dirtyRanges.size());
+  for (size_t i = 0; i < dirtyRanges.size(); i++) {
+    mappedRanges[i].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRanges[i].memory = memory.memory;
+    mappedRanges[i].offset = memory.offset + dirtyRanges[i].first;
+    mappedRanges[i].size = dirtyRanges[i].second - dirtyRanges[i].first;
+    bytesFlushed += mappedRanges[i].size;
+  }
+  flushCalls++;
+  dirtyRanges.clear();
+  return vkFlushMappedMemoryRanges(
+      veDevice.device(),
+      static_cast<uint32_t>(mappedRanges.size()),
+      mappedRanges.data());
+}
+
+VkResult VeBuffer::flushRange(VkDeviceSize begin, VkDeviceSize end) {
   VkMappedMemoryRange mappedRange = {};
   mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
+  mappedRange.memory = memory.memory;
+  // ranges are relative to the whole block, VK_WHOLE_SIZE would run into the neighbouring allocations
+  mappedRange.offset = memory.offset + begin;
+  mappedRange.size = end - begin;
+  bytesFlushed += mappedRange.size;
+  flushCalls++;
   return vkFlushMappedMemoryRanges(veDevice.device(), 1, &mappedRange);
 }
  
@@ -124,11 +236,15 @@ VkResult VeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
  * @return VkResult of the invalidate call
  */
 VkResult VeBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
+  if (coherent) {
+    return VK_SUCCESS;
+  }
   VkMappedMemoryRange mappedRange = {};
   mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
+  mappedRange.memory = memory.memory;
+  // ranges are relative to the whole block, VK_WHOLE_SIZE would run into the neighbouring allocations
+  mappedRange.offset = memory.offset + offset;
+  mappedRange.size = size == VK_WHOLE_SIZE ? memory.size - offset : size;
   return vkInvalidateMappedMemoryRanges(veDevice.device(), 1, &mappedRange);
 }
  
@@ -191,4 +307,14 @@ VkResult VeBuffer::invalidateIndex(int index) {
   return invalidate(alignmentSize, index * alignmentSize);
 }
  
+VeBuffer::TrafficStats VeBuffer::getTrafficStats() {
+  return TrafficStats{bytesWritten.load(), bytesFlushed.load(), flushCalls.load()};
+}
+
+void VeBuffer::resetTrafficStats() {
+  bytesWritten = 0;
+  bytesFlushed = 0;
+  flushCalls = 0;
+}
+ 
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "cube_map.hpp"
 #include <stb_image.h>
+#include <cstring>
 #include <iostream>
 namespace ve{
     CubeMap::CubeMap(VeDevice& veDevice, bool nearestFilter): 
@@ -14,22 +15,20 @@ namespace ve{
         imageView(VK_NULL_HANDLE),
         imageLayout(VK_IMAGE_LAYOUT_UNDEFINED),
         image(VK_NULL_HANDLE),
-        deviceMemory(VK_NULL_HANDLE) {
+        deviceMemory{} {
     }
     CubeMap::~CubeMap() {
         std::cout<<"CubeMap destructor"<<std::endl;
         if (image != VK_NULL_HANDLE) {
-            vkDestroyImage(device.device(), image, nullptr);
+            vkDestroyImage(device.device(), image, device.allocationCallbacks());
         }
         if (imageView != VK_NULL_HANDLE) {
-            vkDestroyImageView(device.device(), imageView, nullptr);
+            vkDestroyImageView(device.device(), imageView, device.allocationCallbacks());
         }
         if (sampler != VK_NULL_HANDLE) {
-            vkDestroySampler(device.device(), sampler, nullptr);
-        }
-        if (deviceMemory != VK_NULL_HANDLE) {
-            vkFreeMemory(device.device(), deviceMemory, nullptr);
+            vkDestroySampler(device.device(), sampler, device.allocationCallbacks());
         }
+        device.freeMemory(deviceMemory);
     }
     // In cube_map.cpp:
     CubeMap::CubeMap(CubeMap&& other) noexcept : 
@@ -54,16 +53,16 @@ namespace ve{
         other.image = VK_NULL_HANDLE;
         other.imageView = VK_NULL_HANDLE;
         other.sampler = VK_NULL_HANDLE;
-        other.deviceMemory = VK_NULL_HANDLE;
+        other.deviceMemory = VeAllocation{};
     }
 
     CubeMap& CubeMap::operator=(CubeMap&& other) noexcept {
         if (this != &other) {
             // Clean up existing resources
-            vkDestroyImage(device.device(), image, nullptr);
-            vkDestroyImageView(device.device(), imageView, nullptr);
-            vkDestroySampler(device.device(), sampler, nullptr);
-            vkFreeMemory(device.device(), deviceMemory, nullptr);
+            vkDestroyImage(device.device(), image, device.allocationCallbacks());
+            vkDestroyImageView(device.device(), imageView, device.allocationCallbacks());
+            vkDestroySampler(device.device(), sampler, device.allocationCallbacks());
+            device.freeMemory(deviceMemory);
         
             // Copy basic members
             nearestFilter = other.nearestFilter;
@@ -86,52 +85,19 @@ namespace ve{
             other.image = VK_NULL_HANDLE;
             other.imageView = VK_NULL_HANDLE;
             other.sampler = VK_NULL_HANDLE;
-            other.deviceMemory = VK_NULL_HANDLE;
+            other.deviceMemory = VeAllocation{};
         }
         return *this;
     }
-    bool CubeMap::init(const std::vector<std::string>& filePaths, bool srgb, bool flip){
+    bool CubeMap::init(VeUploadContext& uploadContext, const std::vector<std::string>& filePaths, bool srgb, bool flip){
         bool success = true;
         stbi_set_flip_vertically_on_load(flip);
         fileNames = filePaths;
         this->srgb = srgb;
-        success = create();
+        success = create(uploadContext);
         std::cout<<"CubeMap created"<<std::endl;
         return success;
     }
-    void CubeMap::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout){
-        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = mipLevels;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = CUBE_MAP_FACE_COUNT;
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-        if(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL){
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        }else if(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL){
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        }else{
-            throw std::invalid_argument("unsupported layout transition!");
-        }
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-        device.endSingleTimeCommands(commandBuffer);
-        imageLayout = newLayout;
-    }
     void CubeMap::createImage(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties){
         this->format = format;
         VkImageCreateInfo imageInfo{};
@@ -149,90 +115,39 @@ namespace ve{
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-        if(vkCreateImage(device.device(), &imageInfo, nullptr, &image) != VK_SUCCESS){
-            throw std::runtime_error("failed to create image!");
-        }
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device.device(), image, &memRequirements);
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, properties);
-        if(vkAllocateMemory(device.device(), &allocInfo, nullptr, &deviceMemory) != VK_SUCCESS){
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-        vkBindImageMemory(device.device(), image, deviceMemory, 0);
-    }
-
-    void CubeMap::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory){
-        VkBufferCreateInfo bufferInfo{};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = size;
-        bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        if(vkCreateBuffer(device.device(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS){
-            throw std::runtime_error("failed to create buffer!");
-        }
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device.device(), buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, properties);
-        if(vkAllocateMemory(device.device(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS){
-            throw std::runtime_error("failed to allocate buffer memory!");
-        }
-        vkBindBufferMemory(device.device(), buffer, bufferMemory, 0);
+        device.createImageWithInfo(imageInfo, properties, image, deviceMemory, VeMemoryCategory::TEXTURE);
     }
-    bool CubeMap::create(){
-        VkDeviceSize layerSize;
-        VkDeviceSize imageSize;
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        void* data;
-        uint64_t memAddress;
-        stbi_uc* pixels;
 
+    bool CubeMap::create(VeUploadContext& uploadContext){
+        VkDeviceSize layerSize = 0;
+        std::vector<stbi_uc> faces;
         for(int i=0; i<CUBE_MAP_FACE_COUNT; i++){
             //req_comp = STBI_rgb_alpha == 4
             std::string fullPath = std::string(ENGINE_DIR) + fileNames[i];
             std::cout<<"Loading cubemap: "<<fullPath<<std::endl;
-            pixels = stbi_load(fullPath.c_str(), &width, &height, &bytesPerPixel, 4);
+            stbi_uc* pixels = stbi_load(fullPath.c_str(), &width, &height, &bytesPerPixel, 4);
             if(pixels == nullptr){
                 std::cerr << "Failed to load texture image!" << std::endl;
                 return false;
             }
             if(i==0){
-                layerSize = width * height * 4;
-                imageSize = layerSize * CUBE_MAP_FACE_COUNT;
-                createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                            stagingBuffer, stagingBufferMemory);
-                vkMapMemory(device.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-                memAddress = reinterpret_cast<uint64_t>(data);
+                layerSize = static_cast<VkDeviceSize>(width) * height * 4;
+                faces.resize(layerSize * CUBE_MAP_FACE_COUNT);
             }
-            memcpy(reinterpret_cast<void*>(memAddress), static_cast<void*>(pixels), static_cast<size_t>(layerSize));
+            //the faces are the image's array layers, tightly packed one after the other
+            memcpy(faces.data() + layerSize * i, pixels, static_cast<size_t>(layerSize));
             stbi_image_free(pixels);
-            memAddress += layerSize;
         }
-        vkUnmapMemory(device.device(), stagingBufferMemory);
         VkFormat format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
         createImage(format, 
                     VK_IMAGE_TILING_OPTIMAL, 
                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
                 );
-        transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        device.copyBufferToImage(stagingBuffer, 
-                                image, 
-                                static_cast<uint32_t>(width), 
-                                static_cast<uint32_t>(height), 
-                                CUBE_MAP_FACE_COUNT
-                            );
-        transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-        vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+        uploadContext.transitionImageLayout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, CUBE_MAP_FACE_COUNT);
+        uploadContext.uploadImage(faces.data(), faces.size(), image, static_cast<uint32_t>(width), static_cast<uint32_t>(height), CUBE_MAP_FACE_COUNT);
+        uploadContext.transitionImageLayout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels, CUBE_MAP_FACE_COUNT);
+        imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         //create sampler
         VkSamplerCreateInfo samplerInfo{};
@@ -251,7 +166,7 @@ namespace ve{
         samplerInfo.minLod = 0;
         samplerInfo.maxLod = static_cast<float>(mipLevels);
         samplerInfo.mipLodBias = 0;
-        if(vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS){
+        if(vkCreateSampler(device.device(), &samplerInfo, device.allocationCallbacks(), &sampler) != VK_SUCCESS){
             throw std::runtime_error("failed to create cube map texture sampler!");
         }
         //imageView
@@ -269,7 +184,7 @@ namespace ve{
         viewInfo.subresourceRange.levelCount = mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = CUBE_MAP_FACE_COUNT;
-        if(vkCreateImageView(device.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS){
+        if(vkCreateImageView(device.device(), &viewInfo, device.allocationCallbacks(), &imageView) != VK_SUCCESS){
             throw std::runtime_error("failed to create texture image view!");
         }
         std::cout<<"Successfully loaded cubemaps"<<std::endl;
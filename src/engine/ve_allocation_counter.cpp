@@ -0,0 +1,100 @@
+#include "ve_allocation_counter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace ve{
+    namespace{
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> frees{0};
+
+        void* allocate(std::size_t size){
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            return std::malloc(size == 0 ? 1 : size);
+        }
+        void* allocateAligned(std::size_t size, std::align_val_t alignment){
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+            return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+            //aligned_alloc wants the size to be a multiple of the alignment
+            return std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+#endif
+        }
+        void release(void* memory){
+            if(memory != nullptr){
+                frees.fetch_add(1, std::memory_order_relaxed);
+                std::free(memory);
+            }
+        }
+        void releaseAligned(void* memory){
+            if(memory != nullptr){
+                frees.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+                _aligned_free(memory);
+#else
+                std::free(memory);
+#endif
+            }
+        }
+    }
+
+    uint64_t VeAllocationCounter::getAllocations(){
+        return allocations.load(std::memory_order_relaxed);
+    }
+    uint64_t VeAllocationCounter::getFrees(){
+        return frees.load(std::memory_order_relaxed);
+    }
+}
+
+//replaces the global allocation functions, the array and nothrow forms are spelled out so none of them slip past the counter
+void* operator new(std::size_t size){
+    void* memory = ve::allocate(size);
+    if(memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept{
+    return ve::allocate(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept{
+    return ve::allocate(size);
+}
+void* operator new(std::size_t size, std::align_val_t alignment){
+    void* memory = ve::allocateAligned(size, alignment);
+    if(memory == nullptr){
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+void* operator new[](std::size_t size, std::align_val_t alignment){
+    return operator new(size, alignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept{
+    return ve::allocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept{
+    return ve::allocateAligned(size, alignment);
+}
+void operator delete(void* memory) noexcept{ ve::release(memory); }
+void operator delete[](void* memory) noexcept{ ve::release(memory); }
+void operator delete(void* memory, std::size_t) noexcept{ ve::release(memory); }
+void operator delete[](void* memory, std::size_t) noexcept{ ve::release(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept{ ve::release(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept{ ve::release(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept{ ve::releaseAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept{ ve::releaseAligned(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept{ ve::releaseAligned(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept{ ve::releaseAligned(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept{ ve::releaseAligned(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept{ ve::releaseAligned(memory); }
@@ -0,0 +1,168 @@
+#include "ve_command_recorder.hpp"
+#include "ve_parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace ve{
+    VeCommandRecorder::VeCommandRecorder(VeDevice& device, int framesInFlight, uint32_t threadCount): veDevice{device}{
+        if(threadCount == 0){
+            threadCount = workerThreadCount();
+        }
+        threadCount = std::clamp<uint32_t>(threadCount, 1, MAX_THREADS);
+        threads.resize(threadCount);
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = veDevice.graphicsQueueFamilyIndex();
+        //reset as a whole every frame, never per buffer
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        for(auto& state: threads){
+            state.pools.resize(framesInFlight, VK_NULL_HANDLE);
+            state.buffers.resize(framesInFlight);
+            for(auto& pool: state.pools){
+                if(vkCreateCommandPool(veDevice.device(), &poolInfo, veDevice.allocationCallbacks(), &pool) != VK_SUCCESS){
+                    throw std::runtime_error("failed to create recording command pool!");
+                }
+            }
+        }
+        stats.threads = threadCount;
+        for(uint32_t thread = 1; thread < threadCount; thread++){
+            workers.emplace_back(&VeCommandRecorder::workerLoop, this, thread);
+        }
+    }
+    VeCommandRecorder::~VeCommandRecorder(){
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for(auto& worker: workers){
+            worker.join();
+        }
+        //destroying a pool frees its buffers, the caller has waited for the device before tearing the renderer down
+        for(auto& state: threads){
+            for(auto pool: state.pools){
+                vkDestroyCommandPool(veDevice.device(), pool, veDevice.allocationCallbacks());
+            }
+        }
+    }
+
+    void VeCommandRecorder::beginFrame(int frameIndex){
+        this->frameIndex = frameIndex;
+        for(auto& state: threads){
+            vkResetCommandPool(veDevice.device(), state.pools[frameIndex], 0);
+            state.used = 0;
+        }
+    }
+
+    VkCommandBuffer VeCommandRecorder::acquireBuffer(ThreadState& state){
+        auto& buffers = state.buffers[frameIndex];
+        if(state.used == buffers.size()){
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandPool = state.pools[frameIndex];
+            allocInfo.commandBufferCount = 1;
+            VkCommandBuffer commandBuffer;
+            if(vkAllocateCommandBuffers(veDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS){
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+            buffers.push_back(commandBuffer);
+        }
+        return buffers[state.used++];
+    }
+
+    void VeCommandRecorder::recordTasks(uint32_t thread){
+        ThreadState& state = threads[thread];
+        state.tasks = 0;
+        try{
+            for(uint32_t task = nextTask.fetch_add(1); task < job->taskCount; task = nextTask.fetch_add(1)){
+                VkCommandBuffer commandBuffer = acquireBuffer(state);
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                beginInfo.pInheritanceInfo = &job->inheritance;
+                if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS){
+                    throw std::runtime_error("failed to begin recording secondary command buffer!");
+                }
+                //dynamic state is not inherited from the primary
+                VkViewport viewport{0.0f, 0.0f, static_cast<float>(job->extent.width), static_cast<float>(job->extent.height), 0.0f, 1.0f};
+                VkRect2D scissor{{0, 0}, job->extent};
+                vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+                vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+                job->invoke(job->callable, task, commandBuffer);
+                if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+                    throw std::runtime_error("failed to record secondary command buffer!");
+                }
+                taskBuffers[task] = commandBuffer;
+                state.tasks++;
+            }
+        }catch(...){
+            state.error = std::current_exception();
+            //the others stop taking new tasks
+            nextTask.store(job->taskCount);
+        }
+    }
+
+    void VeCommandRecorder::workerLoop(uint32_t thread){
+        uint64_t seen = 0;
+        while(true){
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                workAvailable.wait(lock, [&]{ return stopping || generation != seen; });
+                if(stopping){
+                    return;
+                }
+                seen = generation;
+            }
+            recordTasks(thread);
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                busyWorkers--;
+            }
+            workDone.notify_one();
+        }
+    }
+
+    void VeCommandRecorder::run(VkCommandBuffer primary, const Job& job){
+        auto start = std::chrono::high_resolution_clock::now();
+        if(taskBuffers.size() < job.taskCount){
+            taskBuffers.resize(job.taskCount);
+        }
+        this->job = &job;
+        nextTask.store(0);
+        //no point waking workers for a single task
+        bool parallel = !workers.empty() && job.taskCount > 1;
+        if(parallel){
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                busyWorkers = static_cast<uint32_t>(workers.size());
+                generation++;
+            }
+            workAvailable.notify_all();
+        }
+        recordTasks(0);
+        if(parallel){
+            std::unique_lock<std::mutex> lock{mutex};
+            workDone.wait(lock, [this]{ return busyWorkers == 0; });
+        }
+        this->job = nullptr;
+        stats.tasks = job.taskCount;
+        std::exception_ptr error;
+        for(uint32_t thread = 0; thread < threads.size(); thread++){
+            stats.threadTasks[thread] = parallel || thread == 0 ? threads[thread].tasks : 0;
+            if(threads[thread].error && !error){
+                error = threads[thread].error;
+            }
+            threads[thread].error = nullptr;
+        }
+        if(error){
+            std::rethrow_exception(error);
+        }
+        if(job.taskCount > 0){
+            vkCmdExecuteCommands(primary, job.taskCount, taskBuffers.data());
+        }
+        stats.milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
@@ -46,14 +46,14 @@ namespace ve {
         if (vkCreateDescriptorSetLayout(
                 veDevice.device(),
                 &descriptorSetLayoutInfo,
-                nullptr,
+                veDevice.allocationCallbacks(),
                 &descriptorSetLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
     }
     
     VeDescriptorSetLayout::~VeDescriptorSetLayout() {
-        vkDestroyDescriptorSetLayout(veDevice.device(), descriptorSetLayout, nullptr);
+        vkDestroyDescriptorSetLayout(veDevice.device(), descriptorSetLayout, veDevice.allocationCallbacks());
     }
     
     // *************** Descriptor Pool Builder *********************
@@ -95,14 +95,14 @@ namespace ve {
         descriptorPoolInfo.maxSets = maxSets;
         descriptorPoolInfo.flags = poolFlags;
         
-        if (vkCreateDescriptorPool(veDevice.device(), &descriptorPoolInfo, nullptr, &descriptorPool) !=
+        if (vkCreateDescriptorPool(veDevice.device(), &descriptorPoolInfo, veDevice.allocationCallbacks(), &descriptorPool) !=
             VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor pool!");
         }
     }
     
     VeDescriptorPool::~VeDescriptorPool() {
-        vkDestroyDescriptorPool(veDevice.device(), descriptorPool, nullptr);
+        vkDestroyDescriptorPool(veDevice.device(), descriptorPool, veDevice.allocationCallbacks());
     }
     
     bool VeDescriptorPool::allocateDescriptor(
@@ -197,6 +197,7 @@ namespace ve {
         for (auto &write : writes) {
             write.dstSet = set;
         }
+        VeHostAllocator::Label label{"vkUpdateDescriptorSets"};
         vkUpdateDescriptorSets(pool.veDevice.device(), writes.size(), writes.data(), 0, nullptr);
     }
  
@@ -47,25 +47,36 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-VeDevice::VeDevice(VeWindow &window) : window{window} {
+VeDevice::VeDevice(VeWindow &window)
+    : allocationCallbacks_{VeHostAllocator::getCallbacks()}, window{window} {
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  createMemoryAllocator();
 }
 
 VeDevice::~VeDevice() {
-  vkDestroyCommandPool(device_, commandPool, nullptr);
-  vkDestroyDevice(device_, nullptr);
+  computeTimeline.reset();
+  graphicsTimeline.reset();
+  if (transferCommandPool != commandPool) {
+    vkDestroyCommandPool(device_, transferCommandPool, allocationCallbacks_);
+  }
+  if (computeCommandPool != commandPool) {
+    vkDestroyCommandPool(device_, computeCommandPool, allocationCallbacks_);
+  }
+  vkDestroyCommandPool(device_, commandPool, allocationCallbacks_);
+  memoryAllocator.reset();
+  vkDestroyDevice(device_, allocationCallbacks_);
 
   if (enableValidationLayers) {
-    DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+    DestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocationCallbacks_);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
-  vkDestroyInstance(instance, nullptr);
+  vkDestroySurfaceKHR(instance, surface_, allocationCallbacks_);
+  vkDestroyInstance(instance, allocationCallbacks_);
 }
 
 void VeDevice::createInstance() {
@@ -79,7 +90,8 @@ void VeDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // timeline semaphores are core from 1.2 on, frame pacing and upload retirement are built on them
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -106,7 +118,7 @@ void VeDevice::createInstance() {
     createInfo.pNext = nullptr;
   }
 
-  if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+  if (vkCreateInstance(&createInfo, allocationCallbacks_, &instance) != VK_SUCCESS) {
     throw std::runtime_error("failed to create instance!");
   }
 
@@ -144,14 +156,29 @@ void VeDevice::createLogicalDevice() {
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  if (indices.transferFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.transferFamily);
+  }
+  if (indices.computeFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.computeFamily);
+  }
+  // when uploads settled on the compute family, compute takes its second queue if there is one
+  uint32_t computeQueueIndex = 0;
+  if (indices.computeFamilyHasValue && indices.transferFamilyHasValue && indices.computeFamily == indices.transferFamily) {
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    computeQueueIndex = queueFamilies[indices.computeFamily].queueCount > 1 ? 1 : 0;
+  }
 
-  float queuePriority = 1.0f;
+  float queuePriorities[] = {1.0f, 1.0f};
   for (uint32_t queueFamily : uniqueQueueFamilies) {
     VkDeviceQueueCreateInfo queueCreateInfo = {};
     queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queueCreateInfo.queueFamilyIndex = queueFamily;
-    queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
+    queueCreateInfo.queueCount = indices.computeFamilyHasValue && queueFamily == indices.computeFamily ? computeQueueIndex + 1 : 1;
+    queueCreateInfo.pQueuePriorities = queuePriorities;
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
@@ -165,8 +192,18 @@ void VeDevice::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   createInfo.pEnabledFeatures = &deviceFeatures;
-  createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+  timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+  timelineFeatures.timelineSemaphore = VK_TRUE;
+  createInfo.pNext = &timelineFeatures;
+  // optional, only queried, the properties2 instance extension it needs is always enabled
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  memoryBudgetSupported = hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if (memoryBudgetSupported) {
+    enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation layers
   // have been deprecated
@@ -177,12 +214,28 @@ void VeDevice::createLogicalDevice() {
     createInfo.enabledLayerCount = 0;
   }
 
-  if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device_) != VK_SUCCESS) {
+  if (vkCreateDevice(physicalDevice, &createInfo, allocationCallbacks_, &device_) != VK_SUCCESS) {
     throw std::runtime_error("failed to create logical device!");
   }
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  // uploads fall back to the graphics queue when there is no separate copy queue
+  transferFamily_ = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+  vkGetDeviceQueue(device_, transferFamily_, 0, &transferQueue_);
+  // compute work falls back to the graphics queue and timeline the same way
+  computeFamily_ = indices.computeFamilyHasValue ? indices.computeFamily : indices.graphicsFamily;
+  vkGetDeviceQueue(device_, computeFamily_, indices.computeFamilyHasValue ? computeQueueIndex : 0, &computeQueue_);
+  graphicsTimeline = std::make_unique<VeTimeline>(device_, allocationCallbacks_, graphicsQueue_);
+  if (hasDedicatedComputeQueue()) {
+    computeTimeline = std::make_unique<VeTimeline>(device_, allocationCallbacks_, computeQueue_);
+  }
+  std::cout << "Transfer queue family: " << transferFamily_
+            << (indices.transferFamilyHasValue ? " (dedicated)" : " (shared with graphics)") << std::endl;
+  std::cout << "Compute queue family: " << computeFamily_
+            << (indices.computeFamilyHasValue ? (computeQueue_ == transferQueue_ ? " (async, shared with transfer)" : " (async)")
+                                              : " (shared with graphics)") << std::endl;
+  std::cout << "Memory budget: " << (memoryBudgetSupported ? "VK_EXT_memory_budget" : "estimated") << std::endl;
 }
 
 void VeDevice::createCommandPool() {
@@ -194,12 +247,27 @@ void VeDevice::createCommandPool() {
   poolInfo.flags =
       VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+  if (vkCreateCommandPool(device_, &poolInfo, allocationCallbacks_, &commandPool) != VK_SUCCESS) {
     throw std::runtime_error("failed to create command pool!");
   }
+
+  transferCommandPool = commandPool;
+  if (hasDedicatedTransferQueue()) {
+    poolInfo.queueFamilyIndex = transferFamily_;
+    if (vkCreateCommandPool(device_, &poolInfo, allocationCallbacks_, &transferCommandPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create transfer command pool!");
+    }
+  }
+  computeCommandPool = commandPool;
+  if (hasDedicatedComputeQueue()) {
+    poolInfo.queueFamilyIndex = computeFamily_;
+    if (vkCreateCommandPool(device_, &poolInfo, allocationCallbacks_, &computeCommandPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create compute command pool!");
+    }
+  }
 }
 
-void VeDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void VeDevice::createSurface() { window.createWindowSurface(instance, &surface_, allocationCallbacks_); }
 
 bool VeDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
@@ -215,8 +283,22 @@ bool VeDevice::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+  // features2 is only valid to query on 1.1 and newer devices
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  bool timelineSupported = false;
+  if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    timelineSupported = timelineFeatures.timelineSemaphore;
+  }
+
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         supportedFeatures.samplerAnisotropy && timelineSupported;
 }
 
 void VeDevice::populateDebugMessengerCreateInfo(
@@ -236,7 +318,7 @@ void VeDevice::setupDebugMessenger() {
   if (!enableValidationLayers) return;
   VkDebugUtilsMessengerCreateInfoEXT createInfo;
   populateDebugMessengerCreateInfo(createInfo);
-  if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+  if (CreateDebugUtilsMessengerEXT(instance, &createInfo, allocationCallbacks_, &debugMessenger) != VK_SUCCESS) {
     throw std::runtime_error("failed to set up debug messenger!");
   }
 }
@@ -358,6 +440,19 @@ bool VeDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool VeDevice::hasDeviceExtension(VkPhysicalDevice device, const char *name) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+  for (const auto &extension : availableExtensions) {
+    if (strcmp(extension.extensionName, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices VeDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -386,6 +481,35 @@ QueueFamilyIndices VeDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  // prefer a pure copy family over an async compute one, both run beside the graphics queue
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) ||
+        (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    bool computeCapable = flags & VK_QUEUE_COMPUTE_BIT;
+    if (!indices.transferFamilyHasValue || !computeCapable) {
+      indices.transferFamily = family;
+      indices.transferFamilyHasValue = true;
+    }
+    if (!computeCapable) {
+      break;
+    }
+  }
+  // the first family that computes without drawing, a separate one from the copy family when the device has both
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_COMPUTE_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    if (!indices.computeFamilyHasValue ||
+        (indices.transferFamilyHasValue && indices.computeFamily == indices.transferFamily)) {
+      indices.computeFamily = family;
+      indices.computeFamilyHasValue = true;
+    }
+  }
+
   return indices;
 }
 
@@ -444,35 +568,45 @@ uint32_t VeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pro
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+void VeDevice::createMemoryAllocator() {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  memoryAllocator = std::make_unique<VeMemoryAllocator>(
+      memProperties,
+      properties.limits.bufferImageGranularity,
+      properties.limits.nonCoherentAtomSize,
+      VeMemoryAllocator::createVulkanBackend(device_, allocationCallbacks_));
+}
+
 void VeDevice::createBuffer(
     VkDeviceSize size,
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    VeAllocation &bufferMemory,
+    VeMemoryCategory category) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+  VeHostAllocator::Label label{"vkCreateBuffer"};
+  if (vkCreateBuffer(device_, &bufferInfo, allocationCallbacks_, &buffer) != VK_SUCCESS) {
     throw std::runtime_error("failed to create vertex buffer!");
   }
 
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferMemory = memoryAllocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      VeMemoryAllocator::ResourceKind::LINEAR,
+      false,
+      category);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
-  }
-
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+  vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 VkCommandBuffer VeDevice::beginSingleTimeCommands() {
@@ -496,13 +630,8 @@ VkCommandBuffer VeDevice::beginSingleTimeCommands() {
 void VeDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkEndCommandBuffer(commandBuffer);
 
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &commandBuffer;
-
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  // through the timeline like every other graphics submission, its value also covers everything submitted before
+  graphicsTimeline->wait(graphicsTimeline->submit(1, &commandBuffer));
 
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
@@ -550,26 +679,87 @@ void VeDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
-  if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+    VeAllocation &imageMemory,
+    VeMemoryCategory category) {
+  VeHostAllocator::Label label{"vkCreateImage"};
+  if (vkCreateImage(device_, &imageInfo, allocationCallbacks_, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
 
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  // render targets are recreated with the swap chain, giving them their own memory keeps them from fragmenting the blocks
+  bool renderTarget =
+      (imageInfo.usage &
+       (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+  imageMemory = memoryAllocator->allocate(
+      memRequirements,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? VeMemoryAllocator::ResourceKind::OPTIMAL
+                                                  : VeMemoryAllocator::ResourceKind::LINEAR,
+      renderTarget,
+      category);
+
+  if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
+    throw std::runtime_error("failed to bind image memory!");
+  }
+}
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
+uint32_t VeDevice::queryMemoryBudget(std::array<MemoryHeapBudget, VK_MAX_MEMORY_HEAPS> &heaps) {
+  const VkPhysicalDeviceMemoryProperties &memProperties = memoryAllocator->getMemoryProperties();
+  VeMemoryAllocator::Stats stats = memoryAllocator->getStats();
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+  budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+  if (memoryBudgetSupported) {
+    // core since 1.1, the instance targets VK_API_VERSION_1_2 and isDeviceSuitable requires a 1.2 device
+    VkPhysicalDeviceMemoryProperties2 memProperties2{};
+    memProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memProperties2.pNext = &budgetProperties;
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memProperties2);
   }
+  for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+    heaps[i].size = memProperties.memoryHeaps[i].size;
+    heaps[i].allocated = stats.heapBytes[i];
+    heaps[i].deviceLocal = memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    if (budgetProperties.heapBudget[i] > 0) {
+      heaps[i].budget = budgetProperties.heapBudget[i];
+      heaps[i].usage = budgetProperties.heapUsage[i];
+    } else {
+      heaps[i].budget = heaps[i].size / 10 * 8;
+      heaps[i].usage = stats.heapBytes[i];
+    }
+  }
+  return memProperties.memoryHeapCount;
+}
 
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
-    throw std::runtime_error("failed to bind image memory!");
+void VeDevice::writeMemoryReport(std::ostream &out) {
+  VeMemoryAllocator::Stats stats = memoryAllocator->getStats();
+  out << "{\n";
+  out << "  \"device\": \"" << properties.deviceName << "\",\n";
+  out << "  \"memoryBudgetExtension\": " << (memoryBudgetSupported ? "true" : "false") << ",\n";
+  out << "  \"configuredBudget\": " << memoryAllocator->getBudget() << ",\n";
+  out << "  \"deviceLocalBytes\": " << stats.deviceLocalBytes << ",\n";
+  out << "  \"blocks\": {\"count\": " << stats.blockCount << ", \"bytes\": " << stats.blockBytes
+      << ", \"usedBytes\": " << stats.usedBytes << ", \"fragmentation\": " << stats.fragmentation << "},\n";
+  out << "  \"dedicated\": {\"count\": " << stats.dedicatedCount << ", \"bytes\": " << stats.dedicatedBytes << "},\n";
+  out << "  \"deviceAllocations\": " << stats.deviceAllocations << ",\n";
+  out << "  \"categories\": {";
+  for (uint32_t category = 0; category < MEMORY_CATEGORY_COUNT; category++) {
+    out << (category > 0 ? ", " : "") << "\"" << getMemoryCategoryName(static_cast<VeMemoryCategory>(category))
+        << "\": {\"count\": " << stats.categoryCounts[category] << ", \"bytes\": " << stats.categoryBytes[category] << "}";
+  }
+  out << "},\n";
+  out << "  \"heaps\": [";
+  std::array<MemoryHeapBudget, VK_MAX_MEMORY_HEAPS> heaps{};
+  uint32_t heapCount = queryMemoryBudget(heaps);
+  for (uint32_t i = 0; i < heapCount; i++) {
+    out << (i > 0 ? ", " : "") << "{\"size\": " << heaps[i].size << ", \"budget\": " << heaps[i].budget
+        << ", \"usage\": " << heaps[i].usage << ", \"allocated\": " << heaps[i].allocated
+        << ", \"deviceLocal\": " << (heaps[i].deviceLocal ? "true" : "false") << "}";
   }
+  out << "]\n";
+  out << "}\n";
 }
 
-}  // namespace ve
\ No newline at end of file
+}  // namespace ve
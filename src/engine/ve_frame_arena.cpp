@@ -0,0 +1,108 @@
+#include "ve_frame_arena.hpp"
+#include "ve_allocation_counter.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+namespace ve{
+    namespace{
+        std::byte* alignPointer(std::byte* pointer, size_t alignment){
+            auto address = reinterpret_cast<uintptr_t>(pointer);
+            return pointer + (((address + alignment - 1) & ~(uintptr_t{alignment} - 1)) - address);
+        }
+    }
+
+    VeFrameArena::VeFrameArena(uint32_t frameCount, size_t capacity): segments(frameCount){
+        for(auto& segment: segments){
+            segment.memory = std::make_unique<std::byte[]>(capacity);
+            segment.capacity = capacity;
+            //the first frame may outgrow the segment already, reserve the bookkeeping up front
+            segment.spillBlocks.reserve(16);
+        }
+        current = &segments[0];
+    }
+
+    void VeFrameArena::beginFrame(int frameIndex){
+        current = &segments[static_cast<size_t>(frameIndex) % segments.size()];
+        if(current->spillBytes > 0){
+            //one block big enough for what the last frame needed, worst case alignment padding included
+            size_t capacity = current->capacity;
+            while(capacity < current->cursor + current->spillBytes){
+                capacity *= 2;
+            }
+            current->memory = std::make_unique<std::byte[]>(capacity);
+            current->capacity = capacity;
+            current->spillBlocks.clear();
+            current->spillBytes = 0;
+        }
+        current->cursor = 0;
+    }
+
+    void* VeFrameArena::allocate(size_t size, size_t alignment){
+        std::byte* begin = current->memory.get();
+        std::byte* pointer = alignPointer(begin + current->cursor, alignment);
+        if(pointer + size <= begin + current->capacity){
+            current->cursor = static_cast<size_t>(pointer + size - begin);
+            peak = std::max(peak, current->cursor + current->spillBytes);
+            return pointer;
+        }
+        size_t blockSize = size + alignment;
+        current->spillBlocks.push_back(std::make_unique<std::byte[]>(blockSize));
+        current->spillBytes += blockSize;
+        spills++;
+        peak = std::max(peak, current->cursor + current->spillBytes);
+        return alignPointer(current->spillBlocks.back().get(), alignment);
+    }
+
+    VeFrameArena::Stats VeFrameArena::getStats() const{
+        Stats stats{};
+        stats.used = current->cursor + current->spillBytes;
+        stats.capacity = current->capacity;
+        stats.peak = peak;
+        stats.spills = spills;
+        return stats;
+    }
+
+    bool VeFrameArena::selfTest(uint32_t frameCount){
+        constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+        constexpr uint32_t WARMUP_FRAMES = 8;
+        //starts far too small so the first frames spill and have to grow the segments
+        VeFrameArena arena{FRAMES_IN_FLIGHT, 1024};
+        uint64_t steadyAllocations = 0;
+        uint32_t frames = std::max(frameCount, WARMUP_FRAMES + 1);
+        for(uint32_t frame = 0; frame < frames; frame++){
+            uint64_t allocationsBefore = VeAllocationCounter::getAllocations();
+            arena.beginFrame(static_cast<int>(frame % FRAMES_IN_FLIGHT));
+            //the kind of lists a frame builds, a few small fixed ones and a draw list that grows without a reserve
+            auto descriptorSets = arena.makeVector<uint64_t>({1, 2, 3});
+            auto drawList = arena.makeVector<uint32_t>();
+            for(uint32_t draw = 0; draw < 1000 + frame % 7; draw++){
+                drawList.push_back(draw);
+            }
+            float* pushConstants = arena.allocateArray<float>(32);
+            for(uint32_t i = 0; i < 32; i++){
+                pushConstants[i] = static_cast<float>(i);
+            }
+            //data of a frame must survive until its segment comes around again
+            if(descriptorSets[2] != 3 || drawList[999] != 999 || pushConstants[31] != 31.0f){
+                std::cerr << "Frame arena self test failed: frame data was overwritten" << std::endl;
+                return false;
+            }
+            uint64_t allocations = VeAllocationCounter::getAllocations() - allocationsBefore;
+            if(frame >= WARMUP_FRAMES){
+                steadyAllocations += allocations;
+            }
+        }
+        Stats stats = arena.getStats();
+        std::cout << "Frame arena self test: " << frames << " frames, peak " << stats.peak << " bytes, segment capacity " << stats.capacity
+                  << " bytes, " << stats.spills << " spilled allocations while warming up, " << steadyAllocations
+                  << " heap allocations after " << WARMUP_FRAMES << " frames" << std::endl;
+        if(steadyAllocations > 0){
+            std::cerr << "Frame arena self test failed: steady state frames allocated from the heap" << std::endl;
+            return false;
+        }
+        std::cout << "Frame arena self test passed" << std::endl;
+        return true;
+    }
+}
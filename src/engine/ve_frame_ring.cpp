@@ -0,0 +1,53 @@
+#include "ve_frame_ring.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace ve{
+    VeFrameRing::VeFrameRing(VeDevice& device, uint32_t frameCount, VkDeviceSize maxRange, VkDeviceSize frameCapacity): veDevice{device}{
+        alignment = getAlignment(device);
+        this->frameCapacity = (frameCapacity + alignment - 1) & ~(alignment - 1);
+        buffer = std::make_unique<VeBuffer>(veDevice, this->frameCapacity * frameCount + maxRange, 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        if(buffer->map() != VK_SUCCESS){
+            throw std::runtime_error("failed to map frame ring buffer!");
+        }
+    }
+
+    VkDeviceSize VeFrameRing::getAlignment(const VeDevice& device){
+        //segments start on a flush atom as well, so flushing one frame never touches its neighbour
+        VkDeviceSize alignment = std::max(device.properties.limits.minUniformBufferOffsetAlignment, device.properties.limits.nonCoherentAtomSize);
+        return std::max<VkDeviceSize>(alignment, 1);
+    }
+
+    void VeFrameRing::beginFrame(int frameIndex){
+        frameStart = frameCapacity * static_cast<VkDeviceSize>(frameIndex);
+        cursor = frameStart;
+        flushed = frameStart;
+    }
+    VeFrameRing::Allocation VeFrameRing::allocate(VkDeviceSize size){
+        VkDeviceSize offset = (cursor + alignment - 1) & ~(alignment - 1);
+        if(offset + size > frameStart + frameCapacity){
+            if(overflows++ == 0){
+                std::cerr << "Frame ring segment of " << frameCapacity << " bytes is full, skipping what does not fit" << std::endl;
+            }
+            return {nullptr, NO_OFFSET, 0};
+        }
+        cursor = offset + size;
+        return {static_cast<char*>(buffer->getMappedMemory()) + offset, static_cast<uint32_t>(offset), size};
+    }
+    void VeFrameRing::flush(){
+        if(cursor <= flushed){
+            return;
+        }
+        //whole atoms, the end of the segment is atom aligned so rounding up never leaves it
+        VkDeviceSize size = std::min((cursor - flushed + alignment - 1) & ~(alignment - 1), frameStart + frameCapacity - flushed);
+        buffer->flush(size, flushed);
+        flushed = std::min(flushed + size, frameStart + frameCapacity);
+    }
+
+    VkDescriptorBufferInfo VeFrameRing::descriptorInfo(VkDeviceSize range) const{
+        return buffer->descriptorInfo(range, 0);
+    }
+}
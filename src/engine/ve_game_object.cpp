@@ -1,4 +1,5 @@
 #include "ve_game_object.hpp"
+#include "ve_model_loader.hpp"
 #include <iostream>
 
 namespace ve{
@@ -57,6 +58,23 @@ namespace ve{
             },
         };
     }
+    void VeGameObject::setModel(const std::shared_ptr<VeModelHandle>& handle){
+        modelHandle = handle;
+        if(!handle){
+            model = nullptr;
+            return;
+        }
+        model = handle->get();
+        modelGeneration = handle->getGeneration();
+    }
+    bool VeGameObject::updateModel(){
+        if(!modelHandle || modelHandle->getGeneration() == modelGeneration){
+            return false;
+        }
+        model = modelHandle->get();
+        modelGeneration = modelHandle->getGeneration();
+        return true;
+    }
     VeGameObject VeGameObject::createPointLight(float intensity, float radius, glm::vec3 color){
         VeGameObject pointLight = VeGameObject::createGameObject();
         pointLight.lightComponent = std::make_unique<PointLightComponent>();
@@ -65,7 +83,7 @@ namespace ve{
         pointLight.color = color;
         return pointLight;
     }
-    VeGameObject VeGameObject::createCubeMap(VeDevice& device, const std::vector<std::string>& faces, VeDescriptorPool& descriptorPool){
+    VeGameObject VeGameObject::createCubeMap(VeDevice& device, VeUploadContext& uploadContext, const std::vector<std::string>& faces, VeDescriptorPool& descriptorPool){
         static constexpr int VERTEX_COUNT = 36;
         VeGameObject cubeObj = VeGameObject::createGameObject();
         
@@ -117,12 +135,12 @@ namespace ve{
 
          
         //load vertex data with the model class
-        cubeObj.model = VeModel::createCubeMap(device, cubeMapVertices);
+        cubeObj.model = VeModel::createCubeMap(device, uploadContext, cubeMapVertices);
         //load the texture data
         auto cubeMap = CubeMap(device, true);
         bool srgb = true;
         bool flip = false;
-        if(cubeMap.init(faces, srgb, flip)){
+        if(cubeMap.init(uploadContext, faces, srgb, flip)){
             cubeObj.cubeMapComponent = std::make_unique<CubeMapComponent>();
             cubeObj.cubeMapComponent->cubeMap = std::make_unique<CubeMap>(std::move(cubeMap));
         }else{
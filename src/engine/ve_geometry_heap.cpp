@@ -0,0 +1,161 @@
+#include "ve_geometry_heap.hpp"
+
+#include <iostream>
+
+namespace ve{
+    namespace{
+        //matches the alignment of the attribute stream inside a model's own vertex buffer
+        constexpr VkDeviceSize STREAM_ALIGNMENT = 16;
+
+        VkDeviceSize getIndexSize(VkIndexType indexType){
+            return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+    }
+
+    VeGeometryHeap::VeGeometryHeap(VeDevice& device): veDevice{device}{}
+
+    VeGeometryHeap::VertexArena& VeGeometryHeap::getVertexArena(VeModel::VertexLayout layout){
+        VertexArena& arena = vertexArenas[static_cast<uint32_t>(layout)];
+        if(arena.buffer){
+            return arena;
+        }
+        //created on first use, most scenes only ever see one or two layouts
+        VkDeviceSize positionStride = VeModel::getPositionStride(layout);
+        VkDeviceSize attributeStride = VeModel::getAttributeStride(layout);
+        VkDeviceSize capacity = VERTEX_ARENA_BYTES / (positionStride + attributeStride);
+        arena.attributeOffset = (capacity * positionStride + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+        arena.buffer = std::make_unique<VeBuffer>(veDevice, arena.attributeOffset + capacity * attributeStride, 1,
+                            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        arena.allocator = std::make_unique<VeBlockAllocator>(capacity);
+        return arena;
+    }
+    void VeGeometryHeap::createIndexArena(){
+        indexBuffer = std::make_unique<VeBuffer>(veDevice, INDEX_ARENA_BYTES, 1,
+                            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        indexAllocator = std::make_unique<VeBlockAllocator>(INDEX_ARENA_BYTES);
+    }
+
+    bool VeGeometryHeap::insert(const VeModel::PackedGeometry& geometry, VeUploadContext& uploadContext, Range& range){
+        if(geometry.vertexCount == 0){
+            return false;
+        }
+        VertexArena& arena = getVertexArena(geometry.layout);
+        VkDeviceSize firstVertex = 0;
+        uint32_t vertexRegion = arena.allocator->allocate(geometry.vertexCount, 1, firstVertex);
+        if(vertexRegion == VeBlockAllocator::INVALID_REGION){
+            overflows++;
+            return false;
+        }
+        VkDeviceSize indexSize = getIndexSize(geometry.indexType);
+        VkDeviceSize indexOffset = 0;
+        uint32_t indexRegion = VeBlockAllocator::INVALID_REGION;
+        if(geometry.indexCount > 0){
+            if(!indexAllocator){
+                createIndexArena();
+            }
+            indexRegion = indexAllocator->allocate(indexSize * geometry.indexCount, indexSize, indexOffset);
+            if(indexRegion == VeBlockAllocator::INVALID_REGION){
+                arena.allocator->free(vertexRegion);
+                overflows++;
+                return false;
+            }
+        }
+        range.layout = geometry.layout;
+        range.vertexRegion = vertexRegion;
+        range.indexRegion = indexRegion;
+        range.firstVertex = static_cast<uint32_t>(firstVertex);
+        range.firstIndex = static_cast<uint32_t>(indexOffset / indexSize);
+
+        //the packed data is both streams back to back, each lands at the same vertex index of its half of the arena
+        const uint8_t* vertexData = static_cast<const uint8_t*>(geometry.vertexData);
+        VkDeviceSize positionStride = VeModel::getPositionStride(geometry.layout);
+        VkDeviceSize attributeStride = VeModel::getAttributeStride(geometry.layout);
+        uploadContext.uploadBuffer(vertexData, positionStride * geometry.vertexCount, arena.buffer->getBuffer(), firstVertex * positionStride);
+        uploadContext.uploadBuffer(vertexData + VeModel::getAttributeStreamOffset(geometry.layout, geometry.vertexCount),
+                                   attributeStride * geometry.vertexCount, arena.buffer->getBuffer(), arena.attributeOffset + firstVertex * attributeStride);
+        if(geometry.indexCount > 0){
+            uploadContext.uploadBuffer(geometry.indexData, indexSize * geometry.indexCount, indexBuffer->getBuffer(), indexOffset);
+        }
+        models++;
+        return true;
+    }
+    void VeGeometryHeap::release(const Range& range){
+        pendingReleases.push_back({range, 0});
+        models--;
+    }
+    void VeGeometryHeap::retire(std::unique_ptr<VeBuffer> buffer){
+        if(buffer){
+            retiredBuffers.push_back({std::move(buffer), 0});
+        }
+    }
+    void VeGeometryHeap::endFrame(){
+        //the frame being recorded when release was called may have drawn the range, so stamp with the value that covers it
+        VeTimeline& timeline = veDevice.getGraphicsTimeline();
+        for(auto it = pendingReleases.rbegin(); it != pendingReleases.rend() && it->value == 0; ++it){
+            it->value = timeline.getSubmittedValue();
+        }
+        while(!pendingReleases.empty() && pendingReleases.front().value != 0 && timeline.isComplete(pendingReleases.front().value)){
+            free(pendingReleases.front().range);
+            pendingReleases.pop_front();
+        }
+        for(auto it = retiredBuffers.rbegin(); it != retiredBuffers.rend() && it->value == 0; ++it){
+            it->value = timeline.getSubmittedValue();
+        }
+        while(!retiredBuffers.empty() && retiredBuffers.front().value != 0 && timeline.isComplete(retiredBuffers.front().value)){
+            retiredBuffers.pop_front();
+        }
+    }
+    void VeGeometryHeap::free(const Range& range){
+        vertexArenas[static_cast<uint32_t>(range.layout)].allocator->free(range.vertexRegion);
+        if(range.indexRegion != VeBlockAllocator::INVALID_REGION){
+            indexAllocator->free(range.indexRegion);
+        }
+    }
+
+    void VeGeometryHeap::bind(VkCommandBuffer commandBuffer, VeModel::VertexLayout layout, VkIndexType indexType){
+        const VertexArena& arena = vertexArenas[static_cast<uint32_t>(layout)];
+        VkBuffer buffers[] = {arena.buffer->getBuffer(), arena.buffer->getBuffer()};
+        VkDeviceSize offsets[] = {0, arena.attributeOffset};
+        vkCmdBindVertexBuffers(commandBuffer, VeModel::POSITION_BINDING, 2, buffers, offsets);
+        if(indexBuffer){
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+        }
+    }
+    void VeGeometryHeap::bindPositions(VkCommandBuffer commandBuffer, VeModel::VertexLayout layout, VkIndexType indexType){
+        const VertexArena& arena = vertexArenas[static_cast<uint32_t>(layout)];
+        VkBuffer buffers[] = {arena.buffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, VeModel::POSITION_BINDING, 1, buffers, offsets);
+        if(indexBuffer){
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+        }
+    }
+
+    VeGeometryHeap::Stats VeGeometryHeap::getStats() const{
+        Stats stats{};
+        stats.models = models;
+        stats.pendingReleases = static_cast<uint32_t>(pendingReleases.size() + retiredBuffers.size());
+        stats.overflows = overflows;
+        for(uint32_t layout = 0; layout < VeModel::VERTEX_LAYOUT_COUNT; layout++){
+            if(vertexArenas[layout].allocator){
+                stats.usedVertices[layout] = static_cast<uint32_t>(vertexArenas[layout].allocator->getUsed());
+                stats.vertexCapacity[layout] = static_cast<uint32_t>(vertexArenas[layout].allocator->getCapacity());
+            }
+        }
+        if(indexAllocator){
+            stats.usedIndexBytes = indexAllocator->getUsed();
+            stats.largestFreeIndexRange = indexAllocator->getLargestFreeRange();
+        }
+        return stats;
+    }
+    void VeGeometryHeap::report() const{
+        Stats stats = getStats();
+        std::cout << "Geometry heap: " << stats.models << " models, vertices";
+        for(uint32_t layout = 0; layout < VeModel::VERTEX_LAYOUT_COUNT; layout++){
+            std::cout << " " << VeModel::getVertexLayoutName(static_cast<VeModel::VertexLayout>(layout)) << " "
+                      << stats.usedVertices[layout] << "/" << stats.vertexCapacity[layout];
+        }
+        std::cout << ", " << stats.usedIndexBytes << "/" << (indexAllocator ? INDEX_ARENA_BYTES : 0) << " index bytes, "
+                  << stats.overflows << " models in their own buffers" << std::endl;
+    }
+}
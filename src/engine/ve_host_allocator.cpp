@@ -0,0 +1,215 @@
+#include "ve_host_allocator.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace ve{
+    namespace{
+        //pooled blocks are allocated with this alignment, larger requests always go to the system heap
+        constexpr size_t POOL_ALIGNMENT = 64;
+        constexpr uint32_t NOT_POOLED = UINT32_MAX;
+
+        thread_local const char* currentLabel = nullptr;
+
+        uint32_t getSizeClass(size_t size){
+            uint32_t sizeClass = 0;
+            while((size_t{64} << sizeClass) < size){
+                sizeClass++;
+            }
+            return sizeClass;
+        }
+    }
+
+    //sits right in front of every block handed to the driver
+    struct VeHostAllocator::Header{
+        void* base;
+        size_t size;
+        size_t alignment;
+        uint32_t sizeClass;
+    };
+
+    VeHostAllocator* VeHostAllocator::instance = nullptr;
+
+    VeHostAllocator::Label::Label(const char* name): previous{currentLabel}{
+        currentLabel = name;
+    }
+    VeHostAllocator::Label::~Label(){
+        currentLabel = previous;
+    }
+
+    VeHostAllocator::VeHostAllocator(bool pooled): pooled{pooled}{
+        callbacks.pUserData = this;
+        callbacks.pfnAllocation = allocationFunction;
+        callbacks.pfnReallocation = reallocationFunction;
+        callbacks.pfnFree = freeFunction;
+        callbacks.pfnInternalAllocation = internalAllocationNotification;
+        callbacks.pfnInternalFree = internalFreeNotification;
+    }
+
+    void VeHostAllocator::enable(bool pooled){
+        if(instance != nullptr){
+            return;
+        }
+        //never freed, the driver may release objects during static destruction
+        instance = new VeHostAllocator(pooled);
+    }
+    const VkAllocationCallbacks* VeHostAllocator::getCallbacks(){
+        return instance != nullptr ? &instance->callbacks : nullptr;
+    }
+
+    void VeHostAllocator::count(size_t size, VkSystemAllocationScope scope, bool pooledHit){
+        uint32_t scopeIndex = std::min<uint32_t>(static_cast<uint32_t>(scope), SCOPE_COUNT - 1);
+        for(Counters* counters: {&total, &frame}){
+            counters->allocations++;
+            counters->allocatedBytes += size;
+            counters->scopeAllocations[scopeIndex]++;
+            counters->scopeBytes[scopeIndex] += size;
+            counters->poolHits += pooledHit ? 1 : 0;
+        }
+        frameLabels[currentLabel]++;
+        liveBytes += size;
+        peakBytes = std::max(peakBytes, liveBytes);
+    }
+    void* VeHostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope){
+        if(size == 0){
+            return nullptr;
+        }
+        alignment = std::max(alignment, alignof(std::max_align_t));
+        std::lock_guard<std::mutex> lock{mutex};
+        Header* header = nullptr;
+        if(pooled && size <= MAX_POOLED_SIZE && alignment <= POOL_ALIGNMENT){
+            uint32_t sizeClass = getSizeClass(size);
+            bool hit = !freeLists[sizeClass].empty();
+            if(hit){
+                header = freeLists[sizeClass].back();
+                freeLists[sizeClass].pop_back();
+            }else{
+                void* base = ::operator new(POOL_ALIGNMENT + (size_t{64} << sizeClass), std::align_val_t{POOL_ALIGNMENT}, std::nothrow);
+                if(base == nullptr){
+                    return nullptr;
+                }
+                header = reinterpret_cast<Header*>(static_cast<char*>(base) + POOL_ALIGNMENT) - 1;
+                header->base = base;
+                header->alignment = POOL_ALIGNMENT;
+                header->sizeClass = sizeClass;
+            }
+            header->size = size;
+            count(size, scope, hit);
+            return header + 1;
+        }
+        //the header is padded up to the alignment so the returned pointer keeps it
+        size_t offset = (sizeof(Header) + alignment - 1) & ~(alignment - 1);
+        void* base = ::operator new(offset + size, std::align_val_t{alignment}, std::nothrow);
+        if(base == nullptr){
+            return nullptr;
+        }
+        header = reinterpret_cast<Header*>(static_cast<char*>(base) + offset) - 1;
+        header->base = base;
+        header->size = size;
+        header->alignment = alignment;
+        header->sizeClass = NOT_POOLED;
+        count(size, scope, false);
+        return header + 1;
+    }
+    void VeHostAllocator::free(void* memory){
+        if(memory == nullptr){
+            return;
+        }
+        Header* header = static_cast<Header*>(memory) - 1;
+        std::lock_guard<std::mutex> lock{mutex};
+        total.frees++;
+        frame.frees++;
+        liveBytes -= header->size;
+        if(header->sizeClass != NOT_POOLED){
+            freeLists[header->sizeClass].push_back(header);
+            return;
+        }
+        ::operator delete(header->base, std::align_val_t{header->alignment});
+    }
+    void* VeHostAllocator::reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope){
+        if(original == nullptr){
+            return allocate(size, alignment, scope);
+        }
+        if(size == 0){
+            free(original);
+            return nullptr;
+        }
+        void* memory = allocate(size, alignment, scope);
+        if(memory == nullptr){
+            //the original stays valid when reallocation fails
+            return nullptr;
+        }
+        std::memcpy(memory, original, std::min(size, (static_cast<Header*>(original) - 1)->size));
+        free(original);
+        std::lock_guard<std::mutex> lock{mutex};
+        total.reallocations++;
+        frame.reallocations++;
+        return memory;
+    }
+
+    void* VKAPI_PTR VeHostAllocator::allocationFunction(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope){
+        return static_cast<VeHostAllocator*>(userData)->allocate(size, alignment, scope);
+    }
+    void* VKAPI_PTR VeHostAllocator::reallocationFunction(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope){
+        return static_cast<VeHostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+    }
+    void VKAPI_PTR VeHostAllocator::freeFunction(void* userData, void* memory){
+        static_cast<VeHostAllocator*>(userData)->free(memory);
+    }
+    void VKAPI_PTR VeHostAllocator::internalAllocationNotification(void* userData, size_t, VkInternalAllocationType, VkSystemAllocationScope){
+        auto* allocator = static_cast<VeHostAllocator*>(userData);
+        std::lock_guard<std::mutex> lock{allocator->mutex};
+        allocator->total.internalAllocations++;
+        allocator->frame.internalAllocations++;
+    }
+    void VKAPI_PTR VeHostAllocator::internalFreeNotification(void*, size_t, VkInternalAllocationType, VkSystemAllocationScope){}
+
+    VeHostAllocator::Stats VeHostAllocator::getStats(){
+        Stats stats{};
+        if(instance == nullptr){
+            return stats;
+        }
+        std::lock_guard<std::mutex> lock{instance->mutex};
+        stats.total = instance->total;
+        stats.frame = instance->frame;
+        stats.liveBytes = instance->liveBytes;
+        stats.peakBytes = instance->peakBytes;
+        for(const auto& [label, allocations]: instance->frameLabels){
+            if(allocations > 0){
+                stats.frameLabels.emplace_back(label != nullptr ? label : "unlabelled", allocations);
+            }
+        }
+        std::sort(stats.frameLabels.begin(), stats.frameLabels.end(), [](const auto& a, const auto& b){ return a.second > b.second; });
+        return stats;
+    }
+    void VeHostAllocator::resetFrame(){
+        if(instance == nullptr){
+            return;
+        }
+        std::lock_guard<std::mutex> lock{instance->mutex};
+        instance->frame = Counters{};
+        //zeroed instead of cleared, the labels come back every frame and re-inserting them would allocate
+        for(auto& [label, allocations]: instance->frameLabels){
+            allocations = 0;
+        }
+    }
+    const char* VeHostAllocator::getScopeName(uint32_t scope){
+        static const char* names[SCOPE_COUNT] = {"command", "object", "cache", "device", "instance"};
+        return scope < SCOPE_COUNT ? names[scope] : "unknown";
+    }
+    void VeHostAllocator::report(){
+        if(instance == nullptr){
+            return;
+        }
+        Stats stats = getStats();
+        std::cout << "Driver host allocations: " << stats.total.allocations << " (" << stats.total.allocatedBytes << " bytes, "
+                  << stats.total.reallocations << " reallocations, " << stats.total.frees << " frees, " << stats.total.poolHits
+                  << " from the pool), " << stats.liveBytes << " bytes live, peak " << stats.peakBytes << ", by scope:";
+        for(uint32_t scope = 0; scope < SCOPE_COUNT; scope++){
+            std::cout << " " << getScopeName(scope) << " " << stats.total.scopeAllocations[scope];
+        }
+        std::cout << std::endl;
+    }
+}
@@ -1,7 +1,7 @@
 #include "ve_imgui.hpp"
 #include <iostream>
 namespace ve{
-    VkDescriptorPool VeImGui::createDescriptorPool(VkDevice device){
+    VkDescriptorPool VeImGui::createDescriptorPool(VeDevice& veDevice){
         VkDescriptorPool imGuiPool;
         VkDescriptorPoolSize pool_sizes[] = {
             {VK_DESCRIPTOR_TYPE_SAMPLER,                1000},
@@ -24,16 +24,16 @@ namespace ve{
         pool_info.poolSizeCount = (uint32_t) IM_ARRAYSIZE(pool_sizes);
         pool_info.pPoolSizes = pool_sizes;
         
-        if(vkCreateDescriptorPool(device,
-            &pool_info, nullptr, &imGuiPool) != VK_SUCCESS){
+        if(vkCreateDescriptorPool(veDevice.device(),
+            &pool_info, veDevice.allocationCallbacks(), &imGuiPool) != VK_SUCCESS){
             throw std::runtime_error("Failed to create ImGui descriptor pool");
         }
         return imGuiPool;
     }
-    VkRenderPass VeImGui::createRenderPass(VkDevice device, VkFormat imageFormat, VkFormat depthFormat){
+    VkRenderPass VeImGui::createRenderPass(VeDevice& veDevice, VkFormat imageFormat, VkFormat depthFormat){
         
         VkRenderPass renderPass = VK_NULL_HANDLE;
-        vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroyRenderPass(veDevice.device(), renderPass, veDevice.allocationCallbacks());
 
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = depthFormat;
@@ -88,7 +88,7 @@ namespace ve{
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        if (vkCreateRenderPass(veDevice.device(), &renderPassInfo, veDevice.allocationCallbacks(), &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
         return renderPass;
@@ -117,7 +117,7 @@ namespace ve{
         init_info.Queue = veDevice.graphicsQueue();
         init_info.PipelineCache = VK_NULL_HANDLE;
         init_info.DescriptorPool = imGuiPool;
-        init_info.Allocator = nullptr;
+        init_info.Allocator = veDevice.allocationCallbacks();
         init_info.MinImageCount = imageCount;
         init_info.ImageCount = imageCount;
         init_info.RenderPass = renderPass;
@@ -0,0 +1,680 @@
+#include "ve_memory_allocator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ve{
+    namespace{
+        //blocks never take more than this share of a heap, so small heaps (the 256 MiB host visible bar) still fit several
+        constexpr VkDeviceSize HEAP_BLOCK_FRACTION = 8;
+
+        uint32_t lowestBit(uint64_t value){
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+        }
+        uint32_t highestBit(uint64_t value){
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+        }
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment){
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    VeBlockAllocator::VeBlockAllocator(VkDeviceSize capacity): capacity{capacity}{
+        for(auto& heads: freeHeads){
+            std::fill(std::begin(heads), std::end(heads), INVALID_REGION);
+        }
+        uint32_t whole = newRegion(0, capacity);
+        insertFree(whole);
+    }
+
+    void VeBlockAllocator::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl){
+        fl = highestBit(size);
+        //below SL_COUNT bytes a power of two cannot be split any further
+        sl = fl < SL_BITS ? 0 : static_cast<uint32_t>((size >> (fl - SL_BITS)) & (SL_COUNT - 1));
+    }
+    uint32_t VeBlockAllocator::findFree(VkDeviceSize size) const{
+        //round up to the next class boundary, so every range in the class found is large enough without walking its list
+        uint32_t fl = highestBit(size);
+        if(fl >= SL_BITS){
+            size += (VkDeviceSize{1} << (fl - SL_BITS)) - 1;
+        }else if((size & (size - 1)) != 0){
+            size = VkDeviceSize{1} << (fl + 1);
+        }
+        uint32_t sl;
+        mapping(size, fl, sl);
+        if(fl >= FL_COUNT){
+            return INVALID_REGION;
+        }
+        uint32_t slMap = slBitmap[fl] & (~0u << sl);
+        if(slMap == 0){
+            uint64_t flMap = fl + 1 < FL_COUNT ? flBitmap & (~uint64_t{0} << (fl + 1)) : 0;
+            if(flMap == 0){
+                return INVALID_REGION;
+            }
+            fl = lowestBit(flMap);
+            slMap = slBitmap[fl];
+        }
+        sl = lowestBit(slMap);
+        return freeHeads[fl][sl];
+    }
+    void VeBlockAllocator::insertFree(uint32_t index){
+        Region& region = regions[index];
+        uint32_t fl, sl;
+        mapping(region.size, fl, sl);
+        region.free = true;
+        region.prevFree = INVALID_REGION;
+        region.nextFree = freeHeads[fl][sl];
+        if(region.nextFree != INVALID_REGION){
+            regions[region.nextFree].prevFree = index;
+        }
+        freeHeads[fl][sl] = index;
+        slBitmap[fl] |= 1u << sl;
+        flBitmap |= uint64_t{1} << fl;
+        freeRangeCount++;
+    }
+    void VeBlockAllocator::removeFree(uint32_t index){
+        Region& region = regions[index];
+        uint32_t fl, sl;
+        mapping(region.size, fl, sl);
+        if(region.prevFree != INVALID_REGION){
+            regions[region.prevFree].nextFree = region.nextFree;
+        }else{
+            freeHeads[fl][sl] = region.nextFree;
+        }
+        if(region.nextFree != INVALID_REGION){
+            regions[region.nextFree].prevFree = region.prevFree;
+        }
+        if(freeHeads[fl][sl] == INVALID_REGION){
+            slBitmap[fl] &= ~(1u << sl);
+            if(slBitmap[fl] == 0){
+                flBitmap &= ~(uint64_t{1} << fl);
+            }
+        }
+        region.free = false;
+        freeRangeCount--;
+    }
+    uint32_t VeBlockAllocator::newRegion(VkDeviceSize offset, VkDeviceSize size){
+        uint32_t index;
+        if(!unusedRegions.empty()){
+            index = unusedRegions.back();
+            unusedRegions.pop_back();
+        }else{
+            index = static_cast<uint32_t>(regions.size());
+            regions.emplace_back();
+        }
+        regions[index] = {offset, size, INVALID_REGION, INVALID_REGION, INVALID_REGION, INVALID_REGION, false};
+        return index;
+    }
+    void VeBlockAllocator::releaseRegion(uint32_t index){
+        unusedRegions.push_back(index);
+    }
+
+    uint32_t VeBlockAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset){
+        size = std::max<VkDeviceSize>(size, 1);
+        alignment = std::max<VkDeviceSize>(alignment, 1);
+        //worst case padding, the range found is aligned anywhere inside it
+        uint32_t index = findFree(size + alignment - 1);
+        if(index == INVALID_REGION){
+            return INVALID_REGION;
+        }
+        removeFree(index);
+        VkDeviceSize aligned = alignUp(regions[index].offset, alignment);
+        //free ranges are always merged, so the padding and the remainder cannot have a free physical neighbour
+        VkDeviceSize padding = aligned - regions[index].offset;
+        if(padding > 0){
+            uint32_t front = newRegion(regions[index].offset, padding);
+            Region& region = regions[index];
+            regions[front].prevPhysical = region.prevPhysical;
+            regions[front].nextPhysical = index;
+            if(region.prevPhysical != INVALID_REGION){
+                regions[region.prevPhysical].nextPhysical = front;
+            }
+            region.prevPhysical = front;
+            region.offset = aligned;
+            region.size -= padding;
+            insertFree(front);
+        }
+        VkDeviceSize remainder = regions[index].size - size;
+        if(remainder > 0){
+            uint32_t back = newRegion(aligned + size, remainder);
+            Region& region = regions[index];
+            regions[back].prevPhysical = index;
+            regions[back].nextPhysical = region.nextPhysical;
+            if(region.nextPhysical != INVALID_REGION){
+                regions[region.nextPhysical].prevPhysical = back;
+            }
+            region.nextPhysical = back;
+            region.size = size;
+            insertFree(back);
+        }
+        used += size;
+        allocationCount++;
+        offset = aligned;
+        return index;
+    }
+    void VeBlockAllocator::free(uint32_t index){
+        if(index >= regions.size() || regions[index].free){
+            throw std::invalid_argument("region is not allocated!");
+        }
+        used -= regions[index].size;
+        allocationCount--;
+        uint32_t prev = regions[index].prevPhysical;
+        if(prev != INVALID_REGION && regions[prev].free){
+            removeFree(prev);
+            regions[prev].size += regions[index].size;
+            regions[prev].nextPhysical = regions[index].nextPhysical;
+            if(regions[index].nextPhysical != INVALID_REGION){
+                regions[regions[index].nextPhysical].prevPhysical = prev;
+            }
+            releaseRegion(index);
+            index = prev;
+        }
+        uint32_t next = regions[index].nextPhysical;
+        if(next != INVALID_REGION && regions[next].free){
+            removeFree(next);
+            regions[index].size += regions[next].size;
+            regions[index].nextPhysical = regions[next].nextPhysical;
+            if(regions[next].nextPhysical != INVALID_REGION){
+                regions[regions[next].nextPhysical].prevPhysical = index;
+            }
+            releaseRegion(next);
+        }
+        insertFree(index);
+    }
+    VkDeviceSize VeBlockAllocator::getLargestFreeRange() const{
+        if(flBitmap == 0){
+            return 0;
+        }
+        //the largest range is in the highest non empty class, but a class spans a range of sizes
+        uint32_t fl = highestBit(flBitmap);
+        uint32_t sl = highestBit(slBitmap[fl]);
+        VkDeviceSize largest = 0;
+        for(uint32_t index = freeHeads[fl][sl]; index != INVALID_REGION; index = regions[index].nextFree){
+            largest = std::max(largest, regions[index].size);
+        }
+        return largest;
+    }
+
+    const char* getMemoryCategoryName(VeMemoryCategory category){
+        switch(category){
+            case VeMemoryCategory::MESH: return "mesh";
+            case VeMemoryCategory::TEXTURE: return "texture";
+            case VeMemoryCategory::SHADOW: return "shadow";
+            case VeMemoryCategory::RENDER_TARGET: return "render target";
+            case VeMemoryCategory::STAGING: return "staging";
+            case VeMemoryCategory::UNIFORM: return "uniform";
+            default: return "other";
+        }
+    }
+
+    VeMemoryAllocator::VeMemoryAllocator(const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize bufferImageGranularity,
+                                         VkDeviceSize nonCoherentAtomSize, Backend backend):
+        memoryProperties{memoryProperties}, bufferImageGranularity{std::max<VkDeviceSize>(bufferImageGranularity, 1)},
+        nonCoherentAtomSize{std::max<VkDeviceSize>(nonCoherentAtomSize, 1)}, backend{std::move(backend)}{
+        //granularity only matters between neighbouring linear and optimal resources, keeping them in separate blocks
+        //avoids padding every allocation up to it
+        separateKinds = this->bufferImageGranularity > 1;
+        for(uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++){
+            VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[type].heapIndex].size;
+            blockSizes.push_back(std::min(DEFAULT_BLOCK_SIZE, heapSize / HEAP_BLOCK_FRACTION));
+            pools.push_back({type, {}});
+            if(separateKinds){
+                pools.push_back({type, {}});
+            }
+        }
+    }
+    VeMemoryAllocator::~VeMemoryAllocator(){
+        for(auto& pool: pools){
+            for(auto& block: pool.blocks){
+                if(block.memory != VK_NULL_HANDLE){
+                    backend.free(block.memory);
+                }
+            }
+        }
+        if(dedicatedCount > 0){
+            std::cerr << "Memory allocator destroyed with " << dedicatedCount << " dedicated allocations still alive" << std::endl;
+        }
+    }
+
+    VeMemoryAllocator::Backend VeMemoryAllocator::createVulkanBackend(VkDevice device, const VkAllocationCallbacks* allocationCallbacks){
+        Backend backend{};
+        backend.allocate = [device, allocationCallbacks](uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory){
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = size;
+            allocInfo.memoryTypeIndex = memoryType;
+            return vkAllocateMemory(device, &allocInfo, allocationCallbacks, &memory);
+        };
+        backend.free = [device, allocationCallbacks](VkDeviceMemory memory){
+            vkFreeMemory(device, memory, allocationCallbacks);
+        };
+        backend.map = [device](VkDeviceMemory memory, VkDeviceSize){
+            void* mapped = nullptr;
+            if(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS){
+                throw std::runtime_error("failed to map device memory block!");
+            }
+            return mapped;
+        };
+        return backend;
+    }
+
+    uint32_t VeMemoryAllocator::getPoolIndex(uint32_t memoryType, ResourceKind kind) const{
+        if(!separateKinds){
+            return memoryType;
+        }
+        return memoryType * 2 + (kind == ResourceKind::OPTIMAL ? 1 : 0);
+    }
+    bool VeMemoryAllocator::isHostVisible(uint32_t memoryType) const{
+        return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    }
+
+    void VeMemoryAllocator::setBudget(VkDeviceSize bytes, BudgetPolicy policy){
+        std::lock_guard<std::mutex> lock{mutex};
+        budget = bytes;
+        budgetPolicy = policy;
+        overBudget = false;
+    }
+    void VeMemoryAllocator::checkBudget(uint32_t memoryType, VkDeviceSize size){
+        uint32_t heap = memoryProperties.memoryTypes[memoryType].heapIndex;
+        if(budget == 0 || !(memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)){
+            return;
+        }
+        VkDeviceSize deviceLocalBytes = 0;
+        for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++){
+            if(memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT){
+                deviceLocalBytes += heapBytes[i];
+            }
+        }
+        if(deviceLocalBytes + size <= budget){
+            overBudget = false;
+            return;
+        }
+        if(budgetPolicy == BudgetPolicy::REFUSE){
+            throw std::runtime_error("device memory budget exceeded!");
+        }
+        if(!overBudget){
+            constexpr double MIB = 1024.0 * 1024.0;
+            std::cerr << "Device memory budget exceeded: " << (deviceLocalBytes + size) / MIB << " MiB of " << budget / MIB << " MiB" << std::endl;
+            overBudget = true;
+        }
+    }
+    void VeMemoryAllocator::addDeviceMemory(uint32_t memoryType, VkDeviceSize size){
+        deviceAllocations++;
+        heapBytes[memoryProperties.memoryTypes[memoryType].heapIndex] += size;
+    }
+    void VeMemoryAllocator::removeDeviceMemory(uint32_t memoryType, VkDeviceSize size){
+        heapBytes[memoryProperties.memoryTypes[memoryType].heapIndex] -= size;
+    }
+
+    VeAllocation VeMemoryAllocator::allocate(const VkMemoryRequirements& requirements, uint32_t memoryType, ResourceKind kind, bool dedicated,
+                                             VeMemoryCategory category){
+        std::lock_guard<std::mutex> lock{mutex};
+        uint32_t categoryIndex = static_cast<uint32_t>(category);
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        VkDeviceSize size = requirements.size;
+        //flushes and invalidates work on whole atoms, so a non coherent range must not share one with its neighbour
+        VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+        if((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)){
+            alignment = std::max(alignment, nonCoherentAtomSize);
+            size = alignUp(size, nonCoherentAtomSize);
+        }
+        if(dedicated || size > blockSizes[memoryType] / 2){
+            VeAllocation allocation = allocateDedicated(size, memoryType);
+            allocation.category = category;
+            categoryBytes[categoryIndex] += size;
+            categoryCounts[categoryIndex]++;
+            return allocation;
+        }
+
+        uint32_t poolIndex = getPoolIndex(memoryType, kind);
+        Pool& pool = pools[poolIndex];
+        VeAllocation allocation{};
+        allocation.memoryType = memoryType;
+        allocation.pool = poolIndex;
+        allocation.size = size;
+        allocation.category = category;
+        for(uint32_t i = 0; i < pool.blocks.size(); i++){
+            Block& block = pool.blocks[i];
+            if(!block.allocator){
+                continue;
+            }
+            uint32_t region = block.allocator->allocate(size, alignment, allocation.offset);
+            if(region != VeBlockAllocator::INVALID_REGION){
+                allocation.memory = block.memory;
+                allocation.block = i;
+                allocation.region = region;
+                allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+                categoryBytes[categoryIndex] += size;
+                categoryCounts[categoryIndex]++;
+                return allocation;
+            }
+        }
+
+        //no room, open a block in the first released slot
+        uint32_t blockIndex = 0;
+        while(blockIndex < pool.blocks.size() && pool.blocks[blockIndex].allocator){
+            blockIndex++;
+        }
+        if(blockIndex == pool.blocks.size()){
+            pool.blocks.emplace_back();
+        }
+        Block& block = pool.blocks[blockIndex];
+        VkDeviceSize blockSize = blockSizes[memoryType];
+        checkBudget(memoryType, blockSize);
+        if(backend.allocate(memoryType, blockSize, block.memory) != VK_SUCCESS){
+            block.memory = VK_NULL_HANDLE;
+            throw std::runtime_error("failed to allocate device memory block!");
+        }
+        addDeviceMemory(memoryType, blockSize);
+        block.mapped = isHostVisible(memoryType) ? backend.map(block.memory, blockSize) : nullptr;
+        block.allocator = std::make_unique<VeBlockAllocator>(blockSize);
+        allocation.region = block.allocator->allocate(size, alignment, allocation.offset);
+        if(allocation.region == VeBlockAllocator::INVALID_REGION){
+            throw std::runtime_error("failed to sub-allocate from a new memory block!");
+        }
+        allocation.memory = block.memory;
+        allocation.block = blockIndex;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+        categoryBytes[categoryIndex] += size;
+        categoryCounts[categoryIndex]++;
+        return allocation;
+    }
+    VeAllocation VeMemoryAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryType){
+        VeAllocation allocation{};
+        allocation.memoryType = memoryType;
+        allocation.pool = VeAllocation::DEDICATED;
+        allocation.size = size;
+        checkBudget(memoryType, size);
+        if(backend.allocate(memoryType, size, allocation.memory) != VK_SUCCESS){
+            throw std::runtime_error("failed to allocate dedicated device memory!");
+        }
+        addDeviceMemory(memoryType, size);
+        dedicatedCount++;
+        dedicatedBytes += size;
+        if(isHostVisible(memoryType)){
+            allocation.mapped = backend.map(allocation.memory, size);
+        }
+        return allocation;
+    }
+    void VeMemoryAllocator::free(VeAllocation& allocation){
+        if(allocation.memory == VK_NULL_HANDLE){
+            return;
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        uint32_t categoryIndex = static_cast<uint32_t>(allocation.category);
+        categoryBytes[categoryIndex] -= allocation.size;
+        categoryCounts[categoryIndex]--;
+        if(allocation.isDedicated()){
+            backend.free(allocation.memory);
+            removeDeviceMemory(allocation.memoryType, allocation.size);
+            dedicatedCount--;
+            dedicatedBytes -= allocation.size;
+            allocation = VeAllocation{};
+            return;
+        }
+        Pool& pool = pools[allocation.pool];
+        Block& block = pool.blocks[allocation.block];
+        block.allocator->free(allocation.region);
+        allocation = VeAllocation{};
+        if(!block.allocator->isEmpty()){
+            return;
+        }
+        //keep one empty block per pool, so a model unloaded and loaded again does not reallocate
+        for(const auto& other: pool.blocks){
+            if(&other != &block && other.allocator && other.allocator->isEmpty()){
+                backend.free(block.memory);
+                removeDeviceMemory(pool.memoryType, block.allocator->getCapacity());
+                block.memory = VK_NULL_HANDLE;
+                block.mapped = nullptr;
+                block.allocator.reset();
+                return;
+            }
+        }
+    }
+
+    VeMemoryAllocator::Stats VeMemoryAllocator::getStats() const{
+        std::lock_guard<std::mutex> lock{mutex};
+        Stats stats{};
+        for(const auto& pool: pools){
+            for(const auto& block: pool.blocks){
+                if(!block.allocator){
+                    continue;
+                }
+                stats.blockCount++;
+                stats.emptyBlockCount += block.allocator->isEmpty() ? 1 : 0;
+                stats.allocationCount += block.allocator->getAllocationCount();
+                stats.freeRangeCount += block.allocator->getFreeRangeCount();
+                stats.blockBytes += block.allocator->getCapacity();
+                stats.usedBytes += block.allocator->getUsed();
+                stats.largestFreeRange = std::max(stats.largestFreeRange, block.allocator->getLargestFreeRange());
+            }
+        }
+        stats.dedicatedCount = dedicatedCount;
+        stats.dedicatedBytes = dedicatedBytes;
+        stats.deviceAllocations = deviceAllocations;
+        stats.categoryBytes = categoryBytes;
+        stats.categoryCounts = categoryCounts;
+        stats.heapBytes = heapBytes;
+        for(uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++){
+            if(memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT){
+                stats.deviceLocalBytes += heapBytes[heap];
+            }
+        }
+        VkDeviceSize freeBytes = stats.blockBytes - stats.usedBytes;
+        stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(freeBytes) : 0.0f;
+        return stats;
+    }
+    void VeMemoryAllocator::report() const{
+        Stats stats = getStats();
+        constexpr double MIB = 1024.0 * 1024.0;
+        std::cout << "Device memory: " << stats.allocationCount << " sub-allocations (" << stats.usedBytes / MIB << " MiB) in "
+                  << stats.blockCount << " blocks (" << stats.blockBytes / MIB << " MiB, " << stats.emptyBlockCount << " empty), "
+                  << stats.dedicatedCount << " dedicated (" << stats.dedicatedBytes / MIB << " MiB), "
+                  << stats.deviceAllocations << " vkAllocateMemory calls, fragmentation " << stats.fragmentation << std::endl;
+        std::cout << "Device memory by category:";
+        for(uint32_t category = 0; category < MEMORY_CATEGORY_COUNT; category++){
+            std::cout << " " << getMemoryCategoryName(static_cast<VeMemoryCategory>(category)) << " " << stats.categoryBytes[category] / MIB
+                      << " MiB (" << stats.categoryCounts[category] << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    bool VeMemoryAllocator::selfTest(uint32_t operationCount){
+        //a discrete gpu: device local vram, coherent host memory for staging and a cached non coherent type for readback
+        VkPhysicalDeviceMemoryProperties properties{};
+        properties.memoryHeapCount = 2;
+        properties.memoryHeaps[0] = {VkDeviceSize{8} * 1024 * 1024 * 1024, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+        properties.memoryHeaps[1] = {VkDeviceSize{256} * 1024 * 1024, 0};
+        properties.memoryTypeCount = 3;
+        properties.memoryTypes[0] = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0};
+        properties.memoryTypes[1] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1};
+        properties.memoryTypes[2] = {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1};
+        constexpr VkDeviceSize GRANULARITY = 1024;
+        constexpr VkDeviceSize ATOM = 64;
+
+        //fake handles, host visible memory is backed by real (untouched, so never paged in) bytes so the mapped pointers can be checked
+        struct MockMemory{
+            uint32_t memoryType;
+            VkDeviceSize size;
+            std::unique_ptr<char[]> bytes;
+        };
+        std::unordered_map<uint64_t, MockMemory> memories;
+        uint64_t nextHandle = 1;
+        Backend backend{};
+        backend.allocate = [&](uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory){
+            uint64_t handle = nextHandle++;
+            memories[handle] = {memoryType, size, nullptr};
+            memory = reinterpret_cast<VkDeviceMemory>(handle);
+            return VK_SUCCESS;
+        };
+        backend.free = [&](VkDeviceMemory memory){
+            memories.erase(reinterpret_cast<uint64_t>(memory));
+        };
+        backend.map = [&](VkDeviceMemory memory, VkDeviceSize size){
+            auto& bytes = memories.at(reinterpret_cast<uint64_t>(memory)).bytes;
+            bytes.reset(new char[size]);
+            return static_cast<void*>(bytes.get());
+        };
+
+        struct Live{
+            VeAllocation allocation;
+            ResourceKind kind;
+            VkDeviceSize alignment;
+        };
+        std::vector<Live> live;
+        std::mt19937 random{1234};
+        bool passed = true;
+        auto fail = [&](const char* message){
+            if(passed){
+                std::cerr << "Allocator self test failed: " << message << std::endl;
+            }
+            passed = false;
+        };
+        uint32_t resources = 0;
+        //only the allocator calls are timed, not the checks
+        std::chrono::duration<double> allocatorTime{0};
+        auto timed = [&](auto&& call){
+            auto start = std::chrono::high_resolution_clock::now();
+            call();
+            allocatorTime += std::chrono::high_resolution_clock::now() - start;
+        };
+        {
+            VeMemoryAllocator allocator{properties, GRANULARITY, ATOM, backend};
+            for(uint32_t op = 0; op < operationCount && passed; op++){
+                //keep around a thousand resources alive so blocks fill, fragment and empty again
+                bool allocating = live.empty() || (live.size() < 1024 && random() % 3 != 0);
+                if(!allocating){
+                    size_t index = random() % live.size();
+                    timed([&]{ allocator.free(live[index].allocation); });
+                    if(live[index].allocation.memory != VK_NULL_HANDLE){
+                        fail("free did not reset the allocation");
+                    }
+                    live[index] = live.back();
+                    live.pop_back();
+                    continue;
+                }
+                VkMemoryRequirements requirements{};
+                //mostly small uniform and vertex buffers, a few textures and the odd render target sized resource
+                uint32_t sizeClass = random() % 100;
+                requirements.size = sizeClass < 70 ? 16 + random() % 65536 : sizeClass < 98 ? 65536 + random() % (4u << 20) : (16u << 20) + random() % (32u << 20);
+                requirements.alignment = VkDeviceSize{1} << (random() % 13);
+                uint32_t memoryType = random() % 3;
+                ResourceKind kind = random() % 2 ? ResourceKind::LINEAR : ResourceKind::OPTIMAL;
+                bool dedicated = random() % 200 == 0;
+                VeMemoryCategory category = static_cast<VeMemoryCategory>(random() % MEMORY_CATEGORY_COUNT);
+                Live entry{{}, kind, requirements.alignment};
+                timed([&]{ entry.allocation = allocator.allocate(requirements, memoryType, kind, dedicated, category); });
+                resources++;
+                const VeAllocation& allocation = entry.allocation;
+                if(allocation.memoryType != memoryType || memories.at(reinterpret_cast<uint64_t>(allocation.memory)).memoryType != memoryType){
+                    fail("allocation is in the wrong memory type");
+                }
+                if(allocation.offset % requirements.alignment != 0 || allocation.size < requirements.size){
+                    fail("allocation is misaligned or too small");
+                }
+                if(allocation.offset + allocation.size > memories.at(reinterpret_cast<uint64_t>(allocation.memory)).size){
+                    fail("allocation runs past the end of its memory");
+                }
+                if(memoryType == 2 && (allocation.offset % ATOM != 0 || allocation.size % ATOM != 0)){
+                    fail("non coherent allocation does not cover whole atoms");
+                }
+                if(dedicated && !allocation.isDedicated()){
+                    fail("dedicated request was sub-allocated");
+                }
+                if(memoryType != 0){
+                    char* base = memories.at(reinterpret_cast<uint64_t>(allocation.memory)).bytes.get();
+                    if(allocation.mapped != base + allocation.offset){
+                        fail("host visible allocation is not mapped at its offset");
+                    }
+                }else if(allocation.mapped != nullptr){
+                    fail("device local allocation is mapped");
+                }
+                //overlap and kind separation against everything alive in the same memory
+                for(const auto& other: live){
+                    if(other.allocation.memory != allocation.memory){
+                        continue;
+                    }
+                    if(allocation.offset < other.allocation.offset + other.allocation.size && other.allocation.offset < allocation.offset + allocation.size){
+                        fail("allocations overlap");
+                    }
+                    if(other.kind != kind){
+                        fail("linear and optimal resources share a block");
+                    }
+                }
+                live.push_back(entry);
+            }
+            Stats stats = allocator.getStats();
+            std::cout << "Allocator self test: " << operationCount << " operations, " << resources << " resources served by "
+                      << stats.deviceAllocations << " device allocations, " << operationCount / allocatorTime.count() << " operations/s" << std::endl;
+            allocator.report();
+            //accounting has to match the allocator's own view of what is live
+            VkDeviceSize categorized = 0;
+            VkDeviceSize heapTotal = 0;
+            for(VkDeviceSize bytes: stats.categoryBytes){
+                categorized += bytes;
+            }
+            for(VkDeviceSize bytes: stats.heapBytes){
+                heapTotal += bytes;
+            }
+            if(categorized != stats.usedBytes + stats.dedicatedBytes || heapTotal != stats.blockBytes + stats.dedicatedBytes){
+                fail("category or heap accounting drifted");
+            }
+            for(auto& entry: live){
+                allocator.free(entry.allocation);
+            }
+            stats = allocator.getStats();
+            if(stats.allocationCount != 0 || stats.dedicatedCount != 0 || stats.usedBytes != 0 ||
+               stats.categoryBytes != std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT>{}){
+                fail("allocations left after freeing everything");
+            }
+            //freeing everything keeps at most one empty block per pool alive, each one a single free range again
+            if(stats.blockCount > 6 || stats.freeRangeCount != stats.blockCount){
+                fail("empty blocks were not merged or released");
+            }
+            //a budget below what is already held refuses device local memory but leaves host memory alone
+            allocator.setBudget(1, BudgetPolicy::REFUSE);
+            VkMemoryRequirements requirements{};
+            requirements.size = 4096;
+            requirements.alignment = 1;
+            bool refused = false;
+            try{
+                VeAllocation allocation = allocator.allocate(requirements, 0, ResourceKind::LINEAR, true);
+                allocator.free(allocation);
+            }catch(const std::runtime_error&){
+                refused = true;
+            }
+            VeAllocation hostAllocation = allocator.allocate(requirements, 1, ResourceKind::LINEAR, true);
+            allocator.free(hostAllocation);
+            if(!refused){
+                fail("device local allocation over budget was not refused");
+            }
+        }
+        if(!memories.empty()){
+            fail("device memory leaked after the allocator was destroyed");
+        }
+        if(passed){
+            std::cout << "Allocator self test passed" << std::endl;
+        }
+        return passed;
+    }
+}
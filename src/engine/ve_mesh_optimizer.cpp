@@ -0,0 +1,305 @@
+#include "ve_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace ve{
+    namespace{
+        constexpr uint32_t NOT_CACHED = 0xFFFFFFFFu;
+        //cache size Forsyth's scoring is tuned for, larger than the simulated one on purpose
+        constexpr size_t FORSYTH_CACHE_SIZE = 32;
+
+        //fifo post-transform cache: a vertex stays cached until cacheSize newer vertices have been inserted
+        class FifoCache{
+        public:
+            FifoCache(size_t vertexCount, uint32_t size): insertedAt(vertexCount, NOT_CACHED), cacheSize(size){}
+            //true when the vertex had to be transformed
+            bool access(uint32_t vertex){
+                if(insertedAt[vertex] != NOT_CACHED && misses - insertedAt[vertex] <= cacheSize){
+                    return false;
+                }
+                insertedAt[vertex] = misses++;
+                return true;
+            }
+            //pushing the clock past the cache size invalidates every entry without touching them
+            void flush(){
+                misses += cacheSize + 1;
+            }
+        private:
+            std::vector<uint32_t> insertedAt;
+            uint32_t misses{0};
+            uint32_t cacheSize;
+        };
+
+        float forsythVertexScore(int cachePosition, uint32_t liveTriangles){
+            if(liveTriangles == 0){
+                return -1.0f;
+            }
+            float score = 0.0f;
+            if(cachePosition >= 0){
+                //the last triangle's vertices get a fixed score so the next one does not simply reuse its edge
+                if(cachePosition < 3){
+                    score = 0.75f;
+                }else{
+                    const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+                }
+            }
+            //boost vertices with few triangles left so they get finished instead of stranded
+            score += 2.0f * std::pow(static_cast<float>(liveTriangles), -0.5f);
+            return score;
+        }
+    }
+
+    VeMeshOptimizer::VertexCacheStats VeMeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize){
+        VertexCacheStats stats{};
+        size_t triangleCount = indices.size() / 3;
+        if(triangleCount == 0 || vertexCount == 0){
+            return stats;
+        }
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<uint8_t> referenced(vertexCount, 0);
+        size_t referencedCount = 0;
+        size_t transformed = 0;
+        for(size_t i = 0; i < triangleCount * 3; i++){
+            uint32_t vertex = indices[i];
+            if(!referenced[vertex]){
+                referenced[vertex] = 1;
+                referencedCount++;
+            }
+            transformed += cache.access(vertex) ? 1 : 0;
+        }
+        stats.acmr = static_cast<float>(transformed) / static_cast<float>(triangleCount);
+        stats.atvr = static_cast<float>(transformed) / static_cast<float>(referencedCount);
+        return stats;
+    }
+
+    void VeMeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount){
+        size_t triangleCount = indices.size() / 3;
+        if(triangleCount < 2){
+            return;
+        }
+        //vertex -> triangle adjacency, the live triangles of a vertex are kept at the front of its range
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for(size_t i = 0; i < triangleCount * 3; i++){
+            liveTriangles[indices[i]]++;
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for(size_t vertex = 0; vertex < vertexCount; vertex++){
+            adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for(size_t triangle = 0; triangle < triangleCount; triangle++){
+            for(int corner = 0; corner < 3; corner++){
+                uint32_t vertex = indices[triangle * 3 + corner];
+                adjacency[fill[vertex]++] = static_cast<uint32_t>(triangle);
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for(size_t vertex = 0; vertex < vertexCount; vertex++){
+            vertexScores[vertex] = forsythVertexScore(-1, liveTriangles[vertex]);
+        }
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        size_t bestTriangle = 0;
+        for(size_t triangle = 0; triangle < triangleCount; triangle++){
+            triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+            if(triangleScores[triangle] > triangleScores[bestTriangle]){
+                bestTriangle = triangle;
+            }
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+        size_t cursor = 0;
+        const size_t NO_TRIANGLE = triangleCount;
+        for(size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++){
+            //nothing adjacent to the cache is left, restart from the next untouched triangle in input order
+            if(bestTriangle == NO_TRIANGLE){
+                while(emitted[cursor]){
+                    cursor++;
+                }
+                bestTriangle = cursor;
+            }
+            emitted[bestTriangle] = 1;
+            const uint32_t* corners = &indices[bestTriangle * 3];
+            nextCache.clear();
+            for(int corner = 0; corner < 3; corner++){
+                uint32_t vertex = corners[corner];
+                result.push_back(vertex);
+                //degenerate triangles repeat a vertex, it must still occupy a single cache slot
+                if(std::find(nextCache.begin(), nextCache.end(), vertex) == nextCache.end()){
+                    nextCache.push_back(vertex);
+                }
+                //swap the triangle out of the live part of the vertex's adjacency range
+                uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                uint32_t* end = begin + liveTriangles[vertex];
+                uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+                if(found != end){
+                    std::swap(*found, *(end - 1));
+                    liveTriangles[vertex]--;
+                }
+            }
+            for(uint32_t vertex: cache){
+                if(vertex != corners[0] && vertex != corners[1] && vertex != corners[2]){
+                    nextCache.push_back(vertex);
+                }
+            }
+            //rescore everything that moved in, within or out of the cache and the triangles touching it
+            for(size_t position = 0; position < nextCache.size(); position++){
+                uint32_t vertex = nextCache[position];
+                cachePosition[vertex] = position < FORSYTH_CACHE_SIZE ? static_cast<int>(position) : -1;
+                float score = forsythVertexScore(cachePosition[vertex], liveTriangles[vertex]);
+                float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+                for(uint32_t i = 0; i < liveTriangles[vertex]; i++){
+                    triangleScores[adjacency[adjacencyOffsets[vertex] + i]] += delta;
+                }
+            }
+            if(nextCache.size() > FORSYTH_CACHE_SIZE){
+                nextCache.resize(FORSYTH_CACHE_SIZE);
+            }
+            cache.swap(nextCache);
+            bestTriangle = NO_TRIANGLE;
+            float bestScore = -1.0f;
+            for(uint32_t vertex: cache){
+                for(uint32_t i = 0; i < liveTriangles[vertex]; i++){
+                    uint32_t triangle = adjacency[adjacencyOffsets[vertex] + i];
+                    if(triangleScores[triangle] > bestScore){
+                        bestScore = triangleScores[triangle];
+                        bestTriangle = triangle;
+                    }
+                }
+            }
+        }
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void VeMeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<VeModel::Vertex>& vertices, float threshold){
+        size_t triangleCount = indices.size() / 3;
+        if(triangleCount < 2){
+            return;
+        }
+        //hard boundaries: triangles that miss the cache on every corner already start a new strip of work
+        std::vector<size_t> hardClusters;
+        {
+            FifoCache cache(vertices.size(), SIMULATED_CACHE_SIZE);
+            for(size_t triangle = 0; triangle < triangleCount; triangle++){
+                int misses = 0;
+                for(int corner = 0; corner < 3; corner++){
+                    misses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+                }
+                if(triangle == 0 || misses == 3){
+                    hardClusters.push_back(triangle);
+                }
+            }
+            hardClusters.push_back(triangleCount);
+        }
+        //soft boundaries: split each hard cluster as soon as its running ACMR, from a cold cache,
+        //is within threshold of the whole cluster's, so reordering clusters costs at most that much
+        std::vector<size_t> clusters;
+        FifoCache cache(vertices.size(), SIMULATED_CACHE_SIZE);
+        for(size_t hard = 0; hard + 1 < hardClusters.size(); hard++){
+            size_t begin = hardClusters[hard];
+            size_t end = hardClusters[hard + 1];
+            cache.flush();
+            size_t clusterMisses = 0;
+            for(size_t i = begin * 3; i < end * 3; i++){
+                clusterMisses += cache.access(indices[i]) ? 1 : 0;
+            }
+            float target = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+            cache.flush();
+            clusters.push_back(begin);
+            size_t start = begin;
+            size_t misses = 0;
+            for(size_t triangle = begin; triangle < end; triangle++){
+                for(int corner = 0; corner < 3; corner++){
+                    misses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+                }
+                if(triangle + 1 < end && static_cast<float>(misses) <= target * static_cast<float>(triangle + 1 - start)){
+                    clusters.push_back(triangle + 1);
+                    start = triangle + 1;
+                    misses = 0;
+                    cache.flush();
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+        size_t clusterCount = clusters.size() - 1;
+
+        //clusters facing away from the mesh center are the ones most likely to occlude the rest, draw them first
+        std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{0.0f});
+        std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{0.0f});
+        std::vector<float> clusterAreas(clusterCount, 0.0f);
+        glm::vec3 meshCentroid{0.0f};
+        float meshArea = 0.0f;
+        for(size_t cluster = 0; cluster < clusterCount; cluster++){
+            for(size_t triangle = clusters[cluster]; triangle < clusters[cluster + 1]; triangle++){
+                const glm::vec3& a = vertices[indices[triangle * 3]].position;
+                const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+                const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float area = glm::length(normal);
+                glm::vec3 centroid = (a + b + c) / 3.0f;
+                clusterCentroids[cluster] += centroid * area;
+                clusterNormals[cluster] += normal;
+                clusterAreas[cluster] += area;
+                meshCentroid += centroid * area;
+                meshArea += area;
+            }
+        }
+        if(meshArea > 0.0f){
+            meshCentroid /= meshArea;
+        }
+        std::vector<float> sortKeys(clusterCount, 0.0f);
+        for(size_t cluster = 0; cluster < clusterCount; cluster++){
+            float normalLength = glm::length(clusterNormals[cluster]);
+            if(clusterAreas[cluster] > 0.0f && normalLength > 0.0f){
+                glm::vec3 centroid = clusterCentroids[cluster] / clusterAreas[cluster];
+                sortKeys[cluster] = glm::dot(centroid - meshCentroid, clusterNormals[cluster] / normalLength);
+            }
+        }
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for(size_t cluster: order){
+            result.insert(result.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+        }
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void VeMeshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices){
+        std::vector<uint32_t> remap(vertices.size(), NOT_CACHED);
+        uint32_t next = 0;
+        for(uint32_t& index: indices){
+            if(remap[index] == NOT_CACHED){
+                remap[index] = next++;
+            }
+            index = remap[index];
+        }
+        for(uint32_t& slot: remap){
+            if(slot == NOT_CACHED){
+                slot = next++;
+            }
+        }
+        std::vector<VeModel::Vertex> reordered(vertices.size());
+        for(size_t vertex = 0; vertex < vertices.size(); vertex++){
+            reordered[remap[vertex]] = vertices[vertex];
+        }
+        vertices.swap(reordered);
+    }
+}
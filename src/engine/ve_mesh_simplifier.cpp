@@ -0,0 +1,288 @@
+#include "ve_mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ve{
+    namespace{
+        //normal xyz and uv; positions live in the unit cube, so at 0.5 a reversed normal costs as much as moving a full extent
+        constexpr int ATTRIBUTE_COUNT = 5;
+        constexpr float NORMAL_WEIGHT = 0.5f;
+        constexpr float UV_WEIGHT = 0.5f;
+        //a collapse may rotate a neighbouring triangle by at most ~75 degrees
+        constexpr float MIN_NORMAL_COSINE = 0.25f;
+
+        void vertexAttributes(const VeModel::Vertex& vertex, double attributes[ATTRIBUTE_COUNT]){
+            attributes[0] = vertex.normal.x * NORMAL_WEIGHT;
+            attributes[1] = vertex.normal.y * NORMAL_WEIGHT;
+            attributes[2] = vertex.normal.z * NORMAL_WEIGHT;
+            attributes[3] = vertex.uv.x * UV_WEIGHT;
+            attributes[4] = vertex.uv.y * UV_WEIGHT;
+        }
+
+        //area weighted sum of squared distances to the incident triangles' planes plus, per attribute,
+        //the squared difference to the attribute's linear interpolation over each triangle
+        struct Quadric{
+            double a[6]{};  //symmetric 3x3: xx, xy, xz, yy, yz, zz
+            double b[3]{};
+            double c{0.0};
+            double weight{0.0};
+            double gradient[ATTRIBUTE_COUNT][3]{};
+            double offset[ATTRIBUTE_COUNT]{};
+
+            void add(const Quadric& other){
+                for(int i = 0; i < 6; i++) a[i] += other.a[i];
+                for(int i = 0; i < 3; i++) b[i] += other.b[i];
+                c += other.c;
+                weight += other.weight;
+                for(int k = 0; k < ATTRIBUTE_COUNT; k++){
+                    for(int i = 0; i < 3; i++) gradient[k][i] += other.gradient[k][i];
+                    offset[k] += other.offset[k];
+                }
+            }
+            //adds area * (dot(n, p) + d)^2
+            void addPlane(const glm::dvec3& n, double d, double area){
+                a[0] += area * n.x * n.x;
+                a[1] += area * n.x * n.y;
+                a[2] += area * n.x * n.z;
+                a[3] += area * n.y * n.y;
+                a[4] += area * n.y * n.z;
+                a[5] += area * n.z * n.z;
+                b[0] += area * d * n.x;
+                b[1] += area * d * n.y;
+                b[2] += area * d * n.z;
+                c += area * d * d;
+            }
+            //unnormalized error at position p carrying the given attribute values
+            double evaluate(const glm::dvec3& p, const double attributes[ATTRIBUTE_COUNT]) const{
+                double result = a[0] * p.x * p.x + a[3] * p.y * p.y + a[5] * p.z * p.z +
+                                2.0 * (a[1] * p.x * p.y + a[2] * p.x * p.z + a[4] * p.y * p.z) +
+                                2.0 * (b[0] * p.x + b[1] * p.y + b[2] * p.z) + c;
+                for(int k = 0; k < ATTRIBUTE_COUNT; k++){
+                    double s = attributes[k];
+                    double interpolated = gradient[k][0] * p.x + gradient[k][1] * p.y + gradient[k][2] * p.z + offset[k];
+                    result += weight * s * s - 2.0 * s * interpolated;
+                }
+                return result;
+            }
+        };
+
+        Quadric triangleQuadric(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2,
+                                const double s0[ATTRIBUTE_COUNT], const double s1[ATTRIBUTE_COUNT], const double s2[ATTRIBUTE_COUNT]){
+            Quadric quadric{};
+            glm::dvec3 e1 = p1 - p0;
+            glm::dvec3 e2 = p2 - p0;
+            glm::dvec3 normal = glm::cross(e1, e2);
+            double doubleArea = glm::length(normal);
+            if(doubleArea == 0.0){
+                return quadric;
+            }
+            normal /= doubleArea;
+            double area = doubleArea * 0.5;
+            quadric.addPlane(normal, -glm::dot(normal, p0), area);
+            quadric.weight = area;
+            //gradient g in the triangle's plane with dot(g, e1) = s1 - s0 and dot(g, e2) = s2 - s0
+            double d11 = glm::dot(e1, e1);
+            double d12 = glm::dot(e1, e2);
+            double d22 = glm::dot(e2, e2);
+            double determinant = d11 * d22 - d12 * d12;
+            if(determinant <= 0.0){
+                return quadric;
+            }
+            for(int k = 0; k < ATTRIBUTE_COUNT; k++){
+                double ds1 = s1[k] - s0[k];
+                double ds2 = s2[k] - s0[k];
+                double alpha = (d22 * ds1 - d12 * ds2) / determinant;
+                double beta = (d11 * ds2 - d12 * ds1) / determinant;
+                glm::dvec3 gradient = e1 * alpha + e2 * beta;
+                double offset = s0[k] - glm::dot(gradient, p0);
+                //(g.p + d - s)^2 expands into a plane-like term plus the cross terms kept per attribute
+                quadric.addPlane(gradient, offset, area);
+                quadric.gradient[k][0] = area * gradient.x;
+                quadric.gradient[k][1] = area * gradient.y;
+                quadric.gradient[k][2] = area * gradient.z;
+                quadric.offset[k] = area * offset;
+            }
+            return quadric;
+        }
+
+        struct Collapse{
+            uint32_t from;
+            uint32_t to;
+            double error;
+        };
+    }
+
+    std::vector<uint32_t> VeMeshSimplifier::simplify(const std::vector<uint32_t>& indices, const std::vector<VeModel::Vertex>& vertices,
+                                                     size_t targetIndexCount, float targetError, float& error){
+        error = 0.0f;
+        std::vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+        size_t vertexCount = vertices.size();
+        if(result.size() <= targetIndexCount || vertexCount == 0){
+            return result;
+        }
+        //work in the unit cube so errors are relative to the mesh size
+        glm::vec3 minimum = vertices[0].position;
+        glm::vec3 maximum = vertices[0].position;
+        for(const auto& vertex: vertices){
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+        glm::vec3 size = maximum - minimum;
+        double extent = std::max(size.x, std::max(size.y, size.z));
+        if(extent <= 0.0){
+            return result;
+        }
+        std::vector<glm::dvec3> positions(vertexCount);
+        std::vector<double> attributes(vertexCount * ATTRIBUTE_COUNT);
+        for(size_t vertex = 0; vertex < vertexCount; vertex++){
+            positions[vertex] = glm::dvec3(vertices[vertex].position - minimum) / extent;
+            vertexAttributes(vertices[vertex], &attributes[vertex * ATTRIBUTE_COUNT]);
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for(size_t i = 0; i < result.size(); i += 3){
+            uint32_t v0 = result[i], v1 = result[i + 1], v2 = result[i + 2];
+            Quadric quadric = triangleQuadric(positions[v0], positions[v1], positions[v2],
+                                              &attributes[v0 * ATTRIBUTE_COUNT], &attributes[v1 * ATTRIBUTE_COUNT], &attributes[v2 * ATTRIBUTE_COUNT]);
+            quadrics[v0].add(quadric);
+            quadrics[v1].add(quadric);
+            quadrics[v2].add(quadric);
+        }
+
+        //a directed edge without its twin lies on an open border or on a seam where the vertex was split
+        std::vector<uint8_t> locked(vertexCount, 0);
+        {
+            std::vector<uint64_t> edges;
+            edges.reserve(result.size());
+            for(size_t i = 0; i < result.size(); i += 3){
+                for(int e = 0; e < 3; e++){
+                    uint64_t from = result[i + e];
+                    uint64_t to = result[i + (e + 1) % 3];
+                    edges.push_back(from << 32 | to);
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            for(uint64_t edge: edges){
+                uint64_t twin = (edge & 0xFFFFFFFFull) << 32 | edge >> 32;
+                if(!std::binary_search(edges.begin(), edges.end(), twin)){
+                    locked[edge >> 32] = 1;
+                    locked[edge & 0xFFFFFFFFull] = 1;
+                }
+            }
+        }
+
+        auto collapseError = [&](uint32_t from, uint32_t to){
+            const double* target = &attributes[to * ATTRIBUTE_COUNT];
+            double weight = quadrics[from].weight + quadrics[to].weight;
+            double sum = quadrics[from].evaluate(positions[to], target) + quadrics[to].evaluate(positions[to], target);
+            return weight > 0.0 ? std::abs(sum) / weight : 0.0;
+        };
+
+        double errorLimit = static_cast<double>(targetError) * targetError;
+        double maxError = 0.0;
+        std::vector<uint32_t> remap(vertexCount);
+        for(size_t vertex = 0; vertex < vertexCount; vertex++){
+            remap[vertex] = static_cast<uint32_t>(vertex);
+        }
+        std::vector<uint8_t> touched(vertexCount);
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        //every pass commits the cheapest independent collapses, then rebuilds adjacency for the next
+        while(result.size() > targetIndexCount){
+            size_t triangleCount = result.size() / 3;
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for(uint32_t index: result){
+                adjacencyOffsets[index + 1]++;
+            }
+            for(size_t vertex = 0; vertex < vertexCount; vertex++){
+                adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+            }
+            adjacency.resize(result.size());
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for(size_t triangle = 0; triangle < triangleCount; triangle++){
+                for(int corner = 0; corner < 3; corner++){
+                    adjacency[fill[result[triangle * 3 + corner]]++] = static_cast<uint32_t>(triangle);
+                }
+            }
+
+            collapses.clear();
+            for(size_t i = 0; i < result.size(); i += 3){
+                for(int e = 0; e < 3; e++){
+                    uint32_t from = result[i + e];
+                    uint32_t to = result[i + (e + 1) % 3];
+                    if(!locked[from] && from != to){
+                        collapses.push_back({from, to, collapseError(from, to)});
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){
+                return a.error < b.error;
+            });
+
+            //moving from onto to must not fold any triangle that survives the collapse
+            auto keepsOrientation = [&](uint32_t from, uint32_t to){
+                for(uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++){
+                    const uint32_t* corners = &result[adjacency[i] * 3];
+                    if(corners[0] == to || corners[1] == to || corners[2] == to){
+                        continue;
+                    }
+                    glm::dvec3 before[3];
+                    glm::dvec3 after[3];
+                    for(int corner = 0; corner < 3; corner++){
+                        before[corner] = positions[corners[corner]];
+                        after[corner] = positions[corners[corner] == from ? to : corners[corner]];
+                    }
+                    glm::dvec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::dvec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    double oldLength = glm::length(oldNormal);
+                    if(oldLength > 0.0 && glm::dot(oldNormal, newNormal) <= MIN_NORMAL_COSINE * oldLength * glm::length(newNormal)){
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+            size_t removed = 0;
+            size_t committed = 0;
+            std::fill(touched.begin(), touched.end(), 0);
+            for(const auto& collapse: collapses){
+                if(collapse.error > errorLimit || removed >= trianglesToRemove){
+                    break;
+                }
+                if(touched[collapse.from] || touched[collapse.to] || !keepsOrientation(collapse.from, collapse.to)){
+                    continue;
+                }
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                maxError = std::max(maxError, collapse.error);
+                committed++;
+                //the whole one-ring is frozen so the orientation checks of this pass stay valid
+                for(uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; i++){
+                    const uint32_t* corners = &result[adjacency[i] * 3];
+                    touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = 1;
+                    if(corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to){
+                        removed++;
+                    }
+                }
+            }
+            if(committed == 0){
+                break;
+            }
+            size_t write = 0;
+            for(size_t i = 0; i < result.size(); i += 3){
+                uint32_t v0 = remap[result[i]], v1 = remap[result[i + 1]], v2 = remap[result[i + 2]];
+                if(v0 != v1 && v1 != v2 && v0 != v2){
+                    result[write++] = v0;
+                    result[write++] = v1;
+                    result[write++] = v2;
+                }
+            }
+            result.resize(write);
+        }
+        error = static_cast<float>(std::sqrt(maxError) * extent);
+        return result;
+    }
+}
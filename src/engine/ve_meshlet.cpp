@@ -0,0 +1,246 @@
+#include "ve_meshlet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace ve{
+    namespace{
+        constexpr uint32_t NO_MESHLET = 0xFFFFFFFFu;
+        //wider cones cull almost nothing and only cost the test
+        constexpr float MIN_CONE_DOT = 0.1f;
+        constexpr float NEVER_CULL = 2.0f;
+
+        //Ritter's bounding sphere, within a few percent of the minimal one
+        void computeSphere(const std::vector<uint32_t>& meshletVertices, const std::vector<glm::vec3>& positions, Meshlet& meshlet){
+            const glm::vec3& first = positions[meshletVertices[0]];
+            glm::vec3 a = first;
+            float farthest = -1.0f;
+            for(uint32_t vertex: meshletVertices){
+                float distance = glm::dot(positions[vertex] - first, positions[vertex] - first);
+                if(distance > farthest){
+                    farthest = distance;
+                    a = positions[vertex];
+                }
+            }
+            glm::vec3 b = a;
+            farthest = -1.0f;
+            for(uint32_t vertex: meshletVertices){
+                float distance = glm::dot(positions[vertex] - a, positions[vertex] - a);
+                if(distance > farthest){
+                    farthest = distance;
+                    b = positions[vertex];
+                }
+            }
+            glm::vec3 center = (a + b) * 0.5f;
+            float radius = glm::length(b - a) * 0.5f;
+            for(uint32_t vertex: meshletVertices){
+                float distance = glm::length(positions[vertex] - center);
+                if(distance > radius){
+                    float grown = (radius + distance) * 0.5f;
+                    center += (positions[vertex] - center) * ((grown - radius) / distance);
+                    radius = grown;
+                }
+            }
+            meshlet.center = center;
+            meshlet.radius = radius;
+        }
+        void computeCone(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, Meshlet& meshlet){
+            meshlet.coneAxis = glm::vec3{0.0f};
+            meshlet.coneApex = meshlet.center;
+            meshlet.coneCutoff = NEVER_CULL;
+            std::vector<glm::vec3> normals;
+            std::vector<uint32_t> corners;
+            glm::vec3 axis{0.0f};
+            for(uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3){
+                const glm::vec3& a = positions[indices[i]];
+                glm::vec3 normal = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+                float area = glm::length(normal);
+                if(area == 0.0f){
+                    continue;
+                }
+                normals.push_back(normal / area);
+                corners.push_back(indices[i]);
+                axis += normals.back();
+            }
+            float axisLength = glm::length(axis);
+            if(normals.empty() || axisLength == 0.0f){
+                return;
+            }
+            axis /= axisLength;
+            float minDot = 1.0f;
+            for(const auto& normal: normals){
+                minDot = std::min(minDot, glm::dot(axis, normal));
+            }
+            if(minDot <= MIN_CONE_DOT){
+                return;
+            }
+            //slide the apex back along the axis until it is behind every triangle's plane
+            float maxT = 0.0f;
+            for(size_t i = 0; i < normals.size(); i++){
+                float distance = glm::dot(meshlet.center - positions[corners[i]], normals[i]);
+                maxT = std::max(maxT, distance / glm::dot(axis, normals[i]));
+            }
+            meshlet.coneAxis = axis;
+            meshlet.coneApex = meshlet.center - axis * maxT;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    }
+
+    VeMeshlets::Frustum VeMeshlets::Frustum::fromMatrix(const glm::mat4& m){
+        //rows of the (column major) view projection, combined per Gribb/Hartmann
+        auto row = [&m](int r){
+            return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+        };
+        Frustum frustum{};
+        frustum.planes[0] = row(3) + row(0);
+        frustum.planes[1] = row(3) - row(0);
+        frustum.planes[2] = row(3) + row(1);
+        frustum.planes[3] = row(3) - row(1);
+        frustum.planes[4] = row(2);
+        frustum.planes[5] = row(3) - row(2);
+        for(auto& plane: frustum.planes){
+            float length = glm::length(glm::vec3(plane));
+            if(length > 0.0f){
+                plane /= length;
+            }
+        }
+        return frustum;
+    }
+    bool VeMeshlets::Frustum::intersectsSphere(const glm::vec3& center, float radius) const{
+        for(const auto& plane: planes){
+            if(glm::dot(glm::vec3(plane), center) + plane.w < -radius){
+                return false;
+            }
+        }
+        return true;
+    }
+    void VeMeshlets::CullStats::add(const CullStats& other){
+        clusters += other.clusters;
+        frustumCulled += other.frustumCulled;
+        backfaceCulled += other.backfaceCulled;
+        drawRanges += other.drawRanges;
+    }
+
+    std::vector<Meshlet> VeMeshlets::build(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions){
+        std::vector<Meshlet> meshlets;
+        size_t triangleCount = indices.size() / 3;
+        if(triangleCount == 0){
+            return meshlets;
+        }
+        //owner[v] is the meshlet that already references v, so membership checks are O(1)
+        std::vector<uint32_t> owner(positions.size(), NO_MESHLET);
+        std::vector<uint32_t> meshletVertices;
+        meshletVertices.reserve(MAX_VERTICES);
+        size_t start = 0;
+        auto finish = [&](size_t end){
+            Meshlet meshlet{};
+            meshlet.firstIndex = static_cast<uint32_t>(start * 3);
+            meshlet.indexCount = static_cast<uint32_t>((end - start) * 3);
+            meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+            computeSphere(meshletVertices, positions, meshlet);
+            computeCone(indices, positions, meshlet);
+            meshlets.push_back(meshlet);
+        };
+        for(size_t triangle = 0; triangle < triangleCount; triangle++){
+            uint32_t a = indices[triangle * 3];
+            uint32_t b = indices[triangle * 3 + 1];
+            uint32_t c = indices[triangle * 3 + 2];
+            uint32_t current = static_cast<uint32_t>(meshlets.size());
+            size_t added = (owner[a] != current) + (owner[b] != current && b != a) + (owner[c] != current && c != a && c != b);
+            if(meshletVertices.size() + added > MAX_VERTICES || triangle - start >= MAX_TRIANGLES){
+                finish(triangle);
+                start = triangle;
+                meshletVertices.clear();
+                current++;
+            }
+            for(uint32_t vertex: {a, b, c}){
+                if(owner[vertex] != current){
+                    owner[vertex] = current;
+                    meshletVertices.push_back(vertex);
+                }
+            }
+        }
+        finish(triangleCount);
+        return meshlets;
+    }
+
+    VeMeshlets::CullStats VeMeshlets::cull(const std::vector<Meshlet>& meshlets, const glm::mat4& modelMatrix, const Frustum& frustum,
+                                           const glm::vec3& cameraPosition, bool coneCulling, std::vector<DrawRange>& ranges){
+        return cull(meshlets.data(), meshlets.size(), modelMatrix, frustum, cameraPosition, coneCulling, ranges);
+    }
+    VeMeshlets::CullStats VeMeshlets::cull(const Meshlet* meshlets, size_t meshletCount, const glm::mat4& modelMatrix, const Frustum& frustum,
+                                           const glm::vec3& cameraPosition, bool coneCulling, std::vector<DrawRange>& ranges){
+        CullStats stats{};
+        stats.clusters = static_cast<uint32_t>(meshletCount);
+        glm::mat3 linear{modelMatrix};
+        float scaleX = glm::length(linear[0]);
+        float scaleY = glm::length(linear[1]);
+        float scaleZ = glm::length(linear[2]);
+        float maxScale = std::max(scaleX, std::max(scaleY, scaleZ));
+        float minScale = std::min(scaleX, std::min(scaleY, scaleZ));
+        //cones survive rotation and uniform scale only, mirroring would also flip which side is the back
+        bool coneTest = coneCulling && maxScale - minScale <= 1e-3f * maxScale && glm::dot(glm::cross(linear[0], linear[1]), linear[2]) > 0.0f;
+        size_t firstRange = ranges.size();
+        for(size_t i = 0; i < meshletCount; i++){
+            const Meshlet& meshlet = meshlets[i];
+            glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(meshlet.center, 1.0f));
+            if(!frustum.intersectsSphere(center, meshlet.radius * maxScale)){
+                stats.frustumCulled++;
+                continue;
+            }
+            if(coneTest && meshlet.coneCutoff <= 1.0f){
+                glm::vec3 apex = glm::vec3(modelMatrix * glm::vec4(meshlet.coneApex, 1.0f));
+                glm::vec3 axis = linear * meshlet.coneAxis / maxScale;
+                glm::vec3 view = apex - cameraPosition;
+                float viewLength = glm::length(view);
+                if(viewLength > 0.0f && glm::dot(view / viewLength, axis) >= meshlet.coneCutoff){
+                    stats.backfaceCulled++;
+                    continue;
+                }
+            }
+            if(ranges.size() > firstRange && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex){
+                ranges.back().indexCount += meshlet.indexCount;
+            }else{
+                ranges.push_back({meshlet.firstIndex, meshlet.indexCount});
+            }
+        }
+        stats.drawRanges = static_cast<uint32_t>(ranges.size() - firstRange);
+        return stats;
+    }
+
+    void VeMeshlets::report(const std::vector<Meshlet>& meshlets){
+        if(meshlets.empty()){
+            return;
+        }
+        glm::vec3 minimum = meshlets[0].center;
+        glm::vec3 maximum = meshlets[0].center;
+        uint32_t vertices = 0;
+        uint32_t triangles = 0;
+        uint32_t cones = 0;
+        for(const auto& meshlet: meshlets){
+            minimum = glm::min(minimum, meshlet.center - glm::vec3(meshlet.radius));
+            maximum = glm::max(maximum, meshlet.center + glm::vec3(meshlet.radius));
+            vertices += meshlet.vertexCount;
+            triangles += meshlet.indexCount / 3;
+            cones += meshlet.coneCutoff <= 1.0f ? 1 : 0;
+        }
+        std::cout << "Meshlets: " << meshlets.size() << " clusters, " << static_cast<float>(vertices) / meshlets.size() << " vertices and "
+                  << static_cast<float>(triangles) / meshlets.size() << " triangles on average, " << cones << " with a usable normal cone" << std::endl;
+        //distant cameras on each axis with an unbounded frustum, so only the normal cones can reject clusters
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        float extent = glm::length(maximum - minimum);
+        const glm::vec3 directions[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        Frustum everything{};
+        for(auto& plane: everything.planes){
+            plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+        CullStats total{};
+        for(const auto& direction: directions){
+            std::vector<DrawRange> ranges;
+            total.add(cull(meshlets, glm::mat4(1.0f), everything, center + direction * extent * 100.0f, true, ranges));
+        }
+        std::cout << "  normal cone culling from the 6 axis views: " << total.culledRatio() * 100.0f << "% of clusters rejected, "
+                  << static_cast<float>(total.drawRanges) / 6.0f << " draw ranges per view" << std::endl;
+    }
+}
@@ -1,4 +1,13 @@
 #include "ve_model.hpp"
+#include "ve_model_cache.hpp"
+#include "ve_model_loader.hpp"
+#include "ve_geometry_heap.hpp"
+#include "ve_frame_ring.hpp"
+#include "ve_mesh_optimizer.hpp"
+#include "ve_mesh_simplifier.hpp"
+#include "ve_tangent_generator.hpp"
+#include "ve_parallel.hpp"
+#include "ve_vertex_weld.hpp"
 #include "buffer.hpp"
 #include "ve_swap_chain.hpp"
 #include "utility.hpp"
@@ -9,92 +18,255 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
 #include <iostream>
 
-namespace std{
-    template<> struct hash<ve::VeModel::Vertex>{
-        size_t operator()(const ve::VeModel::Vertex& vertex) const{
-            size_t seed = 0.0f;
-            ve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-}
 namespace ve{
-    VeModel::VeModel(VeDevice& device, const VeModel::Builder &builder): veDevice(device){
-        createVertexBuffers(builder.vertices);
-        createIndexBuffers(builder.indices);
-    }
-    //buffer cleanup handled by Buffer class
-    VeModel::~VeModel(){}
-    void VeModel::createVertexBuffers(const std::vector<Vertex>& vertices){
-        vertexCount = static_cast<uint32_t>(vertices.size());
-        assert(vertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-        //create staging buffer
-        uint32_t vertexSize = sizeof(vertices[0]);
-        VeBuffer stagingBuffer{veDevice, vertexSize, vertexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *)vertices.data());
+    namespace{
+        constexpr float HALF_MAX = 65504.0f;
 
-        vertexBuffer = std::make_unique<VeBuffer>(veDevice, vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 
+        int16_t packSnorm16(float value){
+            return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+        uint8_t packUnorm8(float value){
+            return static_cast<uint8_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+        }
+        //unit vector -> octahedron -> square, decoded by octahedralDecode in the packed shaders
+        void packOctahedral(glm::vec3 direction, int16_t out[2]){
+            float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+            if(length == 0.0f){
+                out[0] = out[1] = 0;
+                return;
+            }
+            direction /= length;
+            float x = direction.x;
+            float y = direction.y;
+            if(direction.z < 0.0f){
+                x = (1.0f - std::abs(direction.y)) * (direction.x >= 0.0f ? 1.0f : -1.0f);
+                y = (1.0f - std::abs(direction.x)) * (direction.y >= 0.0f ? 1.0f : -1.0f);
+            }
+            out[0] = packSnorm16(x);
+            out[1] = packSnorm16(y);
+        }
+        template<typename PackedPositionType>
+        void packPosition(const VeModel::Vertex& vertex, PackedPositionType& packed){
+            for(int i = 0; i < 3; i++){
+                packed.position[i] = glm::packHalf1x16(vertex.position[i]);
+            }
+            packed.position[3] = glm::packHalf1x16(1.0f);
+        }
+        void packAttributes(const VeModel::Vertex& vertex, VeModel::PackedAttributes& packed){
+            for(int i = 0; i < 3; i++){
+                packed.color[i] = packUnorm8(vertex.color[i]);
+            }
+            packed.color[3] = vertex.tangent.w < 0.0f ? 0 : 255;
+            packOctahedral(vertex.normal, packed.normal);
+            packOctahedral(glm::vec3(vertex.tangent), packed.tangent);
+            packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+            packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+        }
+        //weights are renormalized and rounded so the four bytes always add up to exactly 255
+        void packSkin(const VeModel::Vertex& vertex, VeModel::PackedSkinnedPosition& packed){
+            float total = 0.0f;
+            for(int i = 0; i < 4; i++){
+                packed.jointIndices[i] = static_cast<uint8_t>(vertex.jointIndices[i]);
+                total += std::max(vertex.jointWeights[i], 0.0f);
+            }
+            if(total <= 0.0f){
+                return;
+            }
+            int sum = 0;
+            int heaviest = 0;
+            for(int i = 0; i < 4; i++){
+                packed.jointWeights[i] = packUnorm8(std::max(vertex.jointWeights[i], 0.0f) / total);
+                sum += packed.jointWeights[i];
+                if(vertex.jointWeights[i] > vertex.jointWeights[heaviest]){
+                    heaviest = i;
+                }
+            }
+            packed.jointWeights[heaviest] = static_cast<uint8_t>(std::clamp(packed.jointWeights[heaviest] + 255 - sum, 0, 255));
+        }
+        //writes one vertex of each stream and advances both cursors
+        template<typename PositionType, typename AttributeType>
+        void writeStreams(const PositionType& position, const AttributeType& attributes, uint8_t*& positionOut, uint8_t*& attributeOut){
+            std::memcpy(positionOut, &position, sizeof(PositionType));
+            std::memcpy(attributeOut, &attributes, sizeof(AttributeType));
+            positionOut += sizeof(PositionType);
+            attributeOut += sizeof(AttributeType);
+        }
+        static_assert(sizeof(VeModel::FullPosition) == 44 && sizeof(VeModel::FullAttributes) == 48, "full streams must stay 44 and 48 bytes");
+        static_assert(sizeof(VeModel::PackedSkinnedPosition) == 16, "packed skinned position must stay 16 bytes");
+        static_assert(sizeof(VeModel::PackedPosition) == 8, "packed position must stay 8 bytes");
+        static_assert(sizeof(VeModel::PackedAttributes) == 16, "packed attributes must stay 16 bytes");
+        //vertex buffer offsets of the attribute stream are kept 16 byte aligned
+        constexpr VkDeviceSize STREAM_ALIGNMENT = 16;
+        //smaller meshes are cheap enough at any distance
+        constexpr size_t LOD_MIN_TRIANGLES = 256;
+        //coarsest simplification allowed, relative to the mesh extent
+        constexpr float LOD_MAX_ERROR = 0.05f;
+    }
+
+    VeModel::VeModel(VeDevice& device, const VeModel::Builder &builder, VertexLayout layout): VeModel(device, packGeometry(builder, layout)){}
+    VeModel::VeModel(VeDevice& device, const PackedGeometry& geometry): veDevice(device){
+        VeUploadContext uploadContext{device};
+        upload(geometry, uploadContext);
+        uploadContext.flush();
+    }
+    //no gpu resources yet, VeModelLoader fills the model on a worker thread and uploads it later
+    VeModel::VeModel(VeDevice& device): veDevice(device){}
+    //vertices and indices may point straight into a mapped cache entry, they are copied into staging buffers before returning
+    void VeModel::upload(const PackedGeometry& geometry, VeUploadContext& uploadContext, VeGeometryHeap* geometryHeap){
+        vertexLayout = geometry.layout;
+        bounds = geometry.bounds;
+        meshlets.assign(geometry.meshlets, geometry.meshlets + geometry.meshletCount);
+        if(geometryHeap && geometryHeap->insert(geometry, uploadContext, heapRange)){
+            this->geometryHeap = geometryHeap;
+            vertexCount = geometry.vertexCount;
+            indexCount = geometry.indexCount;
+            indexType = geometry.indexType;
+            hasIndexBuffer = indexCount > 0;
+        }else{
+            retireHeap = geometryHeap;
+            createVertexBuffers(geometry.vertexData, geometry.layout, geometry.vertexCount, uploadContext);
+            createIndexBuffers(geometry.indexData, geometry.indexType, geometry.indexCount, uploadContext);
+        }
+        lods.assign(geometry.lods, geometry.lods + geometry.lodCount);
+        if(lods.empty() && hasIndexBuffer){
+            lods.push_back({0, indexCount, 0.0f});
+        }
+        submeshes.assign(geometry.submeshes, geometry.submeshes + geometry.submeshCount);
+        if(submeshes.empty() && hasIndexBuffer){
+            for(const auto& lod: lods){
+                submeshes.push_back({lod.firstIndex, lod.indexCount, 0, NO_MATERIAL, 0, static_cast<uint32_t>(meshlets.size())});
+            }
+        }
+        materials.assign(geometry.materials, geometry.materials + geometry.materialCount);
+        submeshCount = lods.empty() ? 0 : static_cast<uint32_t>(submeshes.size() / lods.size());
+        assert(submeshCount * lods.size() == submeshes.size() && "Every level of detail needs the same submeshes");
+        materialOrder.resize(submeshCount);
+        for(uint32_t i = 0; i < submeshCount; i++){
+            materialOrder[i] = i;
+        }
+        std::stable_sort(materialOrder.begin(), materialOrder.end(), [this](uint32_t a, uint32_t b){
+            return submeshes[a].materialId < submeshes[b].materialId;
+        });
+    }
+    //buffer cleanup handled by Buffer class, a heap range goes back once no frame in flight can read it
+    VeModel::~VeModel(){
+        if(geometryHeap){
+            geometryHeap->release(heapRange);
+        }else if(retireHeap){
+            retireHeap->retire(std::move(vertexBuffer));
+            retireHeap->retire(std::move(indexBuffer));
+        }
+    }
+    void VeModel::createVertexBuffers(const void* vertices, VertexLayout layout, uint32_t count, VeUploadContext& uploadContext){
+        vertexCount = count;
+        assert(vertexCount >= 3 && "Vertex count must be at least 3");
+        attributeStreamOffset = getAttributeStreamOffset(layout, vertexCount);
+        VkDeviceSize bufferSize = getVertexDataSize(layout, vertexCount);
+        vertexBuffer = std::make_unique<VeBuffer>(veDevice, bufferSize, 1, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 
                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        veDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+        uploadContext.uploadBuffer(vertices, bufferSize, vertexBuffer->getBuffer());
     }
-    void VeModel::createIndexBuffers(const std::vector<uint32_t>& indices){
-        indexCount = static_cast<uint32_t>(indices.size());
+    void VeModel::createIndexBuffers(const void* indices, VkIndexType type, uint32_t count, VeUploadContext& uploadContext){
+        indexCount = count;
+        indexType = type;
         hasIndexBuffer =  indexCount > 0;
         //index buffer is optional
         if(!hasIndexBuffer){
             return;
         }
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-        uint32_t indexSize = sizeof(indices[0]);
-        //create staging buffer
-        VeBuffer stagingBuffer{veDevice, indexSize, indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *)indices.data());
+        uint32_t indexSize = type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * indexCount;
         //create index buffer
         indexBuffer = std::make_unique<VeBuffer>(veDevice, indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        veDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+        uploadContext.uploadBuffer(indices, bufferSize, indexBuffer->getBuffer());
+    }
+    VkDeviceSize VeModel::getGeometryBytes() const{
+        VkDeviceSize bytes = getVertexDataSize(vertexLayout, vertexCount);
+        if(hasIndexBuffer){
+            bytes += static_cast<VkDeviceSize>(indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)) * indexCount;
+        }
+        return bytes;
     }
 
     void VeModel::bind(VkCommandBuffer commandBuffer){
+        if(geometryHeap){
+            geometryHeap->bind(commandBuffer, vertexLayout, indexType);
+            return;
+        }
+        VkBuffer buffers[] = {vertexBuffer->getBuffer(), vertexBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0, attributeStreamOffset};
+        vkCmdBindVertexBuffers(commandBuffer, POSITION_BINDING, 2, buffers, offsets);
+        if(hasIndexBuffer){
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
+        }
+    }
+    void VeModel::bindPositions(VkCommandBuffer commandBuffer){
+        if(geometryHeap){
+            geometryHeap->bindPositions(commandBuffer, vertexLayout, indexType);
+            return;
+        }
         VkBuffer buffers[] = {vertexBuffer->getBuffer()};
         VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        vkCmdBindVertexBuffers(commandBuffer, POSITION_BINDING, 1, buffers, offsets);
         if(hasIndexBuffer){
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
         }
     }
+    VeModel::BindingKey VeModel::getBindingKey() const{
+        if(geometryHeap){
+            return {geometryHeap->getArena(vertexLayout), indexType};
+        }
+        return {this, indexType};
+    }
+    //the index buffer may hold coarser levels after LOD 0, so full draws only cover LOD 0
+    //every draw is offset by the heap range, which is all zero for models with their own buffers
     void VeModel::draw(VkCommandBuffer commandBuffer){
         if(hasIndexBuffer){
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, lods[0].indexCount, 1, heapRange.firstIndex, static_cast<int32_t>(heapRange.firstVertex), 0);
         }else{
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, 1, heapRange.firstVertex, 0);
+        }
+    }
+    void VeModel::drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t count, int32_t vertexOffset){
+        assert(hasIndexBuffer && firstIndex + count <= indexCount && "Draw range must lie inside the index buffer");
+        vkCmdDrawIndexed(commandBuffer, count, 1, heapRange.firstIndex + firstIndex, static_cast<int32_t>(heapRange.firstVertex) + vertexOffset, 0);
+    }
+    void VeModel::drawLod(VkCommandBuffer commandBuffer, uint32_t lod){
+        assert(lod < lods.size() && "Level of detail out of range");
+        vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, 1, heapRange.firstIndex + lods[lod].firstIndex, static_cast<int32_t>(heapRange.firstVertex), 0);
+    }
+    void VeModel::drawSubmesh(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t submesh){
+        assert(lod < lods.size() && submesh < submeshCount && "Submesh out of range");
+        const Submesh& range = getSubmesh(lod, submesh);
+        if(range.indexCount > 0){
+            vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, heapRange.firstIndex + range.firstIndex,
+                             static_cast<int32_t>(heapRange.firstVertex) + range.vertexOffset, 0);
         }
     }
     void VeModel::drawInstanced(VkCommandBuffer commandBuffer, uint32_t instanceCount){
         if(hasIndexBuffer){
-            vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, lods[0].indexCount, instanceCount, heapRange.firstIndex, static_cast<int32_t>(heapRange.firstVertex), 0);
         }else{
-            vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, instanceCount, heapRange.firstVertex, 0);
         }
     }
-    void VeModel::updateAnimation(float deltaTime, int frameCounter, int frameIndex){
-        if(hasAnimation){
+    void VeModel::updateAnimation(float deltaTime, int frameCounter, VeFrameRing& frameRing){
+        if(hasAnimation && paletteFrame != frameCounter){
+            paletteFrame = frameCounter;
             // std::cout << "Animation updated" << std::endl;
             animationManager->update(deltaTime, *skeleton, frameCounter);
             skeleton->update();
-            //update buffer
-            shaderJointsBuffer[frameIndex]->writeToBuffer(skeleton->jointMatrices.data());
-            shaderJointsBuffer[frameIndex]->flush();
+            //only the joints the skeleton has (the shader reads at most MAX_SHADER_JOINTS), the frame ring flushes once for everything written this frame
+            size_t jointCount = std::min<size_t>(skeleton->jointMatrices.size(), MAX_SHADER_JOINTS);
+            jointPaletteOffset = frameRing.push(skeleton->jointMatrices.data(), sizeof(glm::mat4) * jointCount);
             
             // for (size_t i = 0; i < 1; ++i) {
             //     std::cout << "Matrix " << i << ":" << std::endl;
@@ -109,62 +281,356 @@ namespace ve{
         }
     }
     std::vector<VkVertexInputBindingDescription> VeModel::Vertex::getBindingDescriptions(){
+        return VeModel::getBindingDescriptions(VertexLayout::FULL);
+    }
+    std::vector<VkVertexInputAttributeDescription> VeModel::Vertex::getAttributeDescriptions(){
+        return VeModel::getAttributeDescriptions(VertexLayout::FULL);
+    }
+    uint32_t VeModel::getPositionStride(VertexLayout layout){
+        switch(layout){
+            case VertexLayout::PACKED_SKINNED: return sizeof(PackedSkinnedPosition);
+            case VertexLayout::PACKED_STATIC: return sizeof(PackedPosition);
+            default: return sizeof(FullPosition);
+        }
+    }
+    uint32_t VeModel::getAttributeStride(VertexLayout layout){
+        switch(layout){
+            case VertexLayout::PACKED_SKINNED:
+            case VertexLayout::PACKED_STATIC: return sizeof(PackedAttributes);
+            default: return sizeof(FullAttributes);
+        }
+    }
+    uint32_t VeModel::getVertexStride(VertexLayout layout){
+        return getPositionStride(layout) + getAttributeStride(layout);
+    }
+    VkDeviceSize VeModel::getAttributeStreamOffset(VertexLayout layout, uint32_t vertexCount){
+        VkDeviceSize positionBytes = static_cast<VkDeviceSize>(getPositionStride(layout)) * vertexCount;
+        return (positionBytes + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+    }
+    VkDeviceSize VeModel::getVertexDataSize(VertexLayout layout, uint32_t vertexCount){
+        return getAttributeStreamOffset(layout, vertexCount) + static_cast<VkDeviceSize>(getAttributeStride(layout)) * vertexCount;
+    }
+    const char* VeModel::getVertexLayoutName(VertexLayout layout){
+        switch(layout){
+            case VertexLayout::FULL: return "full";
+            case VertexLayout::PACKED_SKINNED: return "packed_skinned";
+            case VertexLayout::PACKED_STATIC: return "packed_static";
+            default: return "auto";
+        }
+    }
+    std::vector<VkVertexInputBindingDescription> VeModel::getBindingDescriptions(VertexLayout layout){
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions = getPositionBindingDescriptions(layout);
+        bindingDescriptions.push_back({ATTRIBUTE_BINDING, getAttributeStride(layout), VK_VERTEX_INPUT_RATE_VERTEX});
+        return bindingDescriptions;
+    }
+    //locations match across layouts, packed normals/tangents arrive as octahedral vec2 and joints as uvec4
+    std::vector<VkVertexInputAttributeDescription> VeModel::getAttributeDescriptions(VertexLayout layout){
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = getPositionAttributeDescriptions(layout);
+        if(layout == VertexLayout::PACKED_SKINNED || layout == VertexLayout::PACKED_STATIC){
+            attributeDescriptions.push_back({1, ATTRIBUTE_BINDING, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedAttributes, color)});
+            attributeDescriptions.push_back({2, ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SNORM, offsetof(PackedAttributes, normal)});
+            attributeDescriptions.push_back({3, ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedAttributes, uv)});
+            attributeDescriptions.push_back({4, ATTRIBUTE_BINDING, VK_FORMAT_R16G16_SNORM, offsetof(PackedAttributes, tangent)});
+        }else{
+            attributeDescriptions.push_back({1, ATTRIBUTE_BINDING, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FullAttributes, color)});
+            attributeDescriptions.push_back({2, ATTRIBUTE_BINDING, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FullAttributes, normal)});
+            attributeDescriptions.push_back({3, ATTRIBUTE_BINDING, VK_FORMAT_R32G32_SFLOAT, offsetof(FullAttributes, uv)});
+            attributeDescriptions.push_back({4, ATTRIBUTE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FullAttributes, tangent)});
+        }
+        return attributeDescriptions;
+    }
+    std::vector<VkVertexInputBindingDescription> VeModel::getPositionBindingDescriptions(VertexLayout layout){
         std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-        bindingDescriptions[0].binding = 0;
-        bindingDescriptions[0].stride = sizeof(Vertex);
+        bindingDescriptions[0].binding = POSITION_BINDING;
+        bindingDescriptions[0].stride = getPositionStride(layout);
         bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
         return bindingDescriptions;
     }
-    std::vector<VkVertexInputAttributeDescription> VeModel::Vertex::getAttributeDescriptions(){
+    std::vector<VkVertexInputAttributeDescription> VeModel::getPositionAttributeDescriptions(VertexLayout layout){
         std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
-        attributeDescriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
-        attributeDescriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
-        attributeDescriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)});
-        attributeDescriptions.push_back({3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv)});
-        attributeDescriptions.push_back({4, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, tangent)});
-        attributeDescriptions.push_back({5, 0, VK_FORMAT_R32G32B32A32_SINT, offsetof(Vertex, jointIndices)});
-        attributeDescriptions.push_back({6, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, jointWeights)});
+        if(layout == VertexLayout::PACKED_SKINNED){
+            attributeDescriptions.push_back({0, POSITION_BINDING, VK_FORMAT_R16G16B16A16_SFLOAT, offsetof(PackedSkinnedPosition, position)});
+            attributeDescriptions.push_back({5, POSITION_BINDING, VK_FORMAT_R8G8B8A8_UINT, offsetof(PackedSkinnedPosition, jointIndices)});
+            attributeDescriptions.push_back({6, POSITION_BINDING, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedSkinnedPosition, jointWeights)});
+        }else if(layout == VertexLayout::PACKED_STATIC){
+            attributeDescriptions.push_back({0, POSITION_BINDING, VK_FORMAT_R16G16B16A16_SFLOAT, offsetof(PackedPosition, position)});
+        }else{
+            attributeDescriptions.push_back({0, POSITION_BINDING, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FullPosition, position)});
+            attributeDescriptions.push_back({5, POSITION_BINDING, VK_FORMAT_R32G32B32A32_SINT, offsetof(FullPosition, jointIndices)});
+            attributeDescriptions.push_back({6, POSITION_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FullPosition, jointWeights)});
+        }
         return attributeDescriptions;
     }
+
+    VeModel::Bounds VeModel::Builder::computeBounds() const{
+        Bounds result{};
+        if(vertices.empty()){
+            return result;
+        }
+        result.min = result.max = vertices[0].position;
+        for(const auto& vertex: vertices){
+            for(int axis = 0; axis < 3; axis++){
+                result.min[axis] = std::min(result.min[axis], vertex.position[axis]);
+                result.max[axis] = std::max(result.max[axis], vertex.position[axis]);
+            }
+        }
+        return result;
+    }
+    VeModel::VertexLayout VeModel::chooseVertexLayout(const Builder& builder, const Bounds& bounds){
+        //half positions keep ~11 bits relative to the largest coordinate, only use them when that is
+        //a small fraction of the model itself (i.e. the mesh is not far from its own origin)
+        float extent = 0.0f;
+        float largest = 0.0f;
+        for(int axis = 0; axis < 3; axis++){
+            extent = std::max(extent, bounds.max[axis] - bounds.min[axis]);
+            largest = std::max(largest, std::max(std::abs(bounds.min[axis]), std::abs(bounds.max[axis])));
+        }
+        if(largest > HALF_MAX || largest > 2.0f * extent){
+            return VertexLayout::FULL;
+        }
+        if(!jointIndicesFitPacked(builder)){
+            return VertexLayout::FULL;
+        }
+        //a skin bound entirely to joint 0 with weight 1 still follows that joint, so the weights do not decide
+        return builder.skinned ? VertexLayout::PACKED_SKINNED : VertexLayout::PACKED_STATIC;
+    }
+    bool VeModel::jointIndicesFitPacked(const Builder& builder){
+        for(const auto& vertex: builder.vertices){
+            for(int i = 0; i < 4; i++){
+                if(vertex.jointIndices[i] < 0 || vertex.jointIndices[i] > 255){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    VkIndexType VeModel::chooseIndexType(uint32_t vertexCount){
+        //0xFFFF stays unused so primitive restart can be enabled later without repacking
+        return vertexCount < 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    }
+    VeModel::PackedGeometry VeModel::packGeometry(const Builder& builder, VertexLayout layout){
+        PackedGeometry geometry{};
+        geometry.bounds = builder.computeBounds();
+        geometry.layout = layout == VertexLayout::AUTO ? chooseVertexLayout(builder, geometry.bounds) : layout;
+        //a requested packed layout must not drop the skin or wrap joint indices, the full layout keeps both
+        if(geometry.layout == VertexLayout::PACKED_STATIC && builder.skinned){
+            geometry.layout = VertexLayout::PACKED_SKINNED;
+        }
+        if(geometry.layout != VertexLayout::FULL && !jointIndicesFitPacked(builder)){
+            geometry.layout = VertexLayout::FULL;
+        }
+        geometry.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+        geometry.indexCount = static_cast<uint32_t>(builder.indices.size());
+        geometry.indexType = chooseIndexType(geometry.vertexCount);
+        //split every vertex into its position (+skin) and attribute stream entries
+        geometry.vertexStorage.resize(getVertexDataSize(geometry.layout, geometry.vertexCount));
+        uint8_t* positionOut = geometry.vertexStorage.data();
+        uint8_t* attributeOut = geometry.vertexStorage.data() + getAttributeStreamOffset(geometry.layout, geometry.vertexCount);
+        for(const auto& vertex: builder.vertices){
+            if(geometry.layout == VertexLayout::FULL){
+                FullPosition position{vertex.position, vertex.jointIndices, vertex.jointWeights};
+                FullAttributes attributes{vertex.color, vertex.normal, vertex.uv, vertex.tangent};
+                writeStreams(position, attributes, positionOut, attributeOut);
+            }else if(geometry.layout == VertexLayout::PACKED_SKINNED){
+                PackedSkinnedPosition position{};
+                PackedAttributes attributes{};
+                packPosition(vertex, position);
+                packSkin(vertex, position);
+                packAttributes(vertex, attributes);
+                writeStreams(position, attributes, positionOut, attributeOut);
+            }else{
+                PackedPosition position{};
+                PackedAttributes attributes{};
+                packPosition(vertex, position);
+                packAttributes(vertex, attributes);
+                writeStreams(position, attributes, positionOut, attributeOut);
+            }
+        }
+        geometry.vertexData = geometry.vertexStorage.data();
+        if(geometry.indexType == VK_INDEX_TYPE_UINT16){
+            geometry.indexStorage.resize(sizeof(uint16_t) * geometry.indexCount);
+            uint16_t* out = reinterpret_cast<uint16_t*>(geometry.indexStorage.data());
+            for(uint32_t i = 0; i < geometry.indexCount; i++){
+                out[i] = static_cast<uint16_t>(builder.indices[i]);
+            }
+            geometry.indexData = geometry.indexStorage.data();
+        }else{
+            geometry.indexData = builder.indices.data();
+        }
+        geometry.meshlets = builder.meshlets.data();
+        geometry.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+        geometry.lods = builder.lods.data();
+        geometry.lodCount = static_cast<uint32_t>(builder.lods.size());
+        geometry.submeshes = builder.submeshes.data();
+        geometry.submeshCount = static_cast<uint32_t>(builder.submeshes.size());
+        geometry.materials = builder.materials.data();
+        geometry.materialCount = static_cast<uint32_t>(builder.materials.size());
+        return geometry;
+    }
     
-    std::unique_ptr<VeModel> VeModel::createModelFromFile(VeDevice& device, const std::string& filePath){
+    //same stages VeModelLoader runs on its workers, only back to back on the calling thread
+    std::unique_ptr<VeModel> VeModel::createModelFromFile(VeDevice& device, const std::string& filePath, VertexLayout layout){
+        auto import = VeModelLoader::importModel(device, filePath, layout);
+        VeUploadContext uploadContext{device};
+        auto model = VeModelLoader::finishImport(*import, uploadContext);
+        uploadContext.flush();
+        return model;
+    }
+    std::unique_ptr<VeModel> VeModel::createCubeMap(VeDevice& device, VeUploadContext& uploadContext, glm::vec3 cubeVetices[CUBE_MAP_VERTEX_COUNT]){
         Builder builder{};
+        builder.loadCubeMap(cubeVetices);
+        //VeModel's constructor that records into a caller's context is private
+        auto model = std::unique_ptr<VeModel>(new VeModel(device));
+        model->upload(packGeometry(builder, VertexLayout::FULL), uploadContext);
+        return model;
+    }
+    void VeModel::Builder::loadFromFile(const std::string& filePath){
         std::string extension = filePath.substr(filePath.find_last_of(".") + 1);
         if (extension == "gltf" || extension == "glb") {
-            builder.loadModelGLTF(filePath);
+            loadModelGLTF(filePath);
         } else {
             // Default to OBJ for other formats
-            builder.loadModel(filePath);
+            loadModel(filePath);
         }
-        
-        auto model = std::make_unique<VeModel>(device, builder);
-        if(extension == "gltf" || extension == "glb"){
-            model->loadSkeleton(builder.model);
-            model->loadAnimations(builder.model);
+        if(submeshes.empty() && !indices.empty()){
+            submeshes.push_back({0, static_cast<uint32_t>(indices.size()), 0, NO_MATERIAL, 0, 0});
         }
-        return model;
     }
-    std::unique_ptr<VeModel> VeModel::createCubeMap(VeDevice& device, glm::vec3 cubeVetices[CUBE_MAP_VERTEX_COUNT]){
-        Builder builder{};
-        builder.loadCubeMap(cubeVetices);
-        return std::make_unique<VeModel>(device, builder);
+    void VeModel::Builder::optimize(){
+        if(indices.size() < 6){
+            return;
+        }
+        auto before = VeMeshOptimizer::analyzeVertexCache(indices, vertices.size());
+        //triangles are only reordered within their submesh, the vertex fetch pass just renames vertices
+        for(const auto& submesh: submeshes){
+            std::vector<uint32_t> range(indices.begin() + submesh.firstIndex, indices.begin() + submesh.firstIndex + submesh.indexCount);
+            VeMeshOptimizer::optimizeVertexCache(range, vertices.size());
+            VeMeshOptimizer::optimizeOverdraw(range, vertices);
+            std::copy(range.begin(), range.end(), indices.begin() + submesh.firstIndex);
+        }
+        VeMeshOptimizer::optimizeVertexFetch(indices, vertices);
+        auto after = VeMeshOptimizer::analyzeVertexCache(indices, vertices.size());
+        optimizeStats = {static_cast<uint32_t>(indices.size() / 3), before.acmr, after.acmr, before.atvr, after.atvr};
+    }
+    void VeModel::Builder::reportOptimize() const{
+        if(optimizeStats.triangles == 0){
+            return;
+        }
+        std::cout << "Optimized " << optimizeStats.triangles << " triangles (fifo " << VeMeshOptimizer::SIMULATED_CACHE_SIZE << "): ACMR "
+                  << optimizeStats.acmrBefore << " -> " << optimizeStats.acmrAfter << ", ATVR " << optimizeStats.atvrBefore << " -> "
+                  << optimizeStats.atvrAfter << std::endl;
+    }
+    void VeModel::Builder::generateTangents(){
+        VeTangentGenerator::generate(indices, vertices);
+    }
+    void VeModel::Builder::buildMeshlets(){
+        std::vector<glm::vec3> positions(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++){
+            positions[i] = vertices[i].position;
+        }
+        meshlets.clear();
+        for(auto& submesh: submeshes){
+            std::vector<uint32_t> range(indices.begin() + submesh.firstIndex, indices.begin() + submesh.firstIndex + submesh.indexCount);
+            std::vector<Meshlet> clusters = VeMeshlets::build(range, positions);
+            submesh.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+            submesh.meshletCount = static_cast<uint32_t>(clusters.size());
+            for(auto& cluster: clusters){
+                cluster.firstIndex += submesh.firstIndex;
+                meshlets.push_back(cluster);
+            }
+        }
+    }
+    void VeModel::Builder::buildLods(){
+        lods.clear();
+        if(indices.empty()){
+            return;
+        }
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+        if(indices.size() < LOD_MIN_TRIANGLES * 3){
+            return;
+        }
+        //every level is simplified from the full mesh so errors do not compound
+        //submeshes are simplified one by one, their shared edges are open borders to each of them and stay put
+        const std::vector<uint32_t> baseIndices(indices);
+        const std::vector<Submesh> baseSubmeshes(submeshes);
+        size_t previousCount = baseIndices.size();
+        for(uint32_t lod = 1; lod < MAX_LODS; lod++){
+            std::vector<uint32_t> lodIndices;
+            std::vector<Submesh> lodSubmeshes;
+            float error = 0.0f;
+            for(const auto& submesh: baseSubmeshes){
+                std::vector<uint32_t> range(baseIndices.begin() + submesh.firstIndex, baseIndices.begin() + submesh.firstIndex + submesh.indexCount);
+                size_t targetCount = (range.size() / 3 >> lod) * 3;
+                float submeshError = 0.0f;
+                std::vector<uint32_t> simplified = VeMeshSimplifier::simplify(range, vertices, targetCount, LOD_MAX_ERROR, submeshError);
+                VeMeshOptimizer::optimizeVertexCache(simplified, vertices.size());
+                lodSubmeshes.push_back({static_cast<uint32_t>(indices.size() + lodIndices.size()), static_cast<uint32_t>(simplified.size()),
+                                        submesh.vertexOffset, submesh.materialId, 0, 0});
+                lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+                error = std::max(error, submeshError);
+            }
+            //stop once borders, seams or the error limit keep a level from shrinking meaningfully
+            if(lodIndices.empty() || lodIndices.size() * 10 > previousCount * 9){
+                break;
+            }
+            lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), error});
+            indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+            submeshes.insert(submeshes.end(), lodSubmeshes.begin(), lodSubmeshes.end());
+            previousCount = lodIndices.size();
+        }
+    }
+    void VeModel::reportLods(const Lod* lods, uint32_t lodCount){
+        if(lodCount == 0){
+            return;
+        }
+        std::cout << "LOD chain: " << lods[0].indexCount / 3;
+        for(uint32_t lod = 1; lod < lodCount; lod++){
+            std::cout << " -> " << lods[lod].indexCount / 3 << " (error " << lods[lod].error << ")";
+        }
+        std::cout << " triangles" << std::endl;
     }
     void VeModel::Builder::loadModel(const std::string& filePath){
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
+        //obj materials are not imported, the model is drawn whole without submeshes or materials
+        std::vector<tinyobj::material_t> objMaterials;
         std::string warn;
         std::string err;
 
         std::string fullPath = std::string(ENGINE_DIR) + filePath;
-        if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, fullPath.c_str())){
+        if(!tinyobj::LoadObj(&attrib, &shapes, &objMaterials, &warn, &err, fullPath.c_str())){
             throw std::runtime_error(warn + err);
         }
         vertices.clear();
         indices.clear();
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        submeshes.clear();
+        this->materials.clear();
+        skinned = false;
+        //flatten all shapes into one index stream so it can be split evenly across threads
+        std::vector<tinyobj::index_t> objIndices;
+        size_t totalIndices = 0;
+        for(const auto& shape: shapes){
+            totalIndices += shape.mesh.indices.size();
+        }
+        objIndices.reserve(totalIndices);
         for(const auto& shape: shapes){
-            for(const auto& index: shape.mesh.indices){
+            objIndices.insert(objIndices.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+        }
+        const bool hasColors = attrib.colors.size() >= attrib.vertices.size();
+
+        //each range welds its own vertices, keeping them in first-occurrence order
+        struct WeldedRange{
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> localIndices;
+        };
+        std::vector<ParallelRange> ranges = splitRanges(objIndices.size(), 3);
+        std::vector<WeldedRange> welded(ranges.size());
+        parallelFor(ranges, [&](size_t rangeIndex, const ParallelRange& range){
+            WeldedRange& result = welded[rangeIndex];
+            VertexWeldTable localVertices(result.vertices, range.end - range.begin);
+            result.localIndices.reserve(range.end - range.begin);
+            for(size_t i = range.begin; i < range.end; i++){
+                const tinyobj::index_t& index = objIndices[i];
                 Vertex vertex{};
                 if(index.vertex_index >= 0){
                     vertex.position = {
@@ -172,12 +638,14 @@ namespace ve{
                         attrib.vertices[3 * index.vertex_index + 1],
                         attrib.vertices[3 * index.vertex_index + 2]
                     };
+                    if(hasColors){
+                        vertex.color = {
+                            attrib.colors[3 * index.vertex_index + 0],
+                            attrib.colors[3 * index.vertex_index + 1],
+                            attrib.colors[3 * index.vertex_index + 2]
+                        };
+                    }
                 }
-                vertex.color = {
-                    attrib.colors[3 * index.vertex_index + 0],
-                    attrib.colors[3 * index.vertex_index + 1],
-                    attrib.colors[3 * index.vertex_index + 2]
-                };
                 if(index.normal_index >= 0){
                     vertex.normal = {
                         attrib.normals[3 * index.normal_index + 0],
@@ -193,35 +661,36 @@ namespace ve{
                 }
                 vertex.jointIndices = glm::ivec4(0);
                 vertex.jointWeights = glm::vec4(1.0f,0.0f,0.0f,0.0f);
-    
-                //if vertex is unique, add to list
-                if(uniqueVertices.count(vertex) == 0){
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-                indices.push_back(uniqueVertices[vertex]);
-            }
-            //compute tangents for each triangle (access 3 vertices at each loop step)
-            for (long index = 0;index < indices.size(); index+=3){
-                //edges: edge1 = vertex2 - vertex1, edge2 = vertex3 - vertex1
-                glm::vec3 edge1 = vertices[indices[index + 1]].position - vertices[indices[index]].position;
-                glm::vec3 edge2 = vertices[indices[index + 2]].position - vertices[indices[index]].position;
-                //delta uv: deltaUV1 = uv2 - uv1, deltaUV2 = uv3 - uv1
-                glm::vec2 deltaUV1 = vertices[indices[index + 1]].uv - vertices[indices[index]].uv;
-                glm::vec2 deltaUV2 = vertices[indices[index + 2]].uv - vertices[indices[index]].uv;
-                //compute tangent
-                float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-                glm::vec3 tangent;
-                tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-                tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-                tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-                //store tangent for each triangle
-                vertices[indices[index]].tangent = tangent;
-                vertices[indices[index + 1]].tangent = tangent;
-                vertices[indices[index + 2]].tangent = tangent;
 
+                result.localIndices.push_back(localVertices.weld(vertex));
+            }
+        });
+
+        //merge ranges in order: a vertex first seen in an earlier range keeps its slot,
+        //so the result matches the single threaded first-occurrence order exactly
+        std::vector<std::vector<uint32_t>> remaps(welded.size());
+        size_t localVertexTotal = 0;
+        for(const auto& result: welded){
+            localVertexTotal += result.vertices.size();
+        }
+        VertexWeldTable uniqueVertices(vertices, localVertexTotal);
+        for(size_t rangeIndex = 0; rangeIndex < welded.size(); rangeIndex++){
+            auto& remap = remaps[rangeIndex];
+            remap.reserve(welded[rangeIndex].vertices.size());
+            for(const auto& vertex: welded[rangeIndex].vertices){
+                remap.push_back(uniqueVertices.weld(vertex));
             }
         }
+        indices.resize(objIndices.size());
+        parallelFor(ranges, [&](size_t rangeIndex, const ParallelRange& range){
+            const auto& localIndices = welded[rangeIndex].localIndices;
+            const auto& remap = remaps[rangeIndex];
+            for(size_t i = 0; i < localIndices.size(); i++){
+                indices[range.begin + i] = remap[localIndices[i]];
+            }
+        });
+
+        generateTangents();
     }
     void VeModel::Builder::loadModelGLTF(const std::string& filePath){
         tinygltf::TinyGLTF loader;
@@ -229,7 +698,6 @@ namespace ve{
         std::string warn;
         std::string fullPath = std::string(ENGINE_DIR) + filePath;
         bool ret = false;
-        std::cout << "Loading model: " << fullPath << std::endl;
         
         // Check if file is binary (.glb) or text (.gltf) format
         if (filePath.find(".glb") != std::string::npos) {
@@ -274,7 +742,33 @@ namespace ve{
 
         vertices.clear();
         indices.clear();
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        submeshes.clear();
+        materials.clear();
+        skinned = !model.skins.empty();
+        for (const auto& mesh : model.meshes) {
+            for (const auto& primitive : mesh.primitives) {
+                skinned = skinned || primitive.attributes.count("JOINTS_0") > 0;
+            }
+        }
+        for (const auto& material : model.materials) {
+            Material entry{};
+            const auto& factor = material.pbrMetallicRoughness.baseColorFactor;
+            if (factor.size() == 4) {
+                entry.baseColorFactor = glm::vec4(factor[0], factor[1], factor[2], factor[3]);
+            }
+            materials.push_back(entry);
+        }
+        //size the weld table for the worst case of no shared corners
+        size_t expectedVertices = 0;
+        for (const auto& mesh : model.meshes) {
+            for (const auto& primitive : mesh.primitives) {
+                if (primitive.indices >= 0) {
+                    expectedVertices += model.accessors[primitive.indices].count;
+                }
+            }
+        }
+        VertexWeldTable uniqueVertices(vertices, expectedVertices);
+        indices.reserve(expectedVertices);
         for (const auto& mesh : model.meshes) {
             for (const auto& primitive : mesh.primitives) {
                 // Get accessor indices for the attributes we need
@@ -437,14 +931,6 @@ namespace ve{
                                 static_cast<int>(jointsData[i * 4 + 2]),
                                 static_cast<int>(jointsData[i * 4 + 3])
                             };
-                            // Add debugging print for joint indices
-                            if (i % 100 == 0) { // Print every 100th vertex to avoid flooding console
-                                std::cout << "Vertex " << i << " Joint Indices: " 
-                                        << tempVertices[i].jointIndices.x << " "
-                                        << tempVertices[i].jointIndices.y << " "
-                                        << tempVertices[i].jointIndices.z << " "
-                                        << tempVertices[i].jointIndices.w << std::endl;
-                            }
                         }
                     } else if (jointsAccessor->componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
                         const uint16_t* jointsData = reinterpret_cast<const uint16_t*>(
@@ -456,14 +942,6 @@ namespace ve{
                                 static_cast<int>(jointsData[i * 4 + 2]),
                                 static_cast<int>(jointsData[i * 4 + 3])
                             };
-                            // Add debugging print for joint indices
-                            if (i % 100 == 0) { // Print every 100th vertex to avoid flooding console
-                                std::cout << "Vertex " << i << " Joint Indices: " 
-                                        << tempVertices[i].jointIndices.x << " "
-                                        << tempVertices[i].jointIndices.y << " "
-                                        << tempVertices[i].jointIndices.z << " "
-                                        << tempVertices[i].jointIndices.w << std::endl;
-                            }
                         }
                     }
                 }
@@ -492,9 +970,6 @@ namespace ve{
                             // If no weights, assign fully to the first joint
                             tempVertices[i].jointWeights = { 1.0f, 0.0f, 0.0f, 0.0f };
                         }
-                        if(i % 100 == 0) { // Print every 100th vertex to avoid flooding console
-                            std::cout << "Joint Weights: " << tempVertices[i].jointWeights.x << " " << tempVertices[i].jointWeights.y << " " << tempVertices[i].jointWeights.z << " " << tempVertices[i].jointWeights.w << std::endl;
-                        }
                     }
                 }
                 // Load indices
@@ -519,47 +994,28 @@ namespace ve{
                     }
                 }
                 
-                // Add vertices and indices to the model
+                // Add vertices and indices to the model, one submesh per primitive
+                Submesh submesh{static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(tempIndices.size()), 0, NO_MATERIAL, 0, 0};
+                if (primitive.material >= 0 && primitive.material < static_cast<int>(materials.size())) {
+                    submesh.materialId = primitive.material;
+                }
                 for (size_t i = 0; i < tempIndices.size(); i++) {
-                    Vertex vertex = tempVertices[tempIndices[i]];
-                    
-                    if (uniqueVertices.count(vertex) == 0) {
-                        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                        vertices.push_back(vertex);
-                    }
-                    indices.push_back(uniqueVertices[vertex]);
+                    indices.push_back(uniqueVertices.weld(tempVertices[tempIndices[i]]));
+                }
+                if (submesh.indexCount > 0) {
+                    submeshes.push_back(submesh);
                 }
             }
         }
         
-        // Compute tangents for normal mapping
-        for (size_t i = 0; i < indices.size(); i += 3) {
-            if (i + 2 >= indices.size()) break;
-            
-            glm::vec3 edge1 = vertices[indices[i + 1]].position - vertices[indices[i]].position;
-            glm::vec3 edge2 = vertices[indices[i + 2]].position - vertices[indices[i]].position;
-            
-            glm::vec2 deltaUV1 = vertices[indices[i + 1]].uv - vertices[indices[i]].uv;
-            glm::vec2 deltaUV2 = vertices[indices[i + 2]].uv - vertices[indices[i]].uv;
-            
-            float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-            if (std::isfinite(f)) {
-                glm::vec3 tangent;
-                tangent.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-                tangent.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-                tangent.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-                
-                vertices[indices[i]].tangent = tangent;
-                vertices[indices[i + 1]].tangent = tangent;
-                vertices[indices[i + 2]].tangent = tangent;
-            }
-        }
+        generateTangents();
     }
 
     void VeModel::Builder::loadCubeMap(glm::vec3 cubeVertices[CUBE_MAP_VERTEX_COUNT]){
         vertices.clear();
         indices.clear();
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        skinned = false;
+        VertexWeldTable uniqueVertices(vertices, CUBE_MAP_VERTEX_COUNT);
         for (size_t i = 0; i < CUBE_MAP_VERTEX_COUNT; i++) {
             Vertex vertex{};
             vertex.position = cubeVertices[i];
@@ -568,12 +1024,7 @@ namespace ve{
             vertex.uv = { 0.0f, 0.0f };
             vertex.jointIndices = glm::ivec4(0);
             vertex.jointWeights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
-            
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            indices.push_back(uniqueVertices[vertex]);
+            indices.push_back(uniqueVertices.weld(vertex));
         }
     }
     void VeModel::loadSkeleton(const tinygltf::Model& model){
@@ -595,15 +1046,7 @@ namespace ve{
             const tinygltf::Accessor& invAccessor = model.accessors[skin.inverseBindMatrices];
             const tinygltf::BufferView& invBufferView = model.bufferViews[invAccessor.bufferView];
             const tinygltf::Buffer& invBuffer = model.buffers[invBufferView.buffer];
-            
-            // Debug info about inverse bind matrices accessor
-            std::cout << "Inverse bind matrices accessor info:" << std::endl;
-            std::cout << "  Component type: " << invAccessor.componentType << 
-                        " (Should be " << TINYGLTF_COMPONENT_TYPE_FLOAT << " for float)" << std::endl;
-            std::cout << "  Type: " << invAccessor.type << 
-                        " (Should be " << TINYGLTF_TYPE_MAT4 << " for mat4)" << std::endl;
-            std::cout << "  Count: " << invAccessor.count << std::endl;
-            std::cout << "  Byte offset: " << invAccessor.byteOffset << std::endl;
+
 
             // Validate component type
             if (invAccessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
@@ -614,13 +1057,6 @@ namespace ve{
             const float* inverseBindMatricesData = reinterpret_cast<const float*>(
                 &invBuffer.data[invBufferView.byteOffset + invAccessor.byteOffset]);
             
-                // Debug: Print buffer info
-            std::cout << "Inverse bind matrices buffer info:" << std::endl;
-            std::cout << "  Buffer size: " << invBuffer.data.size() << " bytes" << std::endl;
-            std::cout << "  BufferView byteOffset: " << invBufferView.byteOffset << std::endl;
-            std::cout << "  BufferView byteLength: " << invBufferView.byteLength << std::endl;
-            std::cout << "  Total offset: " << (invBufferView.byteOffset + invAccessor.byteOffset) << std::endl;
-            
             // Process each joint
             for (size_t i = 0; i < numJoints; i++) {
                 int jointNodeIdx = skin.joints[i];
@@ -633,24 +1069,6 @@ namespace ve{
                  // local world magtrix
                 // extractNodeTransform(model.nodes[jointNodeIdx], joints[i]);
                 // joints[i].jointWorldMatrix = calculateLocalTransform(joints[i]);
-                // Debug: Print inverse bind matrix for each joint
-                std::cout << "Joint " << i << " (" << joints[i].name << ") - Inverse Bind Matrix:" << std::endl;
-                for (int row = 0; row < 4; row++) {
-                    std::cout << "  [";
-                    for (int col = 0; col < 4; col++) {
-                        std::cout << joints[i].inverseBindMatrix[col][row];
-                        if (col < 3) std::cout << ", ";
-                    }
-                    std::cout << "]" << std::endl;
-                }
-                
-                // Also print raw data values for verification
-                std::cout << "  Raw data: ";
-                for (int j = 0; j < 16; j++) {
-                    std::cout << inverseBindMatricesData[i * 16 + j];
-                    if (j < 15) std::cout << ", ";
-                }
-                std::cout << std::endl;
 
                 //obtain TRS and localWorldMatrix
                 auto& node = model.nodes[jointNodeIdx];
@@ -673,16 +1091,6 @@ namespace ve{
             loadJoints(rootJoint, -1, model);
             // updateJointHierarchy(model);
         }
-        //create shader buffer
-        uint32_t numJoints = static_cast<uint32_t>(skeleton->joints.size());
-        uint32_t jointSize = static_cast<uint32_t>(sizeof(glm::mat4));
-        shaderJointsBuffer.resize(ve::VeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i=0;i<shaderJointsBuffer.size();i++){
-            shaderJointsBuffer[i] = std::make_unique<VeBuffer>(veDevice, numJoints * jointSize, 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, veDevice.properties.limits.minUniformBufferOffsetAlignment);
-            shaderJointsBuffer[i]->map();
-        }
-        
     }
     void VeModel::loadJoints(int nodeIndex, int parentIndex, const tinygltf::Model& model){
         int currentJoint = skeleton->nodeJointMap[nodeIndex];
@@ -826,7 +1234,6 @@ namespace ve{
                 }
             }
             animationManager->push(anim);
-            std::cout << "Animation loaded: " << anim->getName() << std::endl;
         }
         hasAnimation = (animationManager->size()) ? true : false;
     }
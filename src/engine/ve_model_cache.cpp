@@ -0,0 +1,492 @@
+#include "ve_model_cache.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ve{
+    namespace{
+        constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+        constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+        constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+        uint64_t fnv1a(const uint8_t* data, size_t size, uint64_t hash = FNV_OFFSET){
+            for(size_t i = 0; i < size; i++){
+                hash ^= data[i];
+                hash *= FNV_PRIME;
+            }
+            return hash;
+        }
+        uint64_t alignOffset(uint64_t offset){
+            return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+        }
+        //written as a subtraction so a corrupt offset near UINT64_MAX cannot wrap past the check
+        bool blobInBounds(uint64_t offset, uint64_t bytes, uint64_t size){
+            return offset <= size && bytes <= size - offset;
+        }
+        //loader workers and other processes may store the same entry at once, so each writer gets its own temp file
+        std::string tempFilePath(const std::string& cachePath){
+            static std::atomic<uint64_t> counter{0};
+#ifdef _WIN32
+            unsigned long processId = GetCurrentProcessId();
+#else
+            unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+            size_t threadId = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            return cachePath + "." + std::to_string(processId) + "." + std::to_string(threadId) + "." +
+                std::to_string(counter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+        }
+        std::string directoryOf(const std::string& path){
+            size_t slash = path.find_last_of("/\\");
+            return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        }
+        //external buffers of a .gltf are part of its content, so collect every "uri" ending in .bin
+        std::vector<std::string> gltfBufferUris(const uint8_t* data, size_t size){
+            std::vector<std::string> uris;
+            std::string json(reinterpret_cast<const char*>(data), size);
+            size_t pos = 0;
+            while((pos = json.find("\"uri\"", pos)) != std::string::npos){
+                size_t open = json.find('"', json.find(':', pos) + 1);
+                size_t close = json.find('"', open + 1);
+                if(open == std::string::npos || close == std::string::npos) break;
+                std::string uri = json.substr(open + 1, close - open - 1);
+                if(uri.size() > 4 && uri.compare(uri.size() - 4, 4, ".bin") == 0){
+                    uris.push_back(uri);
+                }
+                pos = close + 1;
+            }
+            return uris;
+        }
+
+        //skeleton and clips are variable sized, serialize them into a flat blob
+        class BlobWriter{
+        public:
+            template<typename T> void write(const T& value){
+                static_assert(std::is_trivially_copyable<T>::value, "blob values must be trivially copyable");
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+                data.insert(data.end(), bytes, bytes + sizeof(T));
+            }
+            template<typename T> void writeVector(const std::vector<T>& values){
+                static_assert(std::is_trivially_copyable<T>::value, "blob values must be trivially copyable");
+                write(static_cast<uint32_t>(values.size()));
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(values.data());
+                data.insert(data.end(), bytes, bytes + sizeof(T) * values.size());
+            }
+            void writeString(const std::string& value){
+                write(static_cast<uint32_t>(value.size()));
+                data.insert(data.end(), value.begin(), value.end());
+            }
+            std::vector<uint8_t> data;
+        };
+        class BlobReader{
+        public:
+            BlobReader(const uint8_t* data, size_t size): cursor(data), end(data + size){}
+            template<typename T> T read(){
+                T value{};
+                if(!require(sizeof(T))) return value;
+                std::memcpy(&value, cursor, sizeof(T));
+                cursor += sizeof(T);
+                return value;
+            }
+            template<typename T> void readVector(std::vector<T>& values){
+                uint32_t count = read<uint32_t>();
+                if(!require(sizeof(T) * static_cast<size_t>(count))) return;
+                values.resize(count);
+                std::memcpy(values.data(), cursor, sizeof(T) * count);
+                cursor += sizeof(T) * count;
+            }
+            std::string readString(){
+                uint32_t length = read<uint32_t>();
+                if(!require(length)) return {};
+                std::string value(reinterpret_cast<const char*>(cursor), length);
+                cursor += length;
+                return value;
+            }
+            bool failed{false};
+        private:
+            bool require(size_t bytes){
+                if(failed || static_cast<size_t>(end - cursor) < bytes){
+                    failed = true;
+                    return false;
+                }
+                return true;
+            }
+            const uint8_t* cursor;
+            const uint8_t* end;
+        };
+
+        void writeSkeleton(BlobWriter& writer, const Skeleton& skeleton){
+            writer.writeString(skeleton.name);
+            writer.write(static_cast<uint8_t>(skeleton.isAnimated));
+            writer.write(static_cast<uint32_t>(skeleton.joints.size()));
+            for(const auto& joint: skeleton.joints){
+                writer.writeString(joint.name);
+                writer.write(joint.parentIndex);
+                writer.writeVector(joint.childrenIndices);
+                writer.write(joint.jointWorldMatrix);
+                writer.write(joint.inverseBindMatrix);
+                writer.write(joint.translation);
+                writer.write(joint.rotation);
+                writer.write(joint.scale);
+            }
+            writer.write(static_cast<uint32_t>(skeleton.jointMatrices.size()));
+            writer.write(static_cast<uint32_t>(skeleton.nodeJointMap.size()));
+            for(const auto& [node, joint]: skeleton.nodeJointMap){
+                writer.write(node);
+                writer.write(joint);
+            }
+        }
+        std::unique_ptr<Skeleton> readSkeleton(BlobReader& reader){
+            auto skeleton = std::make_unique<Skeleton>();
+            skeleton->name = reader.readString();
+            skeleton->isAnimated = reader.read<uint8_t>() != 0;
+            uint32_t numJoints = reader.read<uint32_t>();
+            skeleton->joints.resize(reader.failed ? 0 : numJoints);
+            for(auto& joint: skeleton->joints){
+                joint.name = reader.readString();
+                joint.parentIndex = reader.read<int>();
+                reader.readVector(joint.childrenIndices);
+                joint.jointWorldMatrix = reader.read<glm::mat4>();
+                joint.inverseBindMatrix = reader.read<glm::mat4>();
+                joint.translation = reader.read<glm::vec3>();
+                joint.rotation = reader.read<glm::quat>();
+                joint.scale = reader.read<glm::vec3>();
+            }
+            skeleton->jointMatrices.resize(reader.read<uint32_t>());
+            uint32_t numMappings = reader.read<uint32_t>();
+            for(uint32_t i = 0; i < numMappings && !reader.failed; i++){
+                int node = reader.read<int>();
+                skeleton->nodeJointMap[node] = reader.read<int>();
+            }
+            return skeleton;
+        }
+        void writeAnimations(BlobWriter& writer, AnimationManager& animationManager){
+            uint32_t numAnimations = static_cast<uint32_t>(animationManager.size());
+            writer.write(numAnimations);
+            for(uint32_t i = 0; i < numAnimations; i++){
+                Animation& animation = animationManager[static_cast<int>(i)];
+                writer.writeString(animation.getName());
+                writer.write(animation.getFirstKeyFrameTime());
+                writer.write(animation.getLastKeyFrameTime());
+                writer.write(static_cast<uint32_t>(animation.samplers.size()));
+                for(const auto& sampler: animation.samplers){
+                    writer.write(sampler.interpolationMethod);
+                    writer.writeVector(sampler.timeStamps);
+                    writer.writeVector(sampler.TRSoutputValues);
+                }
+                writer.writeVector(animation.channels);
+            }
+        }
+        std::shared_ptr<AnimationManager> readAnimations(BlobReader& reader){
+            auto animationManager = std::make_shared<AnimationManager>();
+            uint32_t numAnimations = reader.read<uint32_t>();
+            for(uint32_t i = 0; i < numAnimations && !reader.failed; i++){
+                auto animation = std::make_shared<Animation>(reader.readString());
+                animation->setFirstKeyFrameTime(reader.read<float>());
+                animation->setLastKeyFrameTime(reader.read<float>());
+                uint32_t numSamplers = reader.read<uint32_t>();
+                animation->samplers.resize(reader.failed ? 0 : numSamplers);
+                for(auto& sampler: animation->samplers){
+                    sampler.interpolationMethod = reader.read<Animation::InterpolationMethod>();
+                    reader.readVector(sampler.timeStamps);
+                    reader.readVector(sampler.TRSoutputValues);
+                }
+                reader.readVector(animation->channels);
+                animationManager->push(animation);
+            }
+            return animationManager;
+        }
+    }
+
+    MappedFile::~MappedFile(){
+        close();
+    }
+    bool MappedFile::open(const std::string& path){
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(file == INVALID_HANDLE_VALUE){
+            return false;
+        }
+        LARGE_INTEGER fileSize{};
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0){
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mapping){
+            CloseHandle(file);
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(!view){
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+        fileHandle = file;
+        mappingHandle = mapping;
+        mappedData = static_cast<const uint8_t*>(view);
+        mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0){
+            return false;
+        }
+        struct stat fileStat{};
+        if(fstat(fd, &fileStat) != 0 || fileStat.st_size == 0){
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        //the mapping keeps its own reference to the file
+        ::close(fd);
+        if(view == MAP_FAILED){
+            return false;
+        }
+        mappedData = static_cast<const uint8_t*>(view);
+        mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+        return true;
+    }
+    void MappedFile::close(){
+        if(!mappedData){
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(mappedData);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+
+    std::string VeModelCache::cacheFilePath(const std::string& filePath, VeModel::VertexLayout layout){
+        size_t slash = filePath.find_last_of("/\\");
+        std::string fileName = slash == std::string::npos ? filePath : filePath.substr(slash + 1);
+        uint64_t pathHash = fnv1a(reinterpret_cast<const uint8_t*>(filePath.data()), filePath.size());
+        char suffix[17];
+        std::snprintf(suffix, sizeof(suffix), "%016llx", static_cast<unsigned long long>(pathHash));
+        return std::string(ENGINE_DIR) + "assets/cache/" + fileName + "." + suffix + "." + VeModel::getVertexLayoutName(layout) + ".vemesh";
+    }
+    uint64_t VeModelCache::hashSource(const std::string& filePath){
+        std::string fullPath = std::string(ENGINE_DIR) + filePath;
+        MappedFile source;
+        if(!source.open(fullPath)){
+            return 0;
+        }
+        uint64_t hash = fnv1a(source.data(), source.size());
+        std::string extension = filePath.substr(filePath.find_last_of(".") + 1);
+        if(extension == "gltf"){
+            std::string directory = directoryOf(fullPath);
+            for(const auto& uri: gltfBufferUris(source.data(), source.size())){
+                MappedFile buffer;
+                if(buffer.open(directory + uri)){
+                    hash = fnv1a(buffer.data(), buffer.size(), hash);
+                }
+            }
+        }
+        return hash;
+    }
+
+    bool VeModelCache::load(const std::string& filePath, VeModel::VertexLayout layout, Entry& entry){
+        uint64_t sourceHash = hashSource(filePath);
+        if(!sourceHash || !entry.file.open(cacheFilePath(filePath, layout))){
+            return false;
+        }
+        const uint8_t* base = entry.file.data();
+        size_t size = entry.file.size();
+        if(size < sizeof(Header)){
+            return false;
+        }
+        const Header* header = reinterpret_cast<const Header*>(base);
+        //stale or foreign entries are simply rebuilt
+        if(header->magic != MAGIC || header->version != VERSION || header->sourceHash != sourceHash ||
+           header->vertexLayout >= VeModel::VERTEX_LAYOUT_COUNT ||
+           header->vertexStride != VeModel::getVertexStride(static_cast<VeModel::VertexLayout>(header->vertexLayout)) ||
+           (header->indexType != VK_INDEX_TYPE_UINT16 && header->indexType != VK_INDEX_TYPE_UINT32)){
+            return false;
+        }
+        uint64_t indexStride = header->indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        uint64_t vertexBytes = VeModel::getVertexDataSize(static_cast<VeModel::VertexLayout>(header->vertexLayout), header->vertexCount);
+        uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * indexStride;
+        uint64_t meshletBytes = static_cast<uint64_t>(header->meshletCount) * sizeof(Meshlet);
+        uint64_t lodBytes = static_cast<uint64_t>(header->lodCount) * sizeof(VeModel::Lod);
+        uint64_t submeshBytes = static_cast<uint64_t>(header->submeshCount) * sizeof(VeModel::Submesh);
+        uint64_t materialBytes = static_cast<uint64_t>(header->materialCount) * sizeof(VeModel::Material);
+        if(!blobInBounds(header->vertexOffset, vertexBytes, size) || !blobInBounds(header->indexOffset, indexBytes, size) ||
+           !blobInBounds(header->meshletOffset, meshletBytes, size) || !blobInBounds(header->lodOffset, lodBytes, size) ||
+           header->lodCount > VeModel::MAX_LODS ||
+           !blobInBounds(header->submeshOffset, submeshBytes, size) || !blobInBounds(header->materialOffset, materialBytes, size) ||
+           (header->lodCount && header->submeshCount % header->lodCount != 0) ||
+           !blobInBounds(header->skinOffset, header->skinSize, size)){
+            return false;
+        }
+        entry.header = header;
+        VeModel::PackedGeometry& geometry = entry.geometry;
+        geometry.layout = static_cast<VeModel::VertexLayout>(header->vertexLayout);
+        geometry.indexType = static_cast<VkIndexType>(header->indexType);
+        geometry.vertexData = base + header->vertexOffset;
+        geometry.vertexCount = header->vertexCount;
+        geometry.indexData = header->indexCount ? base + header->indexOffset : nullptr;
+        geometry.indexCount = header->indexCount;
+        geometry.meshlets = header->meshletCount ? reinterpret_cast<const Meshlet*>(base + header->meshletOffset) : nullptr;
+        geometry.meshletCount = header->meshletCount;
+        geometry.lods = header->lodCount ? reinterpret_cast<const VeModel::Lod*>(base + header->lodOffset) : nullptr;
+        geometry.lodCount = header->lodCount;
+        geometry.submeshes = header->submeshCount ? reinterpret_cast<const VeModel::Submesh*>(base + header->submeshOffset) : nullptr;
+        geometry.submeshCount = header->submeshCount;
+        geometry.materials = header->materialCount ? reinterpret_cast<const VeModel::Material*>(base + header->materialOffset) : nullptr;
+        geometry.materialCount = header->materialCount;
+        geometry.bounds.min = {header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]};
+        geometry.bounds.max = {header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]};
+        if(header->flags & (FLAG_SKELETON | FLAG_ANIMATIONS)){
+            BlobReader reader(base + header->skinOffset, header->skinSize);
+            if(header->flags & FLAG_SKELETON){
+                entry.skeleton = readSkeleton(reader);
+            }
+            if(header->flags & FLAG_ANIMATIONS){
+                entry.animationManager = readAnimations(reader);
+            }
+            if(reader.failed){
+                std::cerr << "Corrupt skin data in model cache for " << filePath << std::endl;
+                entry.skeleton.reset();
+                entry.animationManager.reset();
+                return false;
+            }
+        }
+        return true;
+    }
+    bool VeModelCache::store(const std::string& filePath, VeModel::VertexLayout layout, const VeModel::PackedGeometry& geometry, const VeModel& model){
+        if(geometry.vertexCount == 0){
+            return false;
+        }
+        BlobWriter skin;
+        uint32_t flags = 0;
+        if(model.skeleton){
+            writeSkeleton(skin, *model.skeleton);
+            flags |= FLAG_SKELETON;
+        }
+        if(model.animationManager){
+            writeAnimations(skin, *model.animationManager);
+            flags |= FLAG_ANIMATIONS;
+        }
+
+        uint64_t vertexBytes = VeModel::getVertexDataSize(geometry.layout, geometry.vertexCount);
+        uint64_t indexBytes = static_cast<uint64_t>(geometry.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t)) * geometry.indexCount;
+        uint64_t meshletBytes = static_cast<uint64_t>(geometry.meshletCount) * sizeof(Meshlet);
+        uint64_t lodBytes = static_cast<uint64_t>(geometry.lodCount) * sizeof(VeModel::Lod);
+        uint64_t submeshBytes = static_cast<uint64_t>(geometry.submeshCount) * sizeof(VeModel::Submesh);
+        uint64_t materialBytes = static_cast<uint64_t>(geometry.materialCount) * sizeof(VeModel::Material);
+        Header header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = hashSource(filePath);
+        header.vertexLayout = static_cast<uint32_t>(geometry.layout);
+        header.vertexStride = VeModel::getVertexStride(geometry.layout);
+        header.indexType = static_cast<uint32_t>(geometry.indexType);
+        header.vertexCount = geometry.vertexCount;
+        header.indexCount = geometry.indexCount;
+        header.meshletCount = geometry.meshletCount;
+        header.lodCount = geometry.lodCount;
+        header.submeshCount = geometry.submeshCount;
+        header.materialCount = geometry.materialCount;
+        header.flags = flags;
+        for(int i = 0; i < 3; i++){
+            header.boundsMin[i] = geometry.bounds.min[i];
+            header.boundsMax[i] = geometry.bounds.max[i];
+        }
+        header.vertexOffset = alignOffset(sizeof(Header));
+        header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+        header.meshletOffset = alignOffset(header.indexOffset + indexBytes);
+        header.lodOffset = alignOffset(header.meshletOffset + meshletBytes);
+        header.submeshOffset = alignOffset(header.lodOffset + lodBytes);
+        header.materialOffset = alignOffset(header.submeshOffset + submeshBytes);
+        header.skinOffset = alignOffset(header.materialOffset + materialBytes);
+        header.skinSize = skin.data.size();
+
+        std::string cachePath = cacheFilePath(filePath, layout);
+        std::string tempPath = tempFilePath(cachePath);
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if(!file){
+                std::cerr << "Failed to write model cache: " << cachePath << std::endl;
+                return false;
+            }
+            const char padding[BLOB_ALIGNMENT] = {};
+            auto pad = [&](uint64_t offset){
+                file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+            };
+            file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            pad(header.vertexOffset);
+            file.write(static_cast<const char*>(geometry.vertexData), static_cast<std::streamsize>(vertexBytes));
+            pad(header.indexOffset);
+            if(indexBytes){
+                file.write(static_cast<const char*>(geometry.indexData), static_cast<std::streamsize>(indexBytes));
+            }
+            pad(header.meshletOffset);
+            if(meshletBytes){
+                file.write(reinterpret_cast<const char*>(geometry.meshlets), static_cast<std::streamsize>(meshletBytes));
+            }
+            pad(header.lodOffset);
+            if(lodBytes){
+                file.write(reinterpret_cast<const char*>(geometry.lods), static_cast<std::streamsize>(lodBytes));
+            }
+            pad(header.submeshOffset);
+            if(submeshBytes){
+                file.write(reinterpret_cast<const char*>(geometry.submeshes), static_cast<std::streamsize>(submeshBytes));
+            }
+            pad(header.materialOffset);
+            if(materialBytes){
+                file.write(reinterpret_cast<const char*>(geometry.materials), static_cast<std::streamsize>(materialBytes));
+            }
+            pad(header.skinOffset);
+            file.write(reinterpret_cast<const char*>(skin.data.data()), static_cast<std::streamsize>(skin.data.size()));
+            if(!file){
+                file.close();
+                std::filesystem::remove(tempPath, error);
+                std::cerr << "Failed to write model cache: " << cachePath << std::endl;
+                return false;
+            }
+        }
+        //publish atomically so a crash mid-write never leaves a truncated entry behind
+        std::filesystem::remove(cachePath, error);
+        std::filesystem::rename(tempPath, cachePath, error);
+        if(error){
+            std::error_code ignored;
+            std::filesystem::remove(tempPath, ignored);
+            return false;
+        }
+        return true;
+    }
+}
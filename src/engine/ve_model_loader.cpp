@@ -0,0 +1,267 @@
+#include "ve_model_loader.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace ve{
+    namespace{
+        constexpr float PLACEHOLDER_HALF_EXTENT = 0.5f;
+        const glm::vec3 PLACEHOLDER_COLOR{0.8f, 0.8f, 0.8f};
+    }
+
+    VeModelLoader::VeModelLoader(VeDevice& device, VeUploadContext& uploadContext, VeGeometryHeap* geometryHeap, uint32_t workerCount):
+        veDevice{device}, uploadContext{uploadContext}, geometryHeap{geometryHeap}{
+        createPlaceholder();
+        workerCount = std::max(workerCount, 1u);
+        for(uint32_t i = 0; i < workerCount; i++){
+            workers.emplace_back(&VeModelLoader::workerLoop, this);
+        }
+    }
+    VeModelLoader::~VeModelLoader(){
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+            jobs.clear();
+        }
+        jobAvailable.notify_all();
+        for(auto& worker: workers){
+            worker.join();
+        }
+        //uploads still in flight own buffers the gpu may be copying into
+        if(!uploads.empty()){
+            uploadContext.wait(uploads.back().ticket);
+        }
+    }
+
+    std::string VeModelLoader::requestKey(const std::string& filePath, VeModel::VertexLayout layout){
+        return filePath + "#" + std::to_string(static_cast<uint32_t>(layout));
+    }
+    std::shared_ptr<VeModelHandle> VeModelLoader::load(const std::string& filePath, VeModel::VertexLayout layout){
+        //two workers writing the same cache entry would race, and the second import would be wasted anyway
+        std::string key = requestKey(filePath, layout);
+        auto pending = inFlight.find(key);
+        if(pending != inFlight.end()){
+            return pending->second;
+        }
+        auto handle = std::make_shared<VeModelHandle>();
+        handle->filePath = filePath;
+        handle->layout = layout;
+        handle->placeholder = placeholder;
+        inFlight[key] = handle;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back({handle, layout});
+        }
+        jobAvailable.notify_one();
+        return handle;
+    }
+    void VeModelLoader::evict(VeModelHandle& handle){
+        if(handle.getState() != VeModelHandle::State::READY){
+            return;
+        }
+        handle.model.reset();
+        handle.generation++;
+        handle.state.store(VeModelHandle::State::EVICTED, std::memory_order_release);
+    }
+    void VeModelLoader::reload(const std::shared_ptr<VeModelHandle>& handle){
+        if(handle->getState() != VeModelHandle::State::EVICTED){
+            return;
+        }
+        handle->state.store(VeModelHandle::State::LOADING, std::memory_order_release);
+        inFlight[requestKey(handle->filePath, handle->layout)] = handle;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back({handle, handle->layout});
+        }
+        jobAvailable.notify_one();
+    }
+    size_t VeModelLoader::getPendingCount() const{
+        return inFlight.size();
+    }
+
+    void VeModelLoader::workerLoop(){
+        while(true){
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                jobAvailable.wait(lock, [this]{ return stopping || !jobs.empty(); });
+                if(stopping){
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            Imported result{};
+            result.handle = job.handle;
+            try{
+                result.import = importModel(veDevice, job.handle->filePath, job.layout);
+            }catch(const std::exception& e){
+                result.error = e.what();
+            }
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                imported.push_back(std::move(result));
+            }
+            importFinished.notify_all();
+        }
+    }
+
+    void VeModelLoader::update(){
+        std::vector<Imported> finished;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            finished.swap(imported);
+        }
+        for(auto& result: finished){
+            if(!result.import){
+                result.handle->error = result.error;
+                std::cerr << "Failed to load model " << result.handle->filePath << ": " << result.error << std::endl;
+                resolve(result.handle, VeModelHandle::State::FAILED);
+                continue;
+            }
+            recordUpload(result);
+        }
+        //every model that finished importing this frame shares one submission
+        if(uploadContext.hasRecordedCommands()){
+            VeUploadContext::Ticket ticket = uploadContext.submit();
+            for(auto& upload: uploads){
+                if(upload.ticket == 0){
+                    upload.ticket = ticket;
+                }
+            }
+        }
+        //poll, never wait: a model that is not resident yet just keeps its placeholder for another frame
+        for(auto it = uploads.begin(); it != uploads.end();){
+            if(!uploadContext.isComplete(it->ticket)){
+                ++it;
+                continue;
+            }
+            float latency = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - it->start).count();
+            std::cout << "Model " << it->handle->filePath << " resident " << latency << " ms after its load request" << std::endl;
+            it->handle->model = std::move(it->model);
+            it->handle->generation++;
+            resolve(it->handle, VeModelHandle::State::READY);
+            it = uploads.erase(it);
+        }
+    }
+    void VeModelLoader::wait(const VeModelHandle& handle){
+        update();
+        while(!handle.isResolved()){
+            if(!uploads.empty()){
+                uploadContext.wait(uploads.front().ticket);
+            }else{
+                std::unique_lock<std::mutex> lock{mutex};
+                importFinished.wait(lock, [this]{ return !imported.empty(); });
+            }
+            update();
+        }
+    }
+    void VeModelLoader::resolve(const std::shared_ptr<VeModelHandle>& handle, VeModelHandle::State state){
+        handle->state.store(state, std::memory_order_release);
+        for(auto it = inFlight.begin(); it != inFlight.end(); ++it){
+            if(it->second == handle){
+                inFlight.erase(it);
+                break;
+            }
+        }
+    }
+
+    void VeModelLoader::recordUpload(Imported& result){
+        Upload upload{};
+        upload.handle = result.handle;
+        upload.start = result.import->start;
+        upload.model = finishImport(*result.import, uploadContext, geometryHeap);
+        //the mapped cache entry or builder is no longer needed once the staging buffers hold the data
+        result.import.reset();
+        //ticket stays 0 until update() submits the batch
+        uploads.push_back(std::move(upload));
+    }
+
+    std::unique_ptr<ModelImport> VeModelLoader::importModel(VeDevice& device, const std::string& filePath, VeModel::VertexLayout layout){
+        auto import = std::make_unique<ModelImport>();
+        import->filePath = filePath;
+        import->start = std::chrono::high_resolution_clock::now();
+        //VeModel's constructor is private to us, make_unique cannot reach it
+        import->model = std::unique_ptr<VeModel>(new VeModel(device));
+        VeModel& model = *import->model;
+        //warm path: packed vertices, indices and skin data come straight out of the mapped cache entry
+        if(VeModelCache::load(filePath, layout, import->cached)){
+            import->geometry = import->cached.geometry;
+            model.skeleton = std::move(import->cached.skeleton);
+            if(import->cached.animationManager){
+                model.animationManager = std::move(import->cached.animationManager);
+                model.hasAnimation = model.animationManager->size() > 0;
+            }
+            return import;
+        }
+        import->source = "source (cold)";
+        VeModel::Builder& builder = import->builder;
+        builder.loadFromFile(filePath);
+        builder.optimize();
+        builder.buildMeshlets();
+        builder.buildLods();
+        import->geometry = VeModel::packGeometry(builder, layout);
+        std::string extension = filePath.substr(filePath.find_last_of(".") + 1);
+        if(extension == "gltf" || extension == "glb"){
+            model.loadSkeleton(builder.model);
+            model.loadAnimations(builder.model);
+        }
+        //store only reads the packed geometry and the skin data, nothing on the gpu yet
+        import->cacheStoreFailed = !VeModelCache::store(filePath, layout, import->geometry, model);
+        return import;
+    }
+    std::unique_ptr<VeModel> VeModelLoader::finishImport(ModelImport& import, VeUploadContext& uploadContext, VeGeometryHeap* geometryHeap){
+        std::unique_ptr<VeModel> model = std::move(import.model);
+        model->upload(import.geometry, uploadContext, geometryHeap);
+        //importModel prints nothing, it may run on a worker, the cold path's statistics are reported here instead
+        import.builder.reportOptimize();
+        if(!import.builder.lods.empty()){
+            VeModel::reportLods(import.builder.lods.data(), static_cast<uint32_t>(import.builder.lods.size()));
+        }
+        if(import.cacheStoreFailed){
+            std::cerr << "Could not cache model " << import.filePath << std::endl;
+        }
+        if(model->hasAnimation){
+            for(auto& animation: *model->animationManager){
+                std::cout << "Animation loaded: " << animation.getName() << std::endl;
+            }
+        }
+        float loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - import.start).count();
+        //compare against the float layout with 32 bit indices every model used to get
+        VkDeviceSize fullBytes = static_cast<VkDeviceSize>(sizeof(VeModel::Vertex)) * model->vertexCount + sizeof(uint32_t) * static_cast<VkDeviceSize>(model->indexCount);
+        std::cout << "Loaded model " << import.filePath << " from " << import.source << " in " << loadTime << " ms ("
+                  << VeModel::getVertexLayoutName(model->vertexLayout) << ", " << VeModel::getVertexStride(model->vertexLayout) << " B/vertex, "
+                  << (model->indexType == VK_INDEX_TYPE_UINT16 ? 16 : 32) << "-bit indices, "
+                  << model->getGeometryBytes() << " bytes vs " << fullBytes << " unpacked, " << model->meshlets.size() << " meshlets, "
+                  << model->lods.size() << " LODs" << (model->isInGeometryHeap() ? ", geometry heap" : "") << ")" << std::endl;
+        return model;
+    }
+
+    void VeModelLoader::createPlaceholder(){
+        //unit box, drawn wherever a model is still streaming in
+        VeModel::Builder builder{};
+        const glm::vec3 normals[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        for(const auto& normal: normals){
+            //two axes spanning the face, ordered so the winding faces outwards
+            glm::vec3 u = glm::vec3(normal.y, normal.z, normal.x);
+            glm::vec3 v = glm::cross(normal, u);
+            uint32_t first = static_cast<uint32_t>(builder.vertices.size());
+            const glm::vec2 corners[4] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+            for(const auto& corner: corners){
+                VeModel::Vertex vertex{};
+                vertex.position = (normal + u * corner.x + v * corner.y) * PLACEHOLDER_HALF_EXTENT;
+                vertex.color = PLACEHOLDER_COLOR;
+                vertex.normal = normal;
+                vertex.uv = (corner + glm::vec2(1.0f)) * 0.5f;
+                vertex.tangent = glm::vec4(u, 1.0f);
+                vertex.jointWeights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+                builder.vertices.push_back(vertex);
+            }
+            for(uint32_t index: {0u, 1u, 2u, 2u, 3u, 0u}){
+                builder.indices.push_back(first + index);
+            }
+        }
+        placeholder = std::make_shared<VeModel>(veDevice, builder, VeModel::VertexLayout::PACKED_STATIC);
+    }
+}
@@ -12,9 +12,9 @@ namespace ve{
     }
     
     VePipeline::~VePipeline(){
-        vkDestroyShaderModule(veDevice.device(), vertShaderModule, nullptr);
-        vkDestroyShaderModule(veDevice.device(), fragShaderModule, nullptr);
-        vkDestroyPipeline(veDevice.device(), graphicsPipeline, nullptr);
+        vkDestroyShaderModule(veDevice.device(), vertShaderModule, veDevice.allocationCallbacks());
+        vkDestroyShaderModule(veDevice.device(), fragShaderModule, veDevice.allocationCallbacks());
+        vkDestroyPipeline(veDevice.device(), graphicsPipeline, veDevice.allocationCallbacks());
     }
     std::vector<char> VePipeline::readFile(const std::string& filepath){
         std::string fullPath = std::string(ENGINE_DIR) + filepath;
@@ -84,7 +84,7 @@ namespace ve{
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(veDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(veDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, veDevice.allocationCallbacks(), &graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
     }
@@ -94,7 +94,7 @@ namespace ve{
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         createInfo.codeSize = code.size();
         createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-        if(vkCreateShaderModule(veDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS){
+        if(vkCreateShaderModule(veDevice.device(), &createInfo, veDevice.allocationCallbacks(), shaderModule) != VK_SUCCESS){
             throw std::runtime_error("failed to create shader module!");
         }
     }
@@ -1,12 +1,15 @@
 #include "ve_renderer.hpp"
 
 
+#include <algorithm>
 #include <array>
 #include <stdexcept>
 #include <cassert>
 namespace ve {
 
-    VeRenderer::VeRenderer(VeWindow& window, VeDevice& device): veWindow{window}, veDevice{device} {
+    VeRenderer::VeRenderer(VeWindow& window, VeDevice& device, int framesInFlight): veWindow{window}, veDevice{device} {
+        this->framesInFlight = std::clamp(framesInFlight, 1, VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        frameValues.resize(this->framesInFlight, 0);
         recreateSwapChain();
         createCommandBuffers();
     }
@@ -23,10 +26,10 @@ namespace ve {
         vkDeviceWaitIdle(veDevice.device());
         // veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent);
         if(veSwapChain == nullptr){
-            veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent);
+            veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent, framesInFlight);
         }else{
             std::shared_ptr<VeSwapChain> oldSwapChain = std::move(veSwapChain);
-            veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent,oldSwapChain);
+            veSwapChain = std::make_unique<VeSwapChain>(veDevice, extent, framesInFlight, oldSwapChain);
             if(!oldSwapChain->compareSwapFormats(*veSwapChain.get())){
                 throw std::runtime_error("Swap chain image and depth format changed!");
             }
@@ -34,7 +37,7 @@ namespace ve {
 
     }
     void VeRenderer::createCommandBuffers() {
-        commandBuffers.resize(VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+        commandBuffers.resize(framesInFlight);
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -43,15 +46,25 @@ namespace ve {
         if (vkAllocateCommandBuffers(veDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate command buffers!");
         }
+        computeCommandBuffers.resize(framesInFlight);
+        allocInfo.commandPool = veDevice.getComputeCommandPool();
+        allocInfo.commandBufferCount = static_cast<uint32_t>(computeCommandBuffers.size());
+        if (vkAllocateCommandBuffers(veDevice.device(), &allocInfo, computeCommandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate compute command buffers!");
+        }
     }
    
     void VeRenderer::freeCommandBuffers(){
         vkFreeCommandBuffers(veDevice.device(), veDevice.getCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
         commandBuffers.clear();
+        vkFreeCommandBuffers(veDevice.device(), veDevice.getComputeCommandPool(), static_cast<uint32_t>(computeCommandBuffers.size()), computeCommandBuffers.data());
+        computeCommandBuffers.clear();
     }
     VkCommandBuffer VeRenderer::beginFrame(){
         assert(!isFrameStarted && "Can't call beginFrame while frame is already in progress.");
-        auto  result = veSwapChain->acquireNextImage(&currentImageIndex);
+        //the frame recorded framesInFlight frames ago with this index has to be done with its command buffer and per frame data
+        veDevice.getGraphicsTimeline().wait(frameValues[currentFrameIndex]);
+        auto  result = veSwapChain->acquireNextImage(currentFrameIndex, &currentImageIndex);
         //If the surface has changed and is no longer compatible with the swap chain
         //we need to recreate the swap chain
         if(result == VK_ERROR_OUT_OF_DATE_KHR){
@@ -65,6 +78,7 @@ namespace ve {
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        VeHostAllocator::Label label{"vkBeginCommandBuffer"};
         if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS){
             throw std::runtime_error("failed to begin recording command buffer!");
         }
@@ -73,10 +87,16 @@ namespace ve {
     void VeRenderer::endFrame(){
         assert(isFrameStarted && "Can't call endFrame while frame is not in progress.");
         auto commandBuffer = getCurrentCommandBuffer();
-        if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
-            throw std::runtime_error("failed to record command buffer!");
+        {
+            VeHostAllocator::Label label{"vkEndCommandBuffer"};
+            if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+                throw std::runtime_error("failed to record command buffer!");
+            }
         }
-        auto result = veSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+        assert(!isComputeStarted && "Can't call endFrame while compute commands are still being recorded.");
+        auto result = veSwapChain->submitCommandBuffers(currentFrameIndex, &commandBuffer, &currentImageIndex, frameWaitCount, frameWaits.data());
+        frameWaitCount = 0;
+        frameValues[currentFrameIndex] = veDevice.getGraphicsTimeline().getSubmittedValue();
         if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || veWindow.wasWindowResized()){
             veWindow.resetWindowResizedFlag();
             recreateSwapChain();
@@ -84,9 +104,48 @@ namespace ve {
             throw std::runtime_error("failed to submit command buffer!");
         }
         isFrameStarted = false;
-        currentFrameIndex = (currentFrameIndex + 1) % VeSwapChain::MAX_FRAMES_IN_FLIGHT;
+        currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
+    }
+    VkCommandBuffer VeRenderer::beginComputeCommands(){
+        assert(isFrameStarted && "Can't begin compute commands when frame is not in progress.");
+        assert(!isComputeStarted && "Can't begin compute commands twice in one frame.");
+        //beginFrame waited for the frame that last used it, and that frame's graphics submission waited for its dispatches
+        VkCommandBuffer commandBuffer = computeCommandBuffers[currentFrameIndex];
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS){
+            throw std::runtime_error("failed to begin recording compute command buffer!");
+        }
+        isComputeStarted = true;
+        return commandBuffer;
     }
-    void VeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer){
+    void VeRenderer::submitComputeCommands(VkPipelineStageFlags graphicsStage){
+        assert(isComputeStarted && "Can't submit compute commands that were not begun.");
+        VkCommandBuffer commandBuffer = computeCommandBuffers[currentFrameIndex];
+        if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+            throw std::runtime_error("failed to record compute command buffer!");
+        }
+        isComputeStarted = false;
+        waitForCompute(veDevice.getComputeTimeline().submit(1, &commandBuffer), graphicsStage);
+    }
+    void VeRenderer::waitForCompute(uint64_t value, VkPipelineStageFlags graphicsStage){
+        assert(isFrameStarted && "Can't add a compute wait when frame is not in progress.");
+        VkSemaphore semaphore = veDevice.getComputeTimeline().getSemaphore();
+        //one wait per timeline, the later value covers the earlier one
+        for(uint32_t i = 0; i < frameWaitCount; i++){
+            if(frameWaits[i].semaphore == semaphore){
+                frameWaits[i].value = std::max(frameWaits[i].value, value);
+                frameWaits[i].stage |= graphicsStage;
+                return;
+            }
+        }
+        if(frameWaitCount == frameWaits.size()){
+            throw std::runtime_error("too many waits for one frame submission!");
+        }
+        frameWaits[frameWaitCount++] = {semaphore, value, graphicsStage};
+    }
+    void VeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents){
         assert(isFrameStarted && "Can't begin render pass when frame is not in progress.");
         assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame.");
         VkRenderPassBeginInfo renderPassInfo{};
@@ -101,7 +160,10 @@ namespace ve {
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+        if(contents != VK_SUBPASS_CONTENTS_INLINE){
+            return;
+        }
         //dynamic viewport
         VkViewport viewport{};
         viewport.x = 0.0f;
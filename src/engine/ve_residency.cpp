@@ -0,0 +1,211 @@
+#include "ve_residency.hpp"
+
+#include <iostream>
+#include <limits>
+
+namespace ve{
+    VeResidencyManager::VeResidencyManager(VeModelLoader& modelLoader, VeUploadContext& uploadContext, VeTimeline& timeline, VkDeviceSize budget):
+        modelLoader{modelLoader}, uploadContext{uploadContext}, timeline{timeline}{
+        stats.budget = budget;
+    }
+
+    void VeResidencyManager::addModel(const std::shared_ptr<VeModelHandle>& handle){
+        if(!handle || modelIndices.count(handle.get()) > 0){
+            return;
+        }
+        modelIndices[handle.get()] = models.size();
+        models.push_back({handle, frame});
+    }
+    void VeResidencyManager::pinModel(const std::shared_ptr<VeModelHandle>& handle){
+        if(!handle){
+            return;
+        }
+        addModel(handle);
+        models[modelIndices[handle.get()]].pinned = true;
+    }
+    uint32_t VeResidencyManager::addTexture(TextureLoader loader, uint32_t fallback){
+        TextureEntry texture{};
+        texture.loader = std::move(loader);
+        texture.fallback = fallback;
+        texture.lastUsedFrame = frame;
+        loadTexture(texture);
+        textures.push_back(std::move(texture));
+        return static_cast<uint32_t>(textures.size() - 1);
+    }
+    void VeResidencyManager::loadTexture(TextureEntry& texture){
+        texture.data = texture.loader(uploadContext);
+        texture.loading = true;
+        texture.ticket = 0;
+    }
+
+    bool VeResidencyManager::isIdle(uint64_t lastUsedFrame) const{
+        return lastUsedFrame <= completedFrame;
+    }
+
+    void VeResidencyManager::update(){
+        //the previous frame is submitted by now, the newest value covers it
+        uint64_t value = timeline.getSubmittedValue();
+        size_t newest = (submittedHead + submittedCount + submittedFrames.size() - 1) % submittedFrames.size();
+        if(submittedCount > 0 && submittedFrames[newest].value == value){
+            //nothing was submitted since, e.g. the swap chain was being recreated
+            submittedFrames[newest].frame = frame;
+        }else{
+            if(submittedCount == submittedFrames.size()){
+                //more frames pending than can be in flight, only if update() was skipped for a submitted frame
+                timeline.wait(submittedFrames[submittedHead].value);
+                completedFrame = submittedFrames[submittedHead].frame;
+                submittedHead = (submittedHead + 1) % submittedFrames.size();
+                submittedCount--;
+            }
+            submittedFrames[(submittedHead + submittedCount) % submittedFrames.size()] = {frame, value};
+            submittedCount++;
+        }
+        frame++;
+        while(submittedCount > 0 && timeline.isComplete(submittedFrames[submittedHead].value)){
+            completedFrame = submittedFrames[submittedHead].frame;
+            submittedHead = (submittedHead + 1) % submittedFrames.size();
+            submittedCount--;
+        }
+        while(!pendingReleases.empty() && timeline.isComplete(pendingReleases.front().value)){
+            pendingReleases.pop_front();
+        }
+        finishTextureLoads();
+
+        stats.residentBytes = 0;
+        stats.residentModels = 0;
+        for(const auto& model: models){
+            if(model.handle->getState() == VeModelHandle::State::READY){
+                stats.residentBytes += model.handle->get()->getGeometryBytes();
+                stats.residentModels++;
+            }
+        }
+        stats.residentTextures = 0;
+        for(const auto& texture: textures){
+            //loading textures already hold their memory
+            if(texture.data.owner){
+                stats.residentBytes += texture.data.bytes;
+                stats.residentTextures += texture.resident ? 1 : 0;
+            }
+        }
+        stats.models = static_cast<uint32_t>(models.size());
+        stats.textures = static_cast<uint32_t>(textures.size());
+        stats.overBudgetBytes = 0;
+        while(stats.budget > 0 && stats.residentBytes > stats.budget){
+            if(!evictLeastRecentlyUsed()){
+                stats.overBudgetBytes = stats.residentBytes - stats.budget;
+                break;
+            }
+        }
+    }
+    void VeResidencyManager::finishTextureLoads(){
+        VeUploadContext::Ticket batch = 0;
+        for(auto& texture: textures){
+            if(!texture.loading){
+                continue;
+            }
+            //everything recorded since the last update goes out in one batch
+            if(texture.ticket == 0){
+                if(batch == 0){
+                    batch = uploadContext.submit();
+                }
+                texture.ticket = batch;
+            }
+            if(uploadContext.isComplete(texture.ticket)){
+                texture.loading = false;
+                texture.resident = true;
+                textureVersion++;
+            }
+        }
+    }
+    bool VeResidencyManager::evictLeastRecentlyUsed(){
+        //linear scans, a scene tracks tens of assets and evicts rarely
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        ModelEntry* model = nullptr;
+        TextureEntry* texture = nullptr;
+        for(auto& entry: models){
+            if(!entry.pinned && entry.handle->getState() == VeModelHandle::State::READY && isIdle(entry.lastUsedFrame) && entry.lastUsedFrame < oldest){
+                oldest = entry.lastUsedFrame;
+                model = &entry;
+            }
+        }
+        for(auto& entry: textures){
+            if(entry.resident && entry.fallback != NO_FALLBACK && isIdle(entry.lastUsedFrame) && entry.lastUsedFrame < oldest){
+                oldest = entry.lastUsedFrame;
+                model = nullptr;
+                texture = &entry;
+            }
+        }
+        VkDeviceSize bytes = 0;
+        if(texture != nullptr){
+            bytes = texture->data.bytes;
+            //sets of frames already submitted may still point at it, later frames rewrite theirs before recording
+            pendingReleases.push_back({std::move(texture->data.owner), timeline.getSubmittedValue()});
+            texture->data = {};
+            texture->resident = false;
+            textureVersion++;
+        }else if(model != nullptr){
+            bytes = model->handle->get()->getGeometryBytes();
+            modelLoader.evict(*model->handle);
+        }else{
+            return false;
+        }
+        stats.evictions++;
+        stats.evictedBytes += bytes;
+        stats.residentBytes -= bytes;
+        return true;
+    }
+
+    void VeResidencyManager::touchModel(const std::shared_ptr<VeModelHandle>& handle){
+        auto it = modelIndices.find(handle.get());
+        if(it == modelIndices.end()){
+            addModel(handle);
+            it = modelIndices.find(handle.get());
+        }
+        ModelEntry& model = models[it->second];
+        model.lastUsedFrame = frame;
+        switch(handle->getState()){
+            case VeModelHandle::State::READY:
+                stats.hits++;
+                break;
+            case VeModelHandle::State::EVICTED:
+                stats.misses++;
+                modelLoader.reload(handle);
+                break;
+            default:
+                break;
+        }
+    }
+    void VeResidencyManager::touchTexture(uint32_t index){
+        if(index >= textures.size()){
+            return;
+        }
+        TextureEntry& texture = textures[index];
+        texture.lastUsedFrame = frame;
+        if(texture.resident){
+            stats.hits++;
+        }else if(!texture.loading){
+            stats.misses++;
+            //decoded on this thread, the upload goes out with the next update()
+            loadTexture(texture);
+        }
+    }
+
+    const VkDescriptorImageInfo& VeResidencyManager::getImageInfo(uint32_t index) const{
+        const TextureEntry& texture = textures[index];
+        if(texture.resident || texture.fallback == NO_FALLBACK){
+            return texture.data.imageInfo;
+        }
+        return textures[texture.fallback].data.imageInfo;
+    }
+
+    void VeResidencyManager::report() const{
+        constexpr float MIB = 1024.0f * 1024.0f;
+        std::cout << "Residency: " << stats.residentBytes / MIB << " MiB resident";
+        if(stats.budget > 0){
+            std::cout << " of a " << stats.budget / MIB << " MiB budget";
+        }
+        std::cout << ", " << stats.residentModels << "/" << stats.models << " models and " << stats.residentTextures << "/" << stats.textures
+                  << " textures, " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions ("
+                  << stats.evictedBytes / MIB << " MiB)" << std::endl;
+    }
+}
@@ -1,6 +1,7 @@
 #include "ve_swap_chain.hpp"
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -11,8 +12,8 @@
 
 namespace ve {
 
-VeSwapChain::VeSwapChain(VeDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+VeSwapChain::VeSwapChain(VeDevice &deviceRef, VkExtent2D extent, int framesInFlight)
+    : device{deviceRef}, windowExtent{extent}, framesInFlight{framesInFlight} {
   createSwapChain();
   createImageViews();
   createRenderPass();
@@ -20,8 +21,8 @@ VeSwapChain::VeSwapChain(VeDevice &deviceRef, VkExtent2D extent)
   createFramebuffers();
   createSyncObjects();
 }
-VeSwapChain::VeSwapChain(VeDevice &deviceRef, VkExtent2D extent, std::shared_ptr<VeSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+VeSwapChain::VeSwapChain(VeDevice &deviceRef, VkExtent2D extent, int framesInFlight, std::shared_ptr<VeSwapChain> previous)
+    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous}, framesInFlight{framesInFlight} {
   init();
   //clean up old swap chain
 }
@@ -36,81 +37,61 @@ void VeSwapChain::init() {
 
 VeSwapChain::~VeSwapChain() {
   for (auto imageView : swapChainImageViews) {
-    vkDestroyImageView(device.device(), imageView, nullptr);
+    vkDestroyImageView(device.device(), imageView, device.allocationCallbacks());
   }
   swapChainImageViews.clear();
 
   if (swapChain != nullptr) {
-    vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
+    vkDestroySwapchainKHR(device.device(), swapChain, device.allocationCallbacks());
     swapChain = nullptr;
   }
 
   for (int i = 0; i < depthImages.size(); i++) {
-    vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+    vkDestroyImageView(device.device(), depthImageViews[i], device.allocationCallbacks());
+    vkDestroyImage(device.device(), depthImages[i], device.allocationCallbacks());
+    device.freeMemory(depthImageMemorys[i]);
   }
 
   for (auto framebuffer : swapChainFramebuffers) {
-    vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+    vkDestroyFramebuffer(device.device(), framebuffer, device.allocationCallbacks());
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  vkDestroyRenderPass(device.device(), renderPass, device.allocationCallbacks());
 
   // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+  for (int i = 0; i < framesInFlight; i++) {
+    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], device.allocationCallbacks());
+    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], device.allocationCallbacks());
   }
 }
 
-VkResult VeSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      device.device(),
-      1,
-      &inFlightFences[currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
-
+VkResult VeSwapChain::acquireNextImage(int frameIndex, uint32_t *imageIndex) {
+  VeHostAllocator::Label label{"vkAcquireNextImageKHR"};
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
       std::numeric_limits<uint64_t>::max(),
-      imageAvailableSemaphores[currentFrame],  // must be a not signaled semaphore
+      imageAvailableSemaphores[frameIndex],  // must be a not signaled semaphore
       VK_NULL_HANDLE,
       imageIndex);
 
   return result;
 }
 
-VkResult VeSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-  if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+VkResult VeSwapChain::submitCommandBuffers(int frameIndex, const VkCommandBuffer *buffers, uint32_t *imageIndex, uint32_t waitCount,
+                                           const VeTimeline::Wait *waits) {
+  if (waitCount > MAX_FRAME_WAITS) {
+    throw std::runtime_error("too many waits for one frame submission!");
   }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
-
-  VkSubmitInfo submitInfo = {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
-
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = buffers;
-
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+  // with more frames in flight than images an image can come back while its last frame still renders
+  VeTimeline &timeline = device.getGraphicsTimeline();
+  timeline.wait(imageValues[*imageIndex]);
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
+  std::array<VeTimeline::Wait, VeTimeline::MAX_WAITS> frameWaits{};
+  frameWaits[0] = {imageAvailableSemaphores[frameIndex], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  std::copy(waits, waits + waitCount, frameWaits.begin() + 1);
+  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[frameIndex]};
+  imageValues[*imageIndex] = timeline.submit(1, buffers, waitCount + 1, frameWaits.data(), 1, signalSemaphores);
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -124,11 +105,8 @@ VkResult VeSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint3
 
   presentInfo.pImageIndices = imageIndex;
 
-  auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
-
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
-  return result;
+  VeHostAllocator::Label label{"vkQueuePresentKHR"};
+  return vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 }
 
 void VeSwapChain::createSwapChain() {
@@ -138,7 +116,8 @@ void VeSwapChain::createSwapChain() {
   VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  // one image per frame in flight at least, so deeper pipelining is not throttled by acquire
+  uint32_t imageCount = std::max(swapChainSupport.capabilities.minImageCount + 1, static_cast<uint32_t>(framesInFlight));
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -176,7 +155,7 @@ void VeSwapChain::createSwapChain() {
 
   createInfo.oldSwapchain = oldSwapChain == nullptr ? VK_NULL_HANDLE : oldSwapChain->swapChain;
 
-  if (vkCreateSwapchainKHR(device.device(), &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+  if (vkCreateSwapchainKHR(device.device(), &createInfo, device.allocationCallbacks(), &swapChain) != VK_SUCCESS) {
     throw std::runtime_error("failed to create swap chain!");
   }
 
@@ -206,7 +185,7 @@ void VeSwapChain::createImageViews() {
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr, &swapChainImageViews[i]) !=
+    if (vkCreateImageView(device.device(), &viewInfo, device.allocationCallbacks(), &swapChainImageViews[i]) !=
         VK_SUCCESS) {
       throw std::runtime_error("failed to create texture image view!");
     }
@@ -267,7 +246,7 @@ void VeSwapChain::createRenderPass() {
   renderPassInfo.dependencyCount = 1;
   renderPassInfo.pDependencies = &dependency;
 
-  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, device.allocationCallbacks(), &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
 }
@@ -290,7 +269,7 @@ void VeSwapChain::createFramebuffers() {
     if (vkCreateFramebuffer(
             device.device(),
             &framebufferInfo,
-            nullptr,
+            device.allocationCallbacks(),
             &swapChainFramebuffers[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create framebuffer!");
     }
@@ -327,7 +306,8 @@ void VeSwapChain::createDepthResources() {
         imageInfo,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         depthImages[i],
-        depthImageMemorys[i]);
+        depthImageMemorys[i],
+        VeMemoryCategory::RENDER_TARGET);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -340,31 +320,25 @@ void VeSwapChain::createDepthResources() {
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
+    if (vkCreateImageView(device.device(), &viewInfo, device.allocationCallbacks(), &depthImageViews[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create texture image view!");
     }
   }
 }
 
 void VeSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  imageAvailableSemaphores.resize(framesInFlight);
+  renderFinishedSemaphores.resize(framesInFlight);
+  imageValues.resize(imageCount(), 0);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
+  for (int i = 0; i < framesInFlight; i++) {
+    if (vkCreateSemaphore(device.device(), &semaphoreInfo, device.allocationCallbacks(), &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+        vkCreateSemaphore(device.device(), &semaphoreInfo, device.allocationCallbacks(), &renderFinishedSemaphores[i]) !=
+            VK_SUCCESS) {
       throw std::runtime_error("failed to create synchronization objects for a frame!");
     }
   }
@@ -0,0 +1,425 @@
+#include "ve_tangent_generator.hpp"
+#include "ve_parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VE_TANGENT_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define VE_TANGENT_AVX 1
+#include <immintrin.h>
+#endif
+
+namespace ve{
+    namespace{
+        constexpr size_t MAX_WIDTH = 8;
+        //below this the accumulated tangent is treated as missing (no uvs, or uvs collapsed to a point)
+        constexpr float MIN_TANGENT_LENGTH = 1e-12f;
+
+        //one lane type per instruction set, the kernels below are written once against this interface
+        struct ScalarOps{
+            using Vec = float;
+            using Mask = bool;
+            static constexpr size_t WIDTH = 1;
+            static Vec load(const float* p){ return *p; }
+            static void store(float* p, Vec v){ *p = v; }
+            static Vec set(float v){ return v; }
+            static Vec add(Vec a, Vec b){ return a + b; }
+            static Vec sub(Vec a, Vec b){ return a - b; }
+            static Vec mul(Vec a, Vec b){ return a * b; }
+            static Vec div(Vec a, Vec b){ return a / b; }
+            static Vec sqrt(Vec a){ return std::sqrt(a); }
+            static Mask greater(Vec a, Vec b){ return a > b; }
+            static Mask less(Vec a, Vec b){ return a < b; }
+            static Vec select(Mask m, Vec a, Vec b){ return m ? a : b; }
+        };
+#ifdef VE_TANGENT_SSE
+        struct SseOps{
+            using Vec = __m128;
+            using Mask = __m128;
+            static constexpr size_t WIDTH = 4;
+            static Vec load(const float* p){ return _mm_loadu_ps(p); }
+            static void store(float* p, Vec v){ _mm_storeu_ps(p, v); }
+            static Vec set(float v){ return _mm_set1_ps(v); }
+            static Vec add(Vec a, Vec b){ return _mm_add_ps(a, b); }
+            static Vec sub(Vec a, Vec b){ return _mm_sub_ps(a, b); }
+            static Vec mul(Vec a, Vec b){ return _mm_mul_ps(a, b); }
+            static Vec div(Vec a, Vec b){ return _mm_div_ps(a, b); }
+            static Vec sqrt(Vec a){ return _mm_sqrt_ps(a); }
+            static Mask greater(Vec a, Vec b){ return _mm_cmpgt_ps(a, b); }
+            static Mask less(Vec a, Vec b){ return _mm_cmplt_ps(a, b); }
+            static Vec select(Mask m, Vec a, Vec b){ return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+        };
+#endif
+#ifdef VE_TANGENT_AVX
+        struct AvxOps{
+            using Vec = __m256;
+            using Mask = __m256;
+            static constexpr size_t WIDTH = 8;
+            static Vec load(const float* p){ return _mm256_loadu_ps(p); }
+            static void store(float* p, Vec v){ _mm256_storeu_ps(p, v); }
+            static Vec set(float v){ return _mm256_set1_ps(v); }
+            static Vec add(Vec a, Vec b){ return _mm256_add_ps(a, b); }
+            static Vec sub(Vec a, Vec b){ return _mm256_sub_ps(a, b); }
+            static Vec mul(Vec a, Vec b){ return _mm256_mul_ps(a, b); }
+            static Vec div(Vec a, Vec b){ return _mm256_div_ps(a, b); }
+            static Vec sqrt(Vec a){ return _mm256_sqrt_ps(a); }
+            static Mask greater(Vec a, Vec b){ return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+            static Mask less(Vec a, Vec b){ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static Vec select(Mask m, Vec a, Vec b){ return _mm256_blendv_ps(b, a, m); }
+        };
+#endif
+
+        //vertex attributes the generator reads, one array per component
+        struct VertexStreams{
+            std::vector<float> px, py, pz;
+            std::vector<float> u, v;
+            std::vector<float> nx, ny, nz;
+        };
+        //per-triangle uv derivatives on the way in, per-vertex sums (then the finished frame) on the way out
+        struct Frames{
+            std::vector<float> tx, ty, tz;
+            std::vector<float> bx, by, bz;
+            std::vector<float> w;
+            void resize(size_t count){
+                for(auto* component: {&tx, &ty, &tz, &bx, &by, &bz, &w}){
+                    component->resize(count);
+                }
+            }
+        };
+
+        //dP/du and dP/dv of WIDTH triangles starting at first, scaled by the triangle's signed uv area instead of divided by it,
+        //so slivers in uv space cannot dominate a vertex and degenerate uvs contribute nothing
+        template<typename Ops>
+        void triangleBlock(const std::vector<uint32_t>& indices, const VertexStreams& in, Frames& out, size_t first){
+            using Vec = typename Ops::Vec;
+            alignas(32) float corners[15][MAX_WIDTH];
+            for(size_t lane = 0; lane < Ops::WIDTH; lane++){
+                const uint32_t* triangle = &indices[(first + lane) * 3];
+                for(int corner = 0; corner < 3; corner++){
+                    uint32_t vertex = triangle[corner];
+                    corners[corner * 3][lane] = in.px[vertex];
+                    corners[corner * 3 + 1][lane] = in.py[vertex];
+                    corners[corner * 3 + 2][lane] = in.pz[vertex];
+                    corners[9 + corner * 2][lane] = in.u[vertex];
+                    corners[10 + corner * 2][lane] = in.v[vertex];
+                }
+            }
+            Vec e1[3], e2[3];
+            for(int axis = 0; axis < 3; axis++){
+                Vec p0 = Ops::load(corners[axis]);
+                e1[axis] = Ops::sub(Ops::load(corners[3 + axis]), p0);
+                e2[axis] = Ops::sub(Ops::load(corners[6 + axis]), p0);
+            }
+            Vec u0 = Ops::load(corners[9]);
+            Vec v0 = Ops::load(corners[10]);
+            Vec du1 = Ops::sub(Ops::load(corners[11]), u0);
+            Vec dv1 = Ops::sub(Ops::load(corners[12]), v0);
+            Vec du2 = Ops::sub(Ops::load(corners[13]), u0);
+            Vec dv2 = Ops::sub(Ops::load(corners[14]), v0);
+            Vec det = Ops::sub(Ops::mul(du1, dv2), Ops::mul(du2, dv1));
+            Vec zero = Ops::set(0.0f);
+            Vec sign = Ops::select(Ops::greater(det, zero), Ops::set(1.0f), Ops::select(Ops::less(det, zero), Ops::set(-1.0f), zero));
+            float* tangent[3] = {&out.tx[first], &out.ty[first], &out.tz[first]};
+            float* bitangent[3] = {&out.bx[first], &out.by[first], &out.bz[first]};
+            for(int axis = 0; axis < 3; axis++){
+                Ops::store(tangent[axis], Ops::mul(Ops::sub(Ops::mul(e1[axis], dv2), Ops::mul(e2[axis], dv1)), sign));
+                Ops::store(bitangent[axis], Ops::mul(Ops::sub(Ops::mul(e2[axis], du1), Ops::mul(e1[axis], du2)), sign));
+            }
+        }
+        //Gram-Schmidt against the normal and the handedness of WIDTH vertices, in place
+        //tangents that vanish are left at zero and replaced by fallbackTangent afterwards
+        template<typename Ops>
+        void vertexBlock(const VertexStreams& in, Frames& frames, size_t first){
+            using Vec = typename Ops::Vec;
+            Vec n[3] = {Ops::load(&in.nx[first]), Ops::load(&in.ny[first]), Ops::load(&in.nz[first])};
+            Vec t[3] = {Ops::load(&frames.tx[first]), Ops::load(&frames.ty[first]), Ops::load(&frames.tz[first])};
+            Vec b[3] = {Ops::load(&frames.bx[first]), Ops::load(&frames.by[first]), Ops::load(&frames.bz[first])};
+            Vec zero = Ops::set(0.0f);
+            Vec nn = Ops::add(Ops::add(Ops::mul(n[0], n[0]), Ops::mul(n[1], n[1])), Ops::mul(n[2], n[2]));
+            Vec nt = Ops::add(Ops::add(Ops::mul(n[0], t[0]), Ops::mul(n[1], t[1])), Ops::mul(n[2], t[2]));
+            //normals are not guaranteed to be unit length, so project with n.t / n.n
+            Vec k = Ops::select(Ops::greater(nn, zero), Ops::div(nt, nn), zero);
+            for(int axis = 0; axis < 3; axis++){
+                t[axis] = Ops::sub(t[axis], Ops::mul(n[axis], k));
+            }
+            Vec length = Ops::sqrt(Ops::add(Ops::add(Ops::mul(t[0], t[0]), Ops::mul(t[1], t[1])), Ops::mul(t[2], t[2])));
+            auto valid = Ops::greater(length, Ops::set(MIN_TANGENT_LENGTH));
+            for(int axis = 0; axis < 3; axis++){
+                t[axis] = Ops::select(valid, Ops::div(t[axis], length), zero);
+            }
+            //cross(n, t) points along the bitangent of a right handed frame
+            Vec cx = Ops::sub(Ops::mul(n[1], t[2]), Ops::mul(n[2], t[1]));
+            Vec cy = Ops::sub(Ops::mul(n[2], t[0]), Ops::mul(n[0], t[2]));
+            Vec cz = Ops::sub(Ops::mul(n[0], t[1]), Ops::mul(n[1], t[0]));
+            Vec side = Ops::add(Ops::add(Ops::mul(cx, b[0]), Ops::mul(cy, b[1])), Ops::mul(cz, b[2]));
+            Ops::store(&frames.tx[first], t[0]);
+            Ops::store(&frames.ty[first], t[1]);
+            Ops::store(&frames.tz[first], t[2]);
+            Ops::store(&frames.w[first], Ops::select(Ops::less(side, zero), Ops::set(-1.0f), Ops::set(1.0f)));
+        }
+
+        //full SIMD blocks first, the remainder one lane at a time
+        template<typename Ops>
+        void triangleRange(const std::vector<uint32_t>& indices, const VertexStreams& in, Frames& out, size_t begin, size_t end){
+            size_t triangle = begin;
+            for(; triangle + Ops::WIDTH <= end; triangle += Ops::WIDTH){
+                triangleBlock<Ops>(indices, in, out, triangle);
+            }
+            for(; triangle < end; triangle++){
+                triangleBlock<ScalarOps>(indices, in, out, triangle);
+            }
+        }
+        template<typename Ops>
+        void vertexRange(const VertexStreams& in, Frames& frames, size_t begin, size_t end){
+            size_t vertex = begin;
+            for(; vertex + Ops::WIDTH <= end; vertex += Ops::WIDTH){
+                vertexBlock<Ops>(in, frames, vertex);
+            }
+            for(; vertex < end; vertex++){
+                vertexBlock<ScalarOps>(in, frames, vertex);
+            }
+        }
+        void dispatchTriangles(VeTangentGenerator::Kernel kernel, const std::vector<uint32_t>& indices, const VertexStreams& in, Frames& out,
+                               size_t begin, size_t end){
+            switch(kernel){
+#ifdef VE_TANGENT_AVX
+                case VeTangentGenerator::Kernel::AVX: triangleRange<AvxOps>(indices, in, out, begin, end); return;
+#endif
+#ifdef VE_TANGENT_SSE
+                case VeTangentGenerator::Kernel::SSE: triangleRange<SseOps>(indices, in, out, begin, end); return;
+#endif
+                default: triangleRange<ScalarOps>(indices, in, out, begin, end); return;
+            }
+        }
+        void dispatchVertices(VeTangentGenerator::Kernel kernel, const VertexStreams& in, Frames& frames, size_t begin, size_t end){
+            switch(kernel){
+#ifdef VE_TANGENT_AVX
+                case VeTangentGenerator::Kernel::AVX: vertexRange<AvxOps>(in, frames, begin, end); return;
+#endif
+#ifdef VE_TANGENT_SSE
+                case VeTangentGenerator::Kernel::SSE: vertexRange<SseOps>(in, frames, begin, end); return;
+#endif
+                default: vertexRange<ScalarOps>(in, frames, begin, end); return;
+            }
+        }
+
+        //any unit vector perpendicular to the normal, for vertices whose uvs give no direction
+        glm::vec3 fallbackTangent(const glm::vec3& normal){
+            glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::vec3 tangent = glm::cross(normal, axis);
+            float length = glm::length(tangent);
+            return length > 0.0f ? tangent / length : glm::vec3(1.0f, 0.0f, 0.0f);
+        }
+
+        std::vector<ParallelRange> kernelRanges(size_t count, bool multithreaded){
+            if(!multithreaded){
+                return count ? std::vector<ParallelRange>{{0, count}} : std::vector<ParallelRange>{};
+            }
+            //whole SIMD blocks per thread, so only the last range has a scalar tail
+            return splitRanges(count, MAX_WIDTH);
+        }
+
+        //the previous per-triangle overwrite, kept only as the benchmark baseline
+        void legacyTangents(const std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices){
+            for(size_t i = 0; i + 2 < indices.size(); i += 3){
+                glm::vec3 edge1 = vertices[indices[i + 1]].position - vertices[indices[i]].position;
+                glm::vec3 edge2 = vertices[indices[i + 2]].position - vertices[indices[i]].position;
+                glm::vec2 deltaUV1 = vertices[indices[i + 1]].uv - vertices[indices[i]].uv;
+                glm::vec2 deltaUV2 = vertices[indices[i + 2]].uv - vertices[indices[i]].uv;
+                float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+                if(std::isfinite(f)){
+                    glm::vec4 tangent{f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x), f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y),
+                                      f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z), 1.0f};
+                    vertices[indices[i]].tangent = tangent;
+                    vertices[indices[i + 1]].tangent = tangent;
+                    vertices[indices[i + 2]].tangent = tangent;
+                }
+            }
+        }
+    }
+
+    VeTangentGenerator::Kernel VeTangentGenerator::bestKernel(){
+#if defined(VE_TANGENT_AVX)
+        return Kernel::AVX;
+#elif defined(VE_TANGENT_SSE)
+        return Kernel::SSE;
+#else
+        return Kernel::SCALAR;
+#endif
+    }
+    bool VeTangentGenerator::isKernelAvailable(Kernel kernel){
+        return static_cast<int>(kernel) <= static_cast<int>(bestKernel());
+    }
+    const char* VeTangentGenerator::getKernelName(Kernel kernel){
+        switch(kernel){
+            case Kernel::SSE: return "sse";
+            case Kernel::AVX: return "avx";
+            default: return "scalar";
+        }
+    }
+
+    void VeTangentGenerator::generate(const std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices){
+        generate(indices, vertices, bestKernel(), true);
+    }
+    void VeTangentGenerator::generate(const std::vector<uint32_t>& indices, std::vector<VeModel::Vertex>& vertices, Kernel kernel, bool multithreaded){
+        size_t vertexCount = vertices.size();
+        size_t triangleCount = indices.size() / 3;
+        if(vertexCount == 0){
+            return;
+        }
+        if(!isKernelAvailable(kernel)){
+            kernel = bestKernel();
+        }
+        std::vector<ParallelRange> vertexRanges = kernelRanges(vertexCount, multithreaded);
+        std::vector<ParallelRange> triangleRanges = kernelRanges(triangleCount, multithreaded);
+
+        VertexStreams streams{};
+        for(auto* component: {&streams.px, &streams.py, &streams.pz, &streams.u, &streams.v, &streams.nx, &streams.ny, &streams.nz}){
+            component->resize(vertexCount);
+        }
+        parallelFor(vertexRanges, [&](size_t, const ParallelRange& range){
+            for(size_t i = range.begin; i < range.end; i++){
+                const VeModel::Vertex& vertex = vertices[i];
+                streams.px[i] = vertex.position.x;
+                streams.py[i] = vertex.position.y;
+                streams.pz[i] = vertex.position.z;
+                streams.u[i] = vertex.uv.x;
+                streams.v[i] = vertex.uv.y;
+                streams.nx[i] = vertex.normal.x;
+                streams.ny[i] = vertex.normal.y;
+                streams.nz[i] = vertex.normal.z;
+            }
+        });
+
+        Frames triangleFrames{};
+        triangleFrames.resize(triangleCount);
+        parallelFor(triangleRanges, [&](size_t, const ParallelRange& range){
+            dispatchTriangles(kernel, indices, streams, triangleFrames, range.begin, range.end);
+        });
+
+        //vertex -> triangle adjacency, every vertex sums its triangles in index order whichever thread it lands on
+        std::vector<uint32_t> firstCorner(vertexCount + 1, 0);
+        for(size_t i = 0; i < triangleCount * 3; i++){
+            firstCorner[indices[i] + 1]++;
+        }
+        for(size_t i = 0; i < vertexCount; i++){
+            firstCorner[i + 1] += firstCorner[i];
+        }
+        std::vector<uint32_t> cornerTriangles(triangleCount * 3);
+        std::vector<uint32_t> cursor(firstCorner.begin(), firstCorner.end() - 1);
+        for(size_t i = 0; i < triangleCount * 3; i++){
+            cornerTriangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        Frames vertexFrames{};
+        vertexFrames.resize(vertexCount);
+        parallelFor(vertexRanges, [&](size_t, const ParallelRange& range){
+            for(size_t vertex = range.begin; vertex < range.end; vertex++){
+                float sums[6] = {};
+                for(uint32_t corner = firstCorner[vertex]; corner < firstCorner[vertex + 1]; corner++){
+                    uint32_t triangle = cornerTriangles[corner];
+                    sums[0] += triangleFrames.tx[triangle];
+                    sums[1] += triangleFrames.ty[triangle];
+                    sums[2] += triangleFrames.tz[triangle];
+                    sums[3] += triangleFrames.bx[triangle];
+                    sums[4] += triangleFrames.by[triangle];
+                    sums[5] += triangleFrames.bz[triangle];
+                }
+                vertexFrames.tx[vertex] = sums[0];
+                vertexFrames.ty[vertex] = sums[1];
+                vertexFrames.tz[vertex] = sums[2];
+                vertexFrames.bx[vertex] = sums[3];
+                vertexFrames.by[vertex] = sums[4];
+                vertexFrames.bz[vertex] = sums[5];
+            }
+            dispatchVertices(kernel, streams, vertexFrames, range.begin, range.end);
+            for(size_t vertex = range.begin; vertex < range.end; vertex++){
+                glm::vec3 tangent{vertexFrames.tx[vertex], vertexFrames.ty[vertex], vertexFrames.tz[vertex]};
+                if(tangent == glm::vec3(0.0f)){
+                    tangent = fallbackTangent(vertices[vertex].normal);
+                }
+                vertices[vertex].tangent = glm::vec4(tangent, vertexFrames.w[vertex]);
+            }
+        });
+    }
+
+    void VeTangentGenerator::benchmark(size_t triangleCount){
+        //wavy height field, uvs mirrored at the middle column so half the vertices come out left handed
+        size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(static_cast<double>(triangleCount) / 2.0)));
+        std::vector<VeModel::Vertex> vertices((side + 1) * (side + 1));
+        for(size_t z = 0; z <= side; z++){
+            for(size_t x = 0; x <= side; x++){
+                VeModel::Vertex& vertex = vertices[z * (side + 1) + x];
+                float fx = static_cast<float>(x);
+                float fz = static_cast<float>(z);
+                vertex.position = {fx, std::sin(fx * 0.1f) * std::cos(fz * 0.1f) * 2.0f, fz};
+                glm::vec3 normal{-0.2f * std::cos(fx * 0.1f) * std::cos(fz * 0.1f), 1.0f, 0.2f * std::sin(fx * 0.1f) * std::sin(fz * 0.1f)};
+                vertex.normal = glm::normalize(normal);
+                vertex.color = {1.0f, 1.0f, 1.0f};
+                vertex.uv = {std::abs(fx - static_cast<float>(side) * 0.5f) / static_cast<float>(side), fz / static_cast<float>(side)};
+                vertex.jointWeights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+            }
+        }
+        std::vector<uint32_t> indices;
+        indices.reserve(side * side * 6);
+        for(size_t z = 0; z < side; z++){
+            for(size_t x = 0; x < side; x++){
+                uint32_t corner = static_cast<uint32_t>(z * (side + 1) + x);
+                uint32_t row = static_cast<uint32_t>(side + 1);
+                for(uint32_t index: {corner, corner + row, corner + 1, corner + 1, corner + row, corner + row + 1}){
+                    indices.push_back(index);
+                }
+            }
+        }
+        size_t triangles = indices.size() / 3;
+        using Clock = std::chrono::high_resolution_clock;
+        auto millisecondsSince = [](Clock::time_point start){
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+        std::cout << "Tangent benchmark: " << triangles << " triangles, " << vertices.size() << " vertices, "
+                  << workerThreadCount() << " threads" << std::endl;
+        auto print = [triangles](const char* name, double milliseconds){
+            std::cout << "  " << name << ": " << milliseconds << " ms, " << static_cast<double>(triangles) / milliseconds * 1e-3 << " Mtriangles/s";
+        };
+
+        auto legacyStart = Clock::now();
+        legacyTangents(indices, vertices);
+        print("legacy per-triangle overwrite (1 thread)", millisecondsSince(legacyStart));
+        std::cout << std::endl;
+
+        std::vector<VeModel::Vertex> reference = vertices;
+        generate(indices, reference, Kernel::SCALAR, false);
+        size_t leftHanded = 0;
+        for(const auto& vertex: reference){
+            leftHanded += vertex.tangent.w < 0.0f ? 1 : 0;
+        }
+        for(Kernel kernel: {Kernel::SCALAR, Kernel::SSE, Kernel::AVX}){
+            if(!isKernelAvailable(kernel)){
+                continue;
+            }
+            for(bool multithreaded: {false, true}){
+                std::vector<VeModel::Vertex> result = vertices;
+                auto start = Clock::now();
+                generate(indices, result, kernel, multithreaded);
+                double milliseconds = millisecondsSince(start);
+                float maxDifference = 0.0f;
+                for(size_t i = 0; i < result.size(); i++){
+                    for(int component = 0; component < 4; component++){
+                        maxDifference = std::max(maxDifference, std::abs(result[i].tangent[component] - reference[i].tangent[component]));
+                    }
+                }
+                std::string name = std::string(getKernelName(kernel)) + (multithreaded ? " (threaded)" : " (1 thread)");
+                print(name.c_str(), milliseconds);
+                std::cout << ", max difference to scalar " << maxDifference << std::endl;
+            }
+        }
+        std::cout << "  " << leftHanded << " of " << reference.size() << " vertices left handed" << std::endl;
+    }
+}
@@ -7,17 +7,17 @@
 #include <stdexcept>
 #include <cmath>
 namespace ve{
-    VeTexture::VeTexture(VeDevice& device, const std::string& albedoPath): veDevice{device} {
+    VeTexture::VeTexture(VeDevice& device, VeUploadContext& uploadContext, const std::string& albedoPath): veDevice{device} {
         VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
-        createTextureImage(textureFormat, albedoPath);
+        createTextureImage(uploadContext, textureFormat, albedoPath);
     }
     VeTexture::~VeTexture(){
-        vkDestroySampler(veDevice.device(), textureSampler, nullptr);
-        vkDestroyImageView(veDevice.device(), textureImageView, nullptr);
-        vkDestroyImage(veDevice.device(), textureImage, nullptr);
-        vkFreeMemory(veDevice.device(), textureImageMemory, nullptr);
+        vkDestroySampler(veDevice.device(), textureSampler, veDevice.allocationCallbacks());
+        vkDestroyImageView(veDevice.device(), textureImageView, veDevice.allocationCallbacks());
+        vkDestroyImage(veDevice.device(), textureImage, veDevice.allocationCallbacks());
+        veDevice.freeMemory(textureImageMemory);
     }
-    void VeTexture::createTextureImage(VkFormat textureFormat, const std::string& path){
+    void VeTexture::createTextureImage(VeUploadContext& uploadContext, VkFormat textureFormat, const std::string& path){
         int texWidth, texHeight, texChannels;
         std::string fullPath = std::string(ENGINE_DIR) + path;
         stbi_uc* pixels = stbi_load(fullPath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -25,10 +25,7 @@ namespace ve{
         if(!pixels){
             throw std::runtime_error("failed to load texture image!");
         }
-        VkDeviceSize imageSize = texWidth * texHeight;
-        VeBuffer stagingBuffer{veDevice, 4, static_cast<uint32_t>(imageSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(pixels);
+        VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
         
         //create image info
         VkImageCreateInfo imageInfo{};
@@ -46,11 +43,12 @@ namespace ve{
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         //create image
-        veDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        veDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, VeMemoryCategory::TEXTURE);
         //copy buffer to image
-        transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ,mipLevels);
-        veDevice.copyBufferToImage(stagingBuffer.getBuffer(), textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1);
-        generateMipMaps(mipLevels, texWidth, texHeight, textureFormat);
+        uploadContext.transitionImageLayout(textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+        uploadContext.uploadImage(pixels, imageSize, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+        stbi_image_free(pixels);
+        uploadContext.generateMipMaps(textureImage, textureFormat, texWidth, texHeight, mipLevels);
         //create image sampler
         textureLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         VkSamplerCreateInfo samplerInfo{};
@@ -68,7 +66,7 @@ namespace ve{
         samplerInfo.minLod = 0.0f;
         samplerInfo.maxLod = 1000;
         samplerInfo.mipLodBias = 0.0f;
-        if(vkCreateSampler(veDevice.device(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS){
+        if(vkCreateSampler(veDevice.device(), &samplerInfo, veDevice.allocationCallbacks(), &textureSampler) != VK_SUCCESS){
             throw std::runtime_error("failed to create texture sampler!");
         }
         //create Image View
@@ -87,133 +85,8 @@ namespace ve{
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
 
-        if(vkCreateImageView(veDevice.device(), &viewInfo, nullptr, &textureImageView) != VK_SUCCESS){
+        if(vkCreateImageView(veDevice.device(), &viewInfo, veDevice.allocationCallbacks(), &textureImageView) != VK_SUCCESS){
             throw std::runtime_error("failed to create texture image view!");
         }
-        stbi_image_free(pixels);
-    }
-    void VeTexture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout, int mipLevels){
-        VkCommandBuffer commandBuffer = veDevice.beginSingleTimeCommands();
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = textureImage;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = mipLevels;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-        if(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL){
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        }else if(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL){
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        }else{
-            throw std::invalid_argument("unsupported layout transition!");
-        }
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            sourceStage, destinationStage,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier
-        );
-        veDevice.endSingleTimeCommands(commandBuffer);
-    }
-    void VeTexture::generateMipMaps(int mipLevels, int texWidth, int texHeight, VkFormat textureFormat){
-        VkFormatProperties formatProperties;
-        vkGetPhysicalDeviceFormatProperties(veDevice.getPhysicalDevice( ), textureFormat, &formatProperties);
-        if(!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)){
-            throw std::runtime_error("texture image format does not support linear blitting!");
-        }
-        VkCommandBuffer commandBuffer = veDevice.beginSingleTimeCommands();
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = textureImage;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        int32_t mipWidth = texWidth;
-        int32_t mipHeight = texHeight;
-        for(int i = 1; i<mipLevels;i++){
-            barrier.subresourceRange.baseMipLevel = i -1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            vkCmdPipelineBarrier(
-                commandBuffer,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier
-            );
-            
-            VkImageBlit blit{};
-            blit.srcOffsets[0] = {0, 0, 0};
-            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i -1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-            blit.dstOffsets[0] = {0, 0, 0};
-            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i   ;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-            vkCmdBlitImage(
-                commandBuffer,
-                textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1,
-                &blit,
-                VK_FILTER_LINEAR
-            );
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            vkCmdPipelineBarrier(
-                commandBuffer,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier
-            );
-            if(mipWidth > 1) mipWidth /= 2;
-            if(mipHeight > 1) mipHeight /= 2;
-        }
-        barrier.subresourceRange.baseMipLevel = mipLevels-1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier
-        );
-        veDevice.endSingleTimeCommands(commandBuffer);
     }
 }
\ No newline at end of file
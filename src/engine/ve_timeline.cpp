@@ -0,0 +1,102 @@
+#include "ve_timeline.hpp"
+#include "ve_host_allocator.hpp"
+
+#include <array>
+#include <chrono>
+#include <stdexcept>
+
+namespace ve{
+    VeTimeline::VeTimeline(VkDevice device, const VkAllocationCallbacks* allocationCallbacks, VkQueue queue):
+        device{device}, allocationCallbacks{allocationCallbacks}, queue{queue}{
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+        if(vkCreateSemaphore(device, &semaphoreInfo, allocationCallbacks, &semaphore) != VK_SUCCESS){
+            throw std::runtime_error("failed to create timeline semaphore!");
+        }
+    }
+    VeTimeline::~VeTimeline(){
+        vkDestroySemaphore(device, semaphore, allocationCallbacks);
+    }
+
+    uint64_t VeTimeline::submit(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers, uint32_t waitCount, const Wait* waits,
+                                uint32_t binarySignalCount, const VkSemaphore* binarySignals){
+        if(waitCount > MAX_WAITS || binarySignalCount > MAX_SIGNALS){
+            throw std::runtime_error("too many semaphores for one timeline submission!");
+        }
+        std::array<VkSemaphore, MAX_WAITS> waitSemaphores{};
+        std::array<uint64_t, MAX_WAITS> waitValues{};
+        std::array<VkPipelineStageFlags, MAX_WAITS> waitStages{};
+        for(uint32_t i = 0; i < waitCount; i++){
+            waitSemaphores[i] = waits[i].semaphore;
+            waitValues[i] = waits[i].value;
+            waitStages[i] = waits[i].stage;
+        }
+        //the timeline goes last, binary signals ignore their value
+        std::array<VkSemaphore, MAX_SIGNALS + 1> signalSemaphores{};
+        std::array<uint64_t, MAX_SIGNALS + 1> signalValues{};
+        for(uint32_t i = 0; i < binarySignalCount; i++){
+            signalSemaphores[i] = binarySignals[i];
+        }
+        uint64_t value = submitted + 1;
+        signalSemaphores[binarySignalCount] = semaphore;
+        signalValues[binarySignalCount] = value;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = waitCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = binarySignalCount + 1;
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = waitCount;
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = commandBufferCount;
+        submitInfo.pCommandBuffers = commandBuffers;
+        submitInfo.signalSemaphoreCount = binarySignalCount + 1;
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+        VeHostAllocator::Label label{"vkQueueSubmit"};
+        if(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS){
+            throw std::runtime_error("failed to submit to timeline!");
+        }
+        submitted = value;
+        stats.submissions++;
+        return value;
+    }
+
+    uint64_t VeTimeline::getCompletedValue(){
+        if(completed < submitted){
+            uint64_t value = completed;
+            vkGetSemaphoreCounterValue(device, semaphore, &value);
+            completed = value;
+        }
+        return completed;
+    }
+    bool VeTimeline::isComplete(uint64_t value){
+        return value <= completed || value <= getCompletedValue();
+    }
+    void VeTimeline::wait(uint64_t value){
+        if(isComplete(value)){
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore;
+        waitInfo.pValues = &value;
+        if(vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS){
+            throw std::runtime_error("failed to wait for timeline semaphore!");
+        }
+        completed = value;
+        stats.waits++;
+        stats.waitMilliseconds += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
@@ -0,0 +1,355 @@
+#include "ve_upload_context.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace ve{
+    VeUploadContext::VeUploadContext(VeDevice& device): veDevice{device}, dedicatedTransfer{device.hasDedicatedTransferQueue()}{
+        if(device.hasDedicatedTransferQueue()){
+            transferTimeline = std::make_unique<VeTimeline>(device.device(), device.allocationCallbacks(), device.transferQueue());
+        }
+        //buffer to image copies need offsets that are a multiple of 4 and of the texel size, 16 covers every format used here
+        stagingAlignment = std::max<VkDeviceSize>(16, device.properties.limits.optimalBufferCopyOffsetAlignment);
+    }
+    VeUploadContext::~VeUploadContext(){
+        //the gpu may still be reading staging buffers or writing the destinations
+        flush();
+    }
+
+    VkCommandBuffer VeUploadContext::beginCommands(VkCommandPool pool){
+        VeHostAllocator::Label label{"upload command buffers"};
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        if(vkAllocateCommandBuffers(veDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS){
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+    VkCommandBuffer VeUploadContext::recordTransfer(){
+        if(transferCommands == VK_NULL_HANDLE){
+            transferCommands = beginCommands(veDevice.getTransferCommandPool());
+        }
+        return transferCommands;
+    }
+    VkCommandBuffer VeUploadContext::recordGraphics(){
+        if(!dedicatedTransfer){
+            return recordTransfer();
+        }
+        if(graphicsCommands == VK_NULL_HANDLE){
+            graphicsCommands = beginCommands(veDevice.getCommandPool());
+        }
+        return graphicsCommands;
+    }
+    std::unique_ptr<VeBuffer> VeUploadContext::acquireChunk(VkDeviceSize size){
+        VkDeviceSize chunkSize = STAGING_CHUNK_BYTES;
+        while(chunkSize < size){
+            chunkSize *= 2;
+        }
+        auto freeList = freeChunks.find(chunkSize);
+        if(freeList != freeChunks.end() && !freeList->second.empty()){
+            std::unique_ptr<VeBuffer> chunk = std::move(freeList->second.back());
+            freeList->second.pop_back();
+            freeChunkBytes -= chunkSize;
+            stats.stagingReuses++;
+            return chunk;
+        }
+        auto chunk = std::make_unique<VeBuffer>(veDevice, chunkSize, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if(chunk->map() != VK_SUCCESS){
+            throw std::runtime_error("failed to map staging buffer!");
+        }
+        stats.stagingAllocations++;
+        return chunk;
+    }
+    void VeUploadContext::releaseChunk(std::unique_ptr<VeBuffer> chunk){
+        VkDeviceSize chunkSize = chunk->getBufferSize();
+        //a one off huge upload should not pin its staging memory forever
+        if(freeChunkBytes + chunkSize > STAGING_POOL_BYTES){
+            return;
+        }
+        freeChunkBytes += chunkSize;
+        freeChunks[chunkSize].push_back(std::move(chunk));
+    }
+    VkBuffer VeUploadContext::stage(const void* data, VkDeviceSize size, VkDeviceSize& srcOffset){
+        srcOffset = (chunkCursor + stagingAlignment - 1) & ~(stagingAlignment - 1);
+        if(stagingChunks.empty() || srcOffset + size > stagingChunks.back()->getBufferSize()){
+            stagingChunks.push_back(acquireChunk(size));
+            srcOffset = 0;
+        }
+        VeBuffer& chunk = *stagingChunks.back();
+        chunk.writeToBuffer(const_cast<void*>(data), size, srcOffset);
+        chunkCursor = srcOffset + size;
+        stats.stagedBytes += size;
+        return chunk.getBuffer();
+    }
+    void VeUploadContext::recorded(){
+        stats.commands++;
+        if(synchronous){
+            flush();
+        }
+    }
+
+    void VeUploadContext::uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset){
+        VkBufferCopy copyRegion{};
+        VkBuffer stagingBuffer = stage(data, size, copyRegion.srcOffset);
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(recordTransfer(), stagingBuffer, dstBuffer, 1, &copyRegion);
+        bufferWrites = true;
+        if(dedicatedTransfer){
+            VkBufferMemoryBarrier release{};
+            release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.srcQueueFamilyIndex = veDevice.transferQueueFamilyIndex();
+            release.dstQueueFamilyIndex = veDevice.graphicsQueueFamilyIndex();
+            release.buffer = dstBuffer;
+            release.offset = dstOffset;
+            release.size = size;
+            bufferReleases.push_back(release);
+        }
+        recorded();
+    }
+    void VeUploadContext::uploadImage(const void* data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount){
+        VkBufferImageCopy region{};
+        VkBuffer stagingBuffer = stage(data, size, region.bufferOffset);
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = layerCount;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {width, height, 1};
+        vkCmdCopyBufferToImage(recordTransfer(), stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        recorded();
+    }
+    void VeUploadContext::handOver(VkImage image, VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess){
+        auto owned = transferImages.find(image);
+        //both halves carry the same layouts, the transition happens once between them
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = veDevice.transferQueueFamilyIndex();
+        barrier.dstQueueFamilyIndex = veDevice.graphicsQueueFamilyIndex();
+        barrier.image = image;
+        barrier.subresourceRange = owned->second;
+        //release, the destination scope is ignored on the transfer queue
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(recordTransfer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        //acquire, the semaphore between the two submissions makes the writes available
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(recordGraphics(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        transferImages.erase(owned);
+    }
+    void VeUploadContext::transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount){
+        if(dedicatedTransfer && oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && transferImages.count(image) > 0){
+            //the copy ran on the transfer queue, the graphics family has to take the image over before sampling it
+            handOver(image, newLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            recorded();
+            return;
+        }
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = layerCount;
+        VkPipelineStageFlags sourceStage;
+        VkPipelineStageFlags destinationStage;
+        if(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL){
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }else if(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL){
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        }else{
+            throw std::invalid_argument("unsupported layout transition!");
+        }
+        //images are filled on the transfer queue, anything else stays on graphics
+        bool filled = newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        vkCmdPipelineBarrier(filled ? recordTransfer() : recordGraphics(), sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        if(filled && dedicatedTransfer){
+            transferImages[image] = barrier.subresourceRange;
+        }
+        recorded();
+    }
+    void VeUploadContext::generateMipMaps(VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mipLevels, uint32_t layerCount){
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(veDevice.getPhysicalDevice(), format, &formatProperties);
+        if(!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)){
+            throw std::runtime_error("texture image format does not support linear blitting!");
+        }
+        //blits need a graphics queue
+        if(dedicatedTransfer && transferImages.count(image) > 0){
+            handOver(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        }
+        VkCommandBuffer commandBuffer = recordGraphics();
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = layerCount;
+        int32_t mipWidth = width;
+        int32_t mipHeight = height;
+        for(uint32_t i = 1; i < mipLevels; i++){
+            //level i - 1 was just written, make it the blit source
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = i - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = layerCount;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = i;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = layerCount;
+            vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            if(mipWidth > 1) mipWidth /= 2;
+            if(mipHeight > 1) mipHeight /= 2;
+        }
+        //the last level is never a blit source
+        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        recorded();
+    }
+
+    VeUploadContext::Ticket VeUploadContext::submit(){
+        if(!hasRecordedCommands()){
+            return lastSubmitted;
+        }
+        VeHostAllocator::Label label{"upload submit"};
+        //images nobody transitioned for sampling still have to change hands
+        while(!transferImages.empty()){
+            handOver(transferImages.begin()->first, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        }
+        //later frames read the buffers as vertex, index or uniform data
+        VkPipelineStageFlags bufferReadStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        VkAccessFlags bufferReadAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        if(!bufferReleases.empty()){
+            vkCmdPipelineBarrier(recordTransfer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                 0, nullptr, static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(), 0, nullptr);
+            for(auto& acquire: bufferReleases){
+                acquire.srcAccessMask = 0;
+                acquire.dstAccessMask = bufferReadAccess;
+            }
+            vkCmdPipelineBarrier(recordGraphics(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, bufferReadStages, 0,
+                                 0, nullptr, static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(), 0, nullptr);
+        }else if(bufferWrites){
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = bufferReadAccess;
+            vkCmdPipelineBarrier(recordGraphics(), VK_PIPELINE_STAGE_TRANSFER_BIT, bufferReadStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+        Batch batch{};
+        batch.transferCommands = transferCommands;
+        batch.graphicsCommands = graphicsCommands;
+        batch.stagingChunks = std::move(stagingChunks);
+        for(VkCommandBuffer commandBuffer: {transferCommands, graphicsCommands}){
+            if(commandBuffer != VK_NULL_HANDLE && vkEndCommandBuffer(commandBuffer) != VK_SUCCESS){
+                throw std::runtime_error("failed to record upload command buffer!");
+            }
+        }
+        //every batch ends on the graphics timeline, copies on the transfer queue are waited for there through their own timeline
+        VeTimeline& graphicsTimeline = veDevice.getGraphicsTimeline();
+        if(transferCommands != VK_NULL_HANDLE && transferTimeline){
+            uint64_t copied = transferTimeline->submit(1, &batch.transferCommands);
+            VeTimeline::Wait copies{transferTimeline->getSemaphore(), copied, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+            batch.ticket = graphicsTimeline.submit(graphicsCommands != VK_NULL_HANDLE ? 1 : 0, &batch.graphicsCommands, 1, &copies);
+        }else{
+            //one queue, the transfer command buffer comes from the graphics pool
+            VkCommandBuffer commandBuffers[] = {transferCommands, graphicsCommands};
+            uint32_t first = transferCommands != VK_NULL_HANDLE ? 0 : 1;
+            uint32_t count = (transferCommands != VK_NULL_HANDLE ? 1 : 0) + (graphicsCommands != VK_NULL_HANDLE ? 1 : 0);
+            batch.ticket = graphicsTimeline.submit(count, commandBuffers + first);
+        }
+        transferCommands = VK_NULL_HANDLE;
+        graphicsCommands = VK_NULL_HANDLE;
+        stagingChunks.clear();
+        chunkCursor = 0;
+        bufferReleases.clear();
+        bufferWrites = false;
+        lastSubmitted = batch.ticket;
+        batches.push_back(std::move(batch));
+        stats.submissions++;
+        return lastSubmitted;
+    }
+    void VeUploadContext::retire(Batch& batch){
+        if(batch.transferCommands != VK_NULL_HANDLE){
+            vkFreeCommandBuffers(veDevice.device(), veDevice.getTransferCommandPool(), 1, &batch.transferCommands);
+        }
+        if(batch.graphicsCommands != VK_NULL_HANDLE){
+            vkFreeCommandBuffers(veDevice.device(), veDevice.getCommandPool(), 1, &batch.graphicsCommands);
+        }
+        for(auto& chunk: batch.stagingChunks){
+            releaseChunk(std::move(chunk));
+        }
+        batch.stagingChunks.clear();
+    }
+    void VeUploadContext::collect(){
+        //tickets increase with submission order, so batches complete front to back
+        VeTimeline& graphicsTimeline = veDevice.getGraphicsTimeline();
+        while(!batches.empty() && graphicsTimeline.isComplete(batches.front().ticket)){
+            retire(batches.front());
+            batches.pop_front();
+        }
+    }
+    bool VeUploadContext::isComplete(Ticket ticket){
+        collect();
+        return veDevice.getGraphicsTimeline().isComplete(ticket);
+    }
+    void VeUploadContext::wait(Ticket ticket){
+        if(isComplete(ticket)){
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        veDevice.getGraphicsTimeline().wait(ticket);
+        collect();
+        stats.waits++;
+        stats.waitMilliseconds += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
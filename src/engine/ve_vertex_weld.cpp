@@ -0,0 +1,175 @@
+#include "ve_vertex_weld.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+namespace ve{
+    namespace{
+        static_assert(sizeof(VeModel::Vertex) % sizeof(uint32_t) == 0, "vertex must be made of 32 bit words");
+        constexpr size_t VERTEX_WORDS = sizeof(VeModel::Vertex) / sizeof(uint32_t);
+        constexpr uint32_t NEGATIVE_ZERO = 0x80000000u;
+        //slots per stored vertex the table keeps at least, i.e. the load factor stays at or under one half
+        constexpr size_t SLOTS_PER_VERTEX = 2;
+
+        //-0.0f and 0.0f compare equal as floats, so they must share a key
+        inline uint32_t canonicalWord(uint32_t word){
+            return word == NEGATIVE_ZERO ? 0u : word;
+        }
+        inline const uint32_t* vertexWords(const VeModel::Vertex& vertex){
+            return reinterpret_cast<const uint32_t*>(&vertex);
+        }
+        size_t nextPowerOfTwo(size_t value){
+            size_t result = 16;
+            while(result < value){
+                result <<= 1;
+            }
+            return result;
+        }
+
+        //the previous welding key, kept only as the benchmark baseline
+        struct LegacyVertexHash{
+            size_t operator()(const VeModel::Vertex& vertex) const{
+                size_t seed = 0;
+                auto combine = [&seed](float value){
+                    seed ^= std::hash<float>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                };
+                for(int i = 0; i < 3; i++) combine(vertex.position[i]);
+                for(int i = 0; i < 3; i++) combine(vertex.color[i]);
+                for(int i = 0; i < 3; i++) combine(vertex.normal[i]);
+                for(int i = 0; i < 2; i++) combine(vertex.uv[i]);
+                return seed;
+            }
+        };
+    }
+
+    VertexWeldTable::VertexWeldTable(std::vector<VeModel::Vertex>& target, size_t expectedVertices): vertices(target){
+        //sized so the expected unique count fits without growing
+        slots.assign(nextPowerOfTwo(expectedVertices * SLOTS_PER_VERTEX), Slot{0, EMPTY_SLOT});
+        mask = slots.size() - 1;
+        target.reserve(target.size() + expectedVertices);
+    }
+
+    uint64_t VertexWeldTable::hashVertex(const VeModel::Vertex& vertex){
+        const uint32_t* words = vertexWords(vertex);
+        uint64_t hash = 0x9E3779B97F4A7C15ull;
+        for(size_t i = 0; i < VERTEX_WORDS; i += 2){
+            uint64_t low = canonicalWord(words[i]);
+            uint64_t high = i + 1 < VERTEX_WORDS ? canonicalWord(words[i + 1]) : 0;
+            hash ^= (high << 32) | low;
+            hash *= 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 32;
+        }
+        hash ^= hash >> 29;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 32;
+        return hash;
+    }
+    bool VertexWeldTable::sameVertex(const VeModel::Vertex& a, const VeModel::Vertex& b){
+        const uint32_t* wordsA = vertexWords(a);
+        const uint32_t* wordsB = vertexWords(b);
+        for(size_t i = 0; i < VERTEX_WORDS; i++){
+            if(canonicalWord(wordsA[i]) != canonicalWord(wordsB[i])){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t VertexWeldTable::weld(const VeModel::Vertex& vertex){
+        if((count + 1) * SLOTS_PER_VERTEX > slots.size()){
+            grow();
+        }
+        uint32_t hash = static_cast<uint32_t>(hashVertex(vertex));
+        size_t slot = hash & mask;
+        //linear probing, the cached hash rejects most mismatches without touching the vertex
+        while(slots[slot].index != EMPTY_SLOT){
+            if(slots[slot].hash == hash && sameVertex(vertices[slots[slot].index], vertex)){
+                return slots[slot].index;
+            }
+            slot = (slot + 1) & mask;
+        }
+        uint32_t index = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(vertex);
+        slots[slot] = {hash, index};
+        count++;
+        return index;
+    }
+    void VertexWeldTable::grow(){
+        std::vector<Slot> oldSlots(slots.size() * 2, Slot{0, EMPTY_SLOT});
+        oldSlots.swap(slots);
+        mask = slots.size() - 1;
+        for(const auto& old: oldSlots){
+            if(old.index == EMPTY_SLOT){
+                continue;
+            }
+            size_t slot = old.hash & mask;
+            while(slots[slot].index != EMPTY_SLOT){
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = old;
+        }
+    }
+
+    bool VertexWeldTable::benchmark(size_t vertexCount){
+        //skinned-mesh-like input: every position is shared by several corners that differ only in joints/weights
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<VeModel::Vertex> input(vertexCount);
+        size_t distinctPositions = std::max<size_t>(1, vertexCount / 6);
+        for(size_t i = 0; i < vertexCount; i++){
+            VeModel::Vertex& vertex = input[i];
+            size_t positionId = random() % distinctPositions;
+            vertex.position = {static_cast<float>(positionId % 97), static_cast<float>(positionId / 97), 0.0f};
+            vertex.color = {1.0f, 1.0f, 1.0f};
+            vertex.normal = {0.0f, 1.0f, 0.0f};
+            vertex.uv = {static_cast<float>(positionId % 97) / 97.0f, 0.0f};
+            vertex.jointIndices = glm::ivec4(static_cast<int>(random() % 4), 0, 0, 0);
+            float weight = unit(random) < 0.5f ? 1.0f : 0.5f;
+            vertex.jointWeights = glm::vec4(weight, 1.0f - weight, 0.0f, 0.0f);
+        }
+        using Clock = std::chrono::high_resolution_clock;
+        auto secondsSince = [](Clock::time_point start){
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        std::vector<VeModel::Vertex> mapVertices;
+        std::vector<uint32_t> mapIndices;
+        mapIndices.reserve(vertexCount);
+        auto mapStart = Clock::now();
+        std::unordered_map<VeModel::Vertex, uint32_t, LegacyVertexHash> uniqueVertices{};
+        for(const auto& vertex: input){
+            if(uniqueVertices.count(vertex) == 0){
+                uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+                mapVertices.push_back(vertex);
+            }
+            mapIndices.push_back(uniqueVertices[vertex]);
+        }
+        double mapSeconds = secondsSince(mapStart);
+
+        std::vector<VeModel::Vertex> tableVertices;
+        std::vector<uint32_t> tableIndices;
+        tableIndices.reserve(vertexCount);
+        auto tableStart = Clock::now();
+        VertexWeldTable table(tableVertices, vertexCount);
+        for(const auto& vertex: input){
+            tableIndices.push_back(table.weld(vertex));
+        }
+        double tableSeconds = secondsSince(tableStart);
+
+        std::cout << "Vertex weld benchmark: " << vertexCount << " input vertices" << std::endl;
+        std::cout << "  std::unordered_map: " << mapVertices.size() << " unique, "
+                  << static_cast<double>(vertexCount) / mapSeconds << " vertices/s" << std::endl;
+        std::cout << "  VertexWeldTable:    " << tableVertices.size() << " unique, "
+                  << static_cast<double>(vertexCount) / tableSeconds << " vertices/s" << std::endl;
+        if(mapIndices != tableIndices){
+            std::cerr << "  index streams differ between weld implementations" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
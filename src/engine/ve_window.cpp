@@ -19,8 +19,8 @@ namespace ve {
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
         
     }
-    void VeWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
-        if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS) {
+    void VeWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface, const VkAllocationCallbacks *allocator) {
+        if (glfwCreateWindowSurface(instance, window, allocator, surface) != VK_SUCCESS) {
             throw std::runtime_error("failed to create window surface!");
         }
     }
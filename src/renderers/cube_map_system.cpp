@@ -21,7 +21,7 @@ namespace ve {
         createPipeline(renderPass);
     }
     CubeMapRenderSystem::~CubeMapRenderSystem() {
-        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, nullptr);
+        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, veDevice.allocationCallbacks());
     }
 
 
@@ -38,7 +38,7 @@ namespace ve {
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
         pipelineLayoutInfo.pushConstantRangeCount = 1;
         pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, veDevice.allocationCallbacks(), &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
@@ -78,7 +78,7 @@ namespace ve {
                     sizeof(CubeMapPushConstantData),
                     &push
                 );
-                std::vector<VkDescriptorSet> descriptorSets = {frameInfo.descriptorSet, obj.cubeMapComponent->descriptorSet};
+                std::array<VkDescriptorSet, 2> descriptorSets = {frameInfo.descriptorSet, obj.cubeMapComponent->descriptorSet};
                 vkCmdBindDescriptorSets(
                     frameInfo.commandBuffer,
                     VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -86,8 +86,8 @@ namespace ve {
                     0,  // First set index
                     static_cast<uint32_t>(descriptorSets.size()), // Number of sets
                     descriptorSets.data(), // Pointer to descriptor sets
-                    0,
-                    nullptr
+                    1,
+                    &frameInfo.globalUboOffset
                 );
                 obj.model->bind(frameInfo.commandBuffer);
                 obj.model->draw(frameInfo.commandBuffer);
@@ -26,7 +26,7 @@ namespace ve {
         createPipeline(renderPass);
     }
     OutlineHighlightSystem::~OutlineHighlightSystem() {
-        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, nullptr);
+        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, veDevice.allocationCallbacks());
     }
 
 
@@ -45,38 +45,47 @@ namespace ve {
         pipelineLayoutInfo.pushConstantRangeCount = 1;
         pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
         
-        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, veDevice.allocationCallbacks(), &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
     void OutlineHighlightSystem::createPipeline(VkRenderPass renderPass) {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
-        PipelineConfigInfo pipelineConfig{};
-        VePipeline::defaultPipelineConfigInfo(pipelineConfig);
-        
-        //set rasterization state to enable culling for outline
-        VkPipelineRasterizationStateCreateInfo rasterizationState{};
-        rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
-        rasterizationState.depthBiasEnable = VK_FALSE;
-        rasterizationState.depthClampEnable = VK_FALSE;
-        rasterizationState.rasterizerDiscardEnable = VK_FALSE;
-        rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizationState.lineWidth = 1.0f;
-
-        pipelineConfig.rasterizationInfo = rasterizationState;
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        vePipeline = std::make_unique<VePipeline>(
-            veDevice,
+        //both packed layouts only differ after the normal, so they share the packed outline shader
+        const std::array<const char*, VeModel::VERTEX_LAYOUT_COUNT> vertexShaders = {
             "shaders/outline_highlight_shader.vert.spv",
-            "shaders/outline_highlight_shader.frag.spv",
-            pipelineConfig);
+            "shaders/outline_highlight_shader_packed.vert.spv",
+            "shaders/outline_highlight_shader_packed.vert.spv"
+        };
+        for(uint32_t layout = 0; layout < VeModel::VERTEX_LAYOUT_COUNT; layout++){
+            PipelineConfigInfo pipelineConfig{};
+            VePipeline::defaultPipelineConfigInfo(pipelineConfig);
+            pipelineConfig.vertexBindingDescriptions = VeModel::getBindingDescriptions(static_cast<VeModel::VertexLayout>(layout));
+            pipelineConfig.vertexAttributeDescriptions = VeModel::getAttributeDescriptions(static_cast<VeModel::VertexLayout>(layout));
+            
+            //set rasterization state to enable culling for outline
+            VkPipelineRasterizationStateCreateInfo rasterizationState{};
+            rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
+            rasterizationState.depthBiasEnable = VK_FALSE;
+            rasterizationState.depthClampEnable = VK_FALSE;
+            rasterizationState.rasterizerDiscardEnable = VK_FALSE;
+            rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+            rasterizationState.lineWidth = 1.0f;
+
+            pipelineConfig.rasterizationInfo = rasterizationState;
+            pipelineConfig.renderPass = renderPass;
+            pipelineConfig.pipelineLayout = pipelineLayout;
+            vePipelines[layout] = std::make_unique<VePipeline>(
+                veDevice,
+                vertexShaders[layout],
+                "shaders/outline_highlight_shader.frag.spv",
+                pipelineConfig);
+        }
     }
     
     
     void OutlineHighlightSystem::renderGameObjects(FrameInfo& frameInfo) {
-        vePipeline->bind(frameInfo.commandBuffer);
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -84,12 +93,13 @@ namespace ve {
             0,
             1,
             &frameInfo.descriptorSet,
-            0,
-            nullptr
+            1,
+            &frameInfo.globalUboOffset
         );
         for(auto& key_value : frameInfo.gameObjects){
             auto& obj = key_value.second;
             if(obj.getId() == frameInfo.selectedObject && obj.lightComponent == nullptr){
+                vePipelines[static_cast<uint32_t>(obj.model->getVertexLayout())]->bind(frameInfo.commandBuffer);
                 SimplePushConstantData push{};
                 push.modelMatrix =  obj.transform.mat4();
                 push.normalMatrix = obj.transform.normalMatrix();
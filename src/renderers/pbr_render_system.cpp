@@ -1,13 +1,21 @@
 #include "pbr_render_system.hpp"
+#include "ve_frame_ring.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <stdexcept>
 #include <cassert>
 namespace ve {
+    //simplification error allowed on screen at lod bias 0
+    constexpr float LOD_ERROR_PIXELS = 1.0f;
+    //fewest objects worth a chunk of their own when recording in parallel
+    constexpr uint32_t MIN_CHUNK_OBJECTS = 64;
+
     struct PbrPushConstantData {
         glm::mat4 modelMatrix{1.0f};
         glm::mat4 normalMatrix{1.0f};
@@ -26,7 +34,7 @@ namespace ve {
         createPipeline(renderPass);
     }
     PbrRenderSystem::~PbrRenderSystem() {
-        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, nullptr);
+        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, veDevice.allocationCallbacks());
     }
 
 
@@ -43,26 +51,87 @@ namespace ve {
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
         pipelineLayoutInfo.pushConstantRangeCount = 1;
         pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, veDevice.allocationCallbacks(), &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
     void PbrRenderSystem::createPipeline(VkRenderPass renderPass) {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
-        PipelineConfigInfo pipelineConfig{};
-        VePipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        vePipeline = std::make_unique<VePipeline>(
-            veDevice,
+        const std::array<const char*, VeModel::VERTEX_LAYOUT_COUNT> vertexShaders = {
             "shaders/pbr_shader.vert.spv",
-            "shaders/pbr_shader.frag.spv",
-            pipelineConfig);
+            "shaders/pbr_shader_packed.vert.spv",
+            "shaders/pbr_shader_static.vert.spv"
+        };
+        for(uint32_t layout = 0; layout < VeModel::VERTEX_LAYOUT_COUNT; layout++){
+            PipelineConfigInfo pipelineConfig{};
+            VePipeline::defaultPipelineConfigInfo(pipelineConfig);
+            pipelineConfig.vertexBindingDescriptions = VeModel::getBindingDescriptions(static_cast<VeModel::VertexLayout>(layout));
+            pipelineConfig.vertexAttributeDescriptions = VeModel::getAttributeDescriptions(static_cast<VeModel::VertexLayout>(layout));
+            pipelineConfig.renderPass = renderPass;
+            pipelineConfig.pipelineLayout = pipelineLayout;
+            vePipelines[layout] = std::make_unique<VePipeline>(
+                veDevice,
+                vertexShaders[layout],
+                "shaders/pbr_shader.frag.spv",
+                pipelineConfig);
+        }
     }
     
     
-    void PbrRenderSystem::renderGameObjects(FrameInfo& frameInfo, const std::vector<VkDescriptorSet>& descriptorSets) {
-        vePipeline->bind(frameInfo.commandBuffer);
+    void PbrRenderSystem::renderGameObjects(FrameInfo& frameInfo, const VeFrameArena::Vector<VkDescriptorSet>& descriptorSets) {
+        uint32_t count = prepareDraws(frameInfo, 1);
+        for(uint32_t chunk = 0; chunk < count; chunk++){
+            recordChunk(frameInfo, descriptorSets, chunk);
+        }
+        finishDraws();
+    }
+    uint32_t PbrRenderSystem::prepareDraws(FrameInfo& frameInfo, uint32_t maxChunks) {
+        drawList.clear();
+        for(auto& key_value : frameInfo.gameObjects){
+            auto& obj = key_value.second;
+            if(obj.lightComponent != nullptr || obj.cubeMapComponent != nullptr){
+                continue;
+            }
+            //the frame ring had no room for its palette this frame, drawing it would read another model's joints
+            if(obj.model && obj.model->isAnimated() && obj.model->getJointPaletteOffset() == VeFrameRing::NO_OFFSET){
+                continue;
+            }
+            drawList.push_back(&obj);
+        }
+        uint32_t objectCount = static_cast<uint32_t>(drawList.size());
+        //every chunk rebinds pipeline, descriptor sets and geometry, small chunks would spend more on that than they save
+        chunkCount = std::min(std::max(maxChunks, 1u), (objectCount + MIN_CHUNK_OBJECTS - 1) / MIN_CHUNK_OBJECTS);
+        if(chunks.size() < chunkCount){
+            chunks.resize(chunkCount);
+        }
+        for(uint32_t chunk = 0; chunk < chunkCount; chunk++){
+            chunks[chunk].first = static_cast<uint32_t>(static_cast<uint64_t>(objectCount) * chunk / chunkCount);
+            chunks[chunk].count = static_cast<uint32_t>(static_cast<uint64_t>(objectCount) * (chunk + 1) / chunkCount) - chunks[chunk].first;
+        }
+        return chunkCount;
+    }
+    void PbrRenderSystem::finishDraws() {
+        cullStats = {};
+        lodStats = {};
+        for(uint32_t chunk = 0; chunk < chunkCount; chunk++){
+            cullStats.add(chunks[chunk].cullStats);
+            for(uint32_t lod = 0; lod < VeModel::MAX_LODS; lod++){
+                lodStats.objects[lod] += chunks[chunk].lodStats.objects[lod];
+                lodStats.triangles[lod] += chunks[chunk].lodStats.triangles[lod];
+            }
+            lodStats.geometryBinds += chunks[chunk].lodStats.geometryBinds;
+        }
+    }
+    void PbrRenderSystem::recordChunk(const FrameInfo& frameInfo, const VeFrameArena::Vector<VkDescriptorSet>& descriptorSets, uint32_t chunk) {
+        assert(chunk < chunkCount && "Chunk was not prepared this frame");
+        Chunk& state = chunks[chunk];
+        //the chunk's own counters and scratch list, they shadow the totals finishDraws fills in
+        auto& cullStats = state.cullStats;
+        auto& lodStats = state.lodStats;
+        auto& drawRanges = state.drawRanges;
+        //all layout variants share the pipeline layout, so the sets stay bound across pipeline switches
+        //the global ubo and the joint palette are dynamic, in set order
+        std::array<uint32_t, 2> dynamicOffsets = {frameInfo.globalUboOffset, frameInfo.jointPaletteOffset};
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -70,32 +139,129 @@ namespace ve {
             0,  // First set index
             static_cast<uint32_t>(descriptorSets.size()), // Number of sets
             descriptorSets.data(), // Pointer to descriptor sets
-            0,
-            nullptr
+            static_cast<uint32_t>(dynamicOffsets.size()),
+            dynamicOffsets.data()
         );
-        for(auto& key_value : frameInfo.gameObjects){
-            auto& obj = key_value.second;
-            if(obj.lightComponent == nullptr && obj.cubeMapComponent == nullptr){
-                PbrPushConstantData push{};
-                push.modelMatrix =  obj.transform.mat4();
-                push.normalMatrix = obj.transform.normalMatrix();
-                push.textureIndex = obj.getTextureIndex();
-                push.normalIndex = obj.getNormalIndex();
-                push.specularIndex = obj.getSpecularIndex();
-                push.smoothness = obj.getSmoothness();
-                push.baseColor = obj.color;
-                
+        //animated models read their own palette from the same descriptor set, only the offset changes
+        uint32_t boundPalette = frameInfo.jointPaletteOffset;
+        auto bindPalette = [&](const VeModel& model){
+            if(!model.isAnimated() || model.getJointPaletteOffset() == boundPalette){
+                return;
+            }
+            boundPalette = model.getJointPaletteOffset();
+            vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                                    2, 1, &descriptorSets[2], 1, &boundPalette);
+        };
+        VePipeline* boundPipeline = nullptr;
+        //vertex buffer bindings survive pipeline switches, so only a different arena or index type needs a bind
+        VeModel::BindingKey boundGeometry{};
+        cullStats = {};
+        lodStats = {};
+        auto bindGeometry = [&](VeModel& model){
+            VeModel::BindingKey key = model.getBindingKey();
+            if(key != boundGeometry){
+                model.bind(frameInfo.commandBuffer);
+                boundGeometry = key;
+                lodStats.geometryBinds++;
+            }
+        };
+        //pixels covered by one world unit at distance one
+        float pixelsPerUnit = std::abs(frameInfo.camera.getProjectionMatrix()[1][1]) * 0.5f * viewportHeight;
+        float maxErrorPixels = LOD_ERROR_PIXELS * std::exp2(lodBias);
+        auto frustum = VeMeshlets::Frustum::fromMatrix(frameInfo.camera.getProjectionMatrix() * frameInfo.camera.getViewMatrix());
+        glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+        for(uint32_t i = state.first; i < state.first + state.count; i++){
+            auto& obj = *drawList[i];
+            VePipeline* pipeline = vePipelines[static_cast<uint32_t>(obj.model->getVertexLayout())].get();
+            if(pipeline != boundPipeline){
+                pipeline->bind(frameInfo.commandBuffer);
+                boundPipeline = pipeline;
+            }
+            bindPalette(*obj.model);
+            PbrPushConstantData push{};
+            push.modelMatrix =  obj.transform.mat4();
+            push.normalMatrix = obj.transform.normalMatrix();
+            push.textureIndex = obj.getTextureIndex();
+            push.normalIndex = obj.getNormalIndex();
+            push.specularIndex = obj.getSpecularIndex();
+            push.smoothness = obj.getSmoothness();
+            push.baseColor = obj.color;
+            
+            //multi material models re-push per material with the material's base color folded in
+            const auto& materials = obj.model->getMaterials();
+            auto bindMaterial = [&](int32_t materialId){
+                PbrPushConstantData materialPush = push;
+                if(materialId != VeModel::NO_MATERIAL && materialId < static_cast<int32_t>(materials.size())){
+                    materialPush.baseColor = materialPush.baseColor * glm::vec3(materials[materialId].baseColorFactor);
+                }
                 vkCmdPushConstants(
                     frameInfo.commandBuffer,
                     pipelineLayout,
                     VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                     0,
                     sizeof(PbrPushConstantData),
-                    &push
+                    &materialPush
                 );
-                obj.model->bind(frameInfo.commandBuffer);
+            };
+            if(obj.model->getSubmeshCount() == 0){
+                bindMaterial(VeModel::NO_MATERIAL);
+                bindGeometry(*obj.model);
                 obj.model->draw(frameInfo.commandBuffer);
+                continue;
+            }
+            const auto& lods = obj.model->getLods();
+            uint32_t lod = selectLod(*obj.model, push.modelMatrix, cameraPosition, pixelsPerUnit, maxErrorPixels);
+            //meshlets cover LOD 0 only and their bounds are bind pose, so skinned models are still drawn whole
+            const auto& meshlets = obj.model->getMeshlets();
+            bool clusterCulling = lod == 0 && meshlets.size() >= 2 && !obj.model->isAnimated();
+            lodStats.objects[lod]++;
+            bindGeometry(*obj.model);
+            if(!clusterCulling){
+                lodStats.triangles[lod] += lods[lod].indexCount / 3;
+                obj.model->drawSubmeshes(frameInfo.commandBuffer, lod, bindMaterial);
+                continue;
+            }
+            //submeshes in material order, each drawing whatever of its clusters survived
+            bool materialBound = false;
+            int32_t boundMaterial = VeModel::NO_MATERIAL;
+            for(uint32_t index: obj.model->getMaterialOrder()){
+                const auto& submesh = obj.model->getSubmesh(0, index);
+                drawRanges.clear();
+                cullStats.add(VeMeshlets::cull(meshlets.data() + submesh.firstMeshlet, submesh.meshletCount, push.modelMatrix, frustum,
+                                               cameraPosition, coneCulling, drawRanges));
+                if(drawRanges.empty()){
+                    continue;
+                }
+                if(!materialBound || submesh.materialId != boundMaterial){
+                    bindMaterial(submesh.materialId);
+                    boundMaterial = submesh.materialId;
+                    materialBound = true;
+                }
+                for(const auto& range: drawRanges){
+                    lodStats.triangles[0] += range.indexCount / 3;
+                    obj.model->drawRange(frameInfo.commandBuffer, range.firstIndex, range.indexCount, submesh.vertexOffset);
+                }
+            }
+        }
+    }
+
+    uint32_t PbrRenderSystem::selectLod(const VeModel& model, const glm::mat4& modelMatrix, const glm::vec3& cameraPosition,
+                                        float pixelsPerUnit, float maxErrorPixels) const {
+        const auto& lods = model.getLods();
+        if(lods.size() < 2){
+            return 0;
+        }
+        float scale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        const auto& bounds = model.getBounds();
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+        float radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+        //distance to the nearest point of the bounding sphere, so the error is never underestimated
+        float distance = std::max(glm::length(center - cameraPosition) - radius, 1e-3f);
+        for(uint32_t lod = static_cast<uint32_t>(lods.size()) - 1; lod > 0; lod--){
+            if(lods[lod].error * scale * pixelsPerUnit / distance <= maxErrorPixels){
+                return lod;
             }
         }
+        return 0;
     }
 }
\ No newline at end of file
@@ -17,7 +17,7 @@ namespace ve {
         createPipeline(renderPass);
     }
     PointLightSystem::~PointLightSystem() {
-        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, nullptr);
+        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, veDevice.allocationCallbacks());
     }
 
 
@@ -35,7 +35,7 @@ namespace ve {
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
         pipelineLayoutInfo.pushConstantRangeCount = 0;
         pipelineLayoutInfo.pPushConstantRanges = nullptr;
-        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, veDevice.allocationCallbacks(), &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
@@ -88,8 +88,8 @@ namespace ve {
             0,
             1,
             &frameInfo.descriptorSet,
-            0,
-            nullptr
+            1,
+            &frameInfo.globalUboOffset
         );
         vkCmdDraw(frameInfo.commandBuffer, 6, frameInfo.numLights, 0, 0);
     }
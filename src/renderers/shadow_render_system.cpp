@@ -13,8 +13,9 @@ namespace ve {
     };
     ShadowRenderSystem::ShadowRenderSystem(
         VeDevice& device,
-        VeDescriptorPool& globalPool
-    ): veDevice{device} {
+        VeDescriptorPool& globalPool,
+        int framesInFlight
+    ): veDevice{device}, framesInFlight{framesInFlight} {
         createResources();
         createDescriptors(globalPool);
         createRenderPass();
@@ -23,17 +24,21 @@ namespace ve {
         createPipeline();
     }
     ShadowRenderSystem::~ShadowRenderSystem() {
-        vkDestroyPipeline(veDevice.device(), graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, nullptr);
-        vkDestroyRenderPass(veDevice.device(), renderPass, nullptr);
-        vkDestroyShaderModule(veDevice.device(), vertShaderModule, nullptr);
+        for(VkPipeline graphicsPipeline: graphicsPipelines){
+            vkDestroyPipeline(veDevice.device(), graphicsPipeline, veDevice.allocationCallbacks());
+        }
+        vkDestroyPipelineLayout(veDevice.device(), pipelineLayout, veDevice.allocationCallbacks());
+        vkDestroyRenderPass(veDevice.device(), renderPass, veDevice.allocationCallbacks());
+        vkDestroyShaderModule(veDevice.device(), vertShaderModule, veDevice.allocationCallbacks());
+        //framesInFlight framebuffers per light
+        for(VkFramebuffer frameBuffer: frameBuffers){
+            vkDestroyFramebuffer(veDevice.device(), frameBuffer, veDevice.allocationCallbacks());
+        }
         for(int i = 0; i < 10; i++){
-            vkDestroyFramebuffer(veDevice.device(), frameBuffers[i], nullptr);
-            vkDestroyFramebuffer(veDevice.device(), frameBuffers[i + 10], nullptr);
-            vkDestroySampler(veDevice.device(), shadowSamplers[i], nullptr);
-            vkDestroyImageView(veDevice.device(), shadowImageViews[i], nullptr);
-            vkDestroyImage(veDevice.device(), shadowImages[i], nullptr);
-            vkFreeMemory(veDevice.device(), shadowImageMemories[i], nullptr);
+            vkDestroySampler(veDevice.device(), shadowSamplers[i], veDevice.allocationCallbacks());
+            vkDestroyImageView(veDevice.device(), shadowImageViews[i], veDevice.allocationCallbacks());
+            vkDestroyImage(veDevice.device(), shadowImages[i], veDevice.allocationCallbacks());
+            veDevice.freeMemory(shadowImageMemories[i]);
         }
     }
     void ShadowRenderSystem::createResources(){
@@ -54,8 +59,8 @@ namespace ve {
             imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
             imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
             VkImage shadowImage;
-            VkDeviceMemory shadowImageMemory;
-            veDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shadowImage, shadowImageMemory);
+            VeAllocation shadowImageMemory;
+            veDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shadowImage, shadowImageMemory, VeMemoryCategory::SHADOW);
             shadowImages.push_back(shadowImage);
             shadowImageMemories.push_back(shadowImageMemory);
 
@@ -70,7 +75,7 @@ namespace ve {
             viewInfo.subresourceRange.baseArrayLayer = 0;
             viewInfo.subresourceRange.layerCount = 6;
             VkImageView shadowImageView;
-            if(vkCreateImageView(veDevice.device(), &viewInfo, nullptr, &shadowImageView) != VK_SUCCESS){
+            if(vkCreateImageView(veDevice.device(), &viewInfo, veDevice.allocationCallbacks(), &shadowImageView) != VK_SUCCESS){
                 throw std::runtime_error("failed to create shadow image view!");
             }
             shadowImageViews.push_back(shadowImageView);
@@ -93,7 +98,7 @@ namespace ve {
             samplerInfo.minLod = 0.0f;
             samplerInfo.maxLod = 1.0f;
             VkSampler shadowSampler;
-            if(vkCreateSampler(veDevice.device(), &samplerInfo, nullptr, &shadowSampler) != VK_SUCCESS){
+            if(vkCreateSampler(veDevice.device(), &samplerInfo, veDevice.allocationCallbacks(), &shadowSampler) != VK_SUCCESS){
                 throw std::runtime_error("failed to create shadow sampler!");
             }
             shadowSamplers.push_back(shadowSampler);
@@ -101,7 +106,7 @@ namespace ve {
     }
     void ShadowRenderSystem::createDescriptors(VeDescriptorPool& globalPool){
 
-        for(int i =0; i< VeSwapChain::MAX_FRAMES_IN_FLIGHT; i++){
+        for(int i =0; i< framesInFlight; i++){
             auto uniformBuffers = std::make_unique<VeBuffer>(
                 veDevice,
                 sizeof(LightShadowUbo),
@@ -128,8 +133,8 @@ namespace ve {
             imageInfo.sampler = shadowSamplers[i];
             imageInfos[i] = imageInfo;
         }
-        std::vector<VkDescriptorSet> sets(VeSwapChain::MAX_FRAMES_IN_FLIGHT * 2);
-        for(int i =0; i <VeSwapChain::MAX_FRAMES_IN_FLIGHT; i++){
+        std::vector<VkDescriptorSet> sets(framesInFlight * 2);
+        for(int i =0; i <framesInFlight; i++){
             auto buffer = shadowBuffers[i]->descriptorInfo();
             VeDescriptorWriter(*shadowDescriptorSetLayout, globalPool)
                 .writeImage(0, imageInfos.data(), numLights)
@@ -137,8 +142,8 @@ namespace ve {
             shadowDescriptorSets.push_back(sets[i]);
             VeDescriptorWriter(*lightMatrixDescriptorSetLayout, globalPool)
                 .writeBuffer(0, &buffer)
-                .build(sets[VeSwapChain::MAX_FRAMES_IN_FLIGHT + i]);
-            lightMatrixDescriptorSets.push_back(sets[VeSwapChain::MAX_FRAMES_IN_FLIGHT + i]);
+                .build(sets[framesInFlight + i]);
+            lightMatrixDescriptorSets.push_back(sets[framesInFlight + i]);
         }
     }
     void ShadowRenderSystem::createRenderPass(){
@@ -192,13 +197,13 @@ namespace ve {
         shadowPassInfo.dependencyCount =static_cast<uint32_t>(dependencies.size());
         shadowPassInfo.pDependencies = dependencies.data();
         shadowPassInfo.flags = 0;
-        if(vkCreateRenderPass(veDevice.device(), &shadowPassInfo, nullptr, &renderPass) != VK_SUCCESS){
+        if(vkCreateRenderPass(veDevice.device(), &shadowPassInfo, veDevice.allocationCallbacks(), &renderPass) != VK_SUCCESS){
             throw std::runtime_error("failed to create render pass!");
         }
     }
     void ShadowRenderSystem::createFrameBuffer(){
         int numLights = 10;
-        for(int i = 0; i < VeSwapChain::MAX_FRAMES_IN_FLIGHT; i++){
+        for(int i = 0; i < framesInFlight; i++){
             for(int j = 0; j < numLights; j++){
                 VkFramebuffer frameBuffer;
                 VkFramebufferCreateInfo framebufferInfo{};
@@ -212,7 +217,7 @@ namespace ve {
                 framebufferInfo.height = shadowResolution;
                 framebufferInfo.layers = 6;
                 framebufferInfo.flags = 0;
-                if(vkCreateFramebuffer(veDevice.device(), &framebufferInfo, nullptr, &frameBuffer) != VK_SUCCESS){
+                if(vkCreateFramebuffer(veDevice.device(), &framebufferInfo, veDevice.allocationCallbacks(), &frameBuffer) != VK_SUCCESS){
                     throw std::runtime_error("failed to create framebuffer!");
                 }
                 frameBuffers.push_back(frameBuffer);
@@ -233,7 +238,7 @@ namespace ve {
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
         pipelineLayoutInfo.pushConstantRangeCount = 1;
         pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        if (vkCreatePipelineLayout(veDevice.device(), &pipelineLayoutInfo, veDevice.allocationCallbacks(), &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
@@ -256,16 +261,10 @@ namespace ve {
         vertexShaderStageInfo.pSpecializationInfo = nullptr;
         pipelineInfo.stageCount = 1;
         pipelineInfo.pStages = &vertexShaderStageInfo;
-        //vertex inpit
-        std::vector<VkVertexInputBindingDescription> bindingDescriptions = VeModel::Vertex::getBindingDescriptions();
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = VeModel::Vertex::getAttributeDescriptions();
+        //vertex inpit, filled in per vertex layout below
         VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         vertexInputInfo.pNext = nullptr;
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
         vertexInputInfo.flags = 0;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         //input assembly
@@ -333,8 +332,17 @@ namespace ve {
         pipelineInfo.layout = pipelineLayout;
         pipelineInfo.renderPass = renderPass;
         pipelineInfo.subpass = 0;
-        if(vkCreateGraphicsPipelines(veDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS){
-            throw std::runtime_error("faishaders/simple_shader.vertled to create shadow pipeline!");
+        for(uint32_t layout = 0; layout < VeModel::VERTEX_LAYOUT_COUNT; layout++){
+            //depth only, so just the position (+skin) stream is fetched
+            std::vector<VkVertexInputBindingDescription> bindingDescriptions = VeModel::getPositionBindingDescriptions(static_cast<VeModel::VertexLayout>(layout));
+            std::vector<VkVertexInputAttributeDescription> attributeDescriptions = VeModel::getPositionAttributeDescriptions(static_cast<VeModel::VertexLayout>(layout));
+            vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+            vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+            vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+            vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+            if(vkCreateGraphicsPipelines(veDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, veDevice.allocationCallbacks(), &graphicsPipelines[layout]) != VK_SUCCESS){
+                throw std::runtime_error("faishaders/simple_shader.vertled to create shadow pipeline!");
+            }
         }
     }
     
@@ -394,7 +402,6 @@ namespace ve {
     }
     
     void ShadowRenderSystem::renderGameObjects(FrameInfo& frameInfo, int lightInstance){ 
-        vkCmdBindPipeline(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -405,9 +412,11 @@ namespace ve {
             0,
             nullptr
         );
+        VeModel::BindingKey boundGeometry{};
         for(auto& key_value : frameInfo.gameObjects){
             auto& obj = key_value.second;
             if(obj.lightComponent == nullptr){
+                vkCmdBindPipeline(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipelines[static_cast<uint32_t>(obj.model->getVertexLayout())]);
                 ObjectConstants objConstants{};
                 objConstants.modelMatrix = obj.transform.mat4();
                 vkCmdPushConstants(
@@ -418,7 +427,10 @@ namespace ve {
                     sizeof(ObjectConstants),
                     &objConstants
                 );
-                obj.model->bind(frameInfo.commandBuffer);
+                if(obj.model->getBindingKey() != boundGeometry){
+                    obj.model->bindPositions(frameInfo.commandBuffer);
+                    boundGeometry = obj.model->getBindingKey();
+                }
                 obj.model->drawInstanced(frameInfo.commandBuffer, 6);
             }
         }
@@ -428,7 +440,7 @@ namespace ve {
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         createInfo.codeSize = code.size();
         createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-        if(vkCreateShaderModule(veDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS){
+        if(vkCreateShaderModule(veDevice.device(), &createInfo, veDevice.allocationCallbacks(), shaderModule) != VK_SUCCESS){
             throw std::runtime_error("failed to create shader module!");
         }
     }